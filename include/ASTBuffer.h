@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "ASTNode.h"
+
+namespace AST
+{
+	// An expression tree in flat arrays instead of heap nodes: no vtable, no operand vector and no
+	// pointer chasing per node, 14 bytes of node fields plus 4 per operand link.
+	// Nodes are appended in post-order, so operands always come before the operator using them
+	// and the last node is the root. An operator's operands are GetOperandCount consecutive entries
+	// of mOperands; an index may be used as operand more than once, ToTree then copies it.
+	class ASTBuffer
+	{
+	public:
+		using NodeIndex = uint32_t;
+		static constexpr NodeIndex kInvalidIndex = UINT32_MAX;
+
+	private:
+		std::vector<ASTNode::NodeType> mTypes = {};
+		std::vector<OperationId> mOperationIds = {}; // OperationId::Invalid for everything but operators
+		std::vector<uint32_t> mFirstOperands = {}; // into mOperands
+		std::vector<uint32_t> mOperandCounts = {};
+		std::vector<uint32_t> mPayloads = {}; // rationals: into mRationals, variables: SymbolInterner id, others: into mSymbols
+
+		std::vector<NodeIndex> mOperands = {};
+		std::vector<Rational> mRationals = {};
+		std::vector<const Symbol*> mSymbols = {};
+		std::unordered_map<const Symbol*, uint32_t> mSymbolIndices = {};
+
+		NodeIndex AddNode(const ASTNode::NodeType type, const uint32_t payload);
+		uint32_t AddSymbol(const Symbol* symbol);
+
+	public:
+		ASTBuffer() = default;
+
+		// copies a pointer tree, an empty buffer for null
+		static ASTBuffer FromTree(const ASTNode* root);
+
+		NodeIndex AddRational(const Rational& value);
+		NodeIndex AddIrrational(const Irrational* irrational);
+		NodeIndex AddVariable(const InternedSymbol& variable);
+		NodeIndex AddParenthesis(const Parenthesis* parenthesis);
+		NodeIndex AddOperator(const Operator* op, const std::vector<NodeIndex>& operands);
+
+		// appends a pointer tree and returns the index of its root
+		NodeIndex AddTree(const ASTNode* node);
+
+		// appends a subtree of another buffer and returns the index of its root
+		NodeIndex AddSubtree(const ASTBuffer& source, const NodeIndex index);
+
+		// builds the equivalent heap tree, null for an empty buffer
+		ASTNode* ToTree() const;
+		ASTNode* ToTree(const NodeIndex index) const;
+
+		size_t GetSize() const { return mTypes.size(); }
+		bool IsEmpty() const { return mTypes.empty(); }
+		NodeIndex GetRoot() const { return mTypes.empty() ? kInvalidIndex : static_cast<NodeIndex>(mTypes.size() - 1); }
+
+		ASTNode::NodeType GetType(const NodeIndex index) const { return mTypes[index]; }
+		OperationId GetOperationId(const NodeIndex index) const { return mOperationIds[index]; }
+		size_t GetOperandCount(const NodeIndex index) const { return mOperandCounts[index]; }
+		NodeIndex GetOperand(const NodeIndex index, const size_t operand) const { return mOperands[mFirstOperands[index] + operand]; }
+
+		const Rational& GetRational(const NodeIndex index) const { return mRationals[mPayloads[index]]; }
+		const Irrational* GetIrrational(const NodeIndex index) const { return static_cast<const Irrational*>(mSymbols[mPayloads[index]]); }
+		InternedSymbol GetVariable(const NodeIndex index) const;
+		const Parenthesis* GetParenthesis(const NodeIndex index) const { return static_cast<const Parenthesis*>(mSymbols[mPayloads[index]]); }
+		const Operator* GetOperator(const NodeIndex index) const { return static_cast<const Operator*>(mSymbols[mPayloads[index]]); }
+
+		// same result as ASTNode::operator== on the equivalent trees
+		bool Equals(const NodeIndex index, const ASTBuffer& other, const NodeIndex otherIndex) const;
+		bool operator==(const ASTBuffer& other) const;
+		bool operator!=(const ASTBuffer& other) const { return !(*this == other); }
+
+		void Reserve(const size_t nodeCount);
+
+		// keeps the capacity so a reused buffer does not allocate
+		void Clear();
+	};
+}
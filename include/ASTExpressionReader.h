@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+
+#include "ASTParser.h"
+
+namespace AST
+{
+	// Read-only memory mapping of a whole file.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		std::string_view GetData() const { return std::string_view(mData, mSize); }
+
+		// lets the OS drop the pages of [0, offset) that were already consumed
+		void ReleaseBefore(const size_t offset);
+
+	private:
+		const char* mData = nullptr;
+		size_t mSize = 0;
+		size_t mReleasedOffset = 0;
+#ifdef _WIN32
+		void* mFileHandle = nullptr;
+		void* mMappingHandle = nullptr;
+#else
+		int mFileDescriptor = -1;
+#endif
+	};
+
+	// Streams the records of a newline- or NUL-delimited expression file.
+	// Records are views into the mapping, nothing is copied.
+	class ASTExpressionReader
+	{
+	public:
+		enum class Delimiter : uint8_t
+		{
+			Newline, // a trailing '\r' is dropped
+			Null,
+		};
+
+		struct Record
+		{
+			std::string_view mText;
+			size_t mOffset = 0; // byte offset of the record in the file
+			size_t mIndex = 0;
+		};
+
+		// receives every record with its parse result in file order and owns result.mRoot
+		using RecordHandler = std::function<void(const Record& record, ASTParser::ParsedExpression& result)>;
+
+		explicit ASTExpressionReader(const std::string& path, const Delimiter delimiter = Delimiter::Newline);
+
+		// next non-empty record, false at the end of the file
+		bool Next(Record& outRecord);
+
+		// Parses every remaining record, at most windowSize records at a time, and returns the record count.
+		// The handler runs before the next window is read, so a slow consumer throttles the reader
+		// and memory stays bounded by one window of results.
+		size_t ParseAll(ASTParser& parser, const RecordHandler& handler, const size_t windowSize = 4096, ASTWorkerPool& pool = ASTWorkerPool::GetDefault());
+
+		size_t GetOffset() const { return mOffset; }
+
+	private:
+		MappedFile mFile;
+		Delimiter mDelimiter = Delimiter::Newline;
+		size_t mOffset = 0;
+		size_t mRecordIndex = 0;
+	};
+}
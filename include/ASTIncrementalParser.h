@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "ASTParser.h"
+
+namespace AST
+{
+	// Keeps the text, tree and parenthesized groups of one expression so that an edit
+	// only re-parses the innermost group around it and splices the new subtree into
+	// the existing tree. Edits outside of any group, or that leave the group invalid,
+	// fall back to a full parse.
+	class ASTIncrementalParser
+	{
+	public:
+		explicit ASTIncrementalParser(const ASTParser& parser = ASTParser());
+		~ASTIncrementalParser();
+
+		ASTIncrementalParser(const ASTIncrementalParser&) = delete;
+		ASTIncrementalParser& operator=(const ASTIncrementalParser&) = delete;
+
+		// replaces the whole expression
+		bool Parse(std::string_view expression);
+
+		// replaces removedLength characters at offset with insertedText; false when the new text is invalid
+		bool Edit(const size_t offset, const size_t removedLength, std::string_view insertedText);
+
+		// owned by the incremental parser, null while the text is invalid
+		const ASTNode* GetRoot() const { return mRoot; }
+		const std::string& GetText() const { return mText; }
+
+		ASTParser::ResultType GetErrorType() const { return mErrorType; }
+		size_t GetErrorPos() const { return mErrorPos; }
+
+		// characters re-parsed by the last Parse or Edit
+		size_t GetLastParsedLength() const { return mLastParsedLength; }
+
+	private:
+		struct ParentLink
+		{
+			OperatorNode* mParent = nullptr; // null for the root
+			size_t mIndex = 0;
+		};
+
+		bool ParseAll();
+		bool ReparseGroup(const size_t groupIndex, const size_t removedLength, const size_t insertedLength);
+
+		static void SortGroups(std::vector<ASTParser::ParenthesisGroup>& groups);
+
+		void LinkSubtree(ASTNode* node, OperatorNode* parent, const size_t index);
+		void UnlinkSubtree(const ASTNode* node);
+		void Reset();
+
+		ASTParser mParser;
+		std::string mText;
+		ASTNode* mRoot = nullptr;
+		std::vector<ASTParser::ParenthesisGroup> mGroups = {}; // sorted by mBegin
+		std::unordered_map<const ASTNode*, ParentLink> mParents = {};
+
+		ASTParser::ResultType mErrorType = ASTParser::ResultType::NoError;
+		size_t mErrorPos = -1;
+		size_t mLastParsedLength = 0;
+	};
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+#include "ASTPostfix.h"
+
+namespace AST
+{
+	struct ASTNode;
+
+	// Machine-written expression formats read by ASTParser::IngestText and ASTParser::IngestBinary.
+	// They name operators by OperationId and irrationals by IrrationalId, so reading them needs
+	// no precedence, no registry trie and no implicit operators.
+	//
+	// Text: tokens separated by spaces, in prefix or postfix order
+	//   3, -1/2     rational, numerator and optional denominator
+	//   $x          variable
+	//   #1          irrational by IrrationalId
+	//   @1, @25:3   operator by OperationId, FunctionMultiple operators give their operand count
+	//
+	// Binary: records in postfix order, tagged with a PostfixOpcode byte, integers little endian
+	//   Rational     int32 numerator, int32 denominator
+	//   Irrational   uint8 IrrationalId
+	//   Variable     uint16 length, name bytes
+	//   Operator     uint8 OperationId, uint16 operand count
+	enum class IngestOrder : uint8_t
+	{
+		Prefix,
+		Postfix,
+	};
+
+	// Append a tree in the ingest formats, e.g. to produce input for tests or other services.
+	// False when the tree holds a node the format cannot name.
+	bool WriteIngestText(const ASTNode* root, const IngestOrder order, std::string& out);
+	bool WriteIngestBinary(const ASTNode* root, std::string& out);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+
+#include "ASTLexer.h"
+
+namespace AST
+{
+	// Validation pass over the raw input, run before the parser allocates anything.
+	// It rejects control bytes, checks that every parenthesis closes in order and records
+	// bitmaps of spaces and digits so the parser can skip runs of them a word at a time.
+	// Uses AVX2 or SSE2 when the compiler targets them, plain byte loops otherwise.
+	class ASTInputScan
+	{
+	public:
+		enum class ScanError : uint8_t
+		{
+			None,
+			InvalidCharacter,
+			InvalidParenthesis,
+		};
+
+		// false on the first error, see GetError and GetErrorPos
+		bool Scan(std::string_view expression, const ASTLexer::RegistryList& registries, const bool matchExactParenthesis);
+
+		ScanError GetError() const { return mError; }
+		size_t GetErrorPos() const { return mErrorPos; }
+
+		// first position at or after pos that is not a space
+		size_t SkipWhitespace(const size_t pos) const { return FindClear(mWhitespace, pos); }
+
+		// first position at or after pos that is not a digit
+		size_t GetDigitRunEnd(const size_t pos) const { return FindClear(mDigits, pos); }
+
+	private:
+		struct BlockMasks
+		{
+			uint64_t mWhitespace = 0;
+			uint64_t mDigits = 0;
+			uint64_t mControl = 0;
+			uint64_t mParentheses = 0;
+		};
+
+		void Configure(const ASTLexer::RegistryList& registries);
+		BlockMasks ClassifyBlock(const char* data, const size_t length) const;
+		bool CheckParentheses(std::string_view expression, uint64_t mask, const size_t blockBegin, const bool matchExactParenthesis);
+
+		size_t FindClear(const std::vector<uint64_t>& bits, size_t pos) const;
+
+		std::vector<uint64_t> mWhitespace = {};
+		std::vector<uint64_t> mDigits = {};
+		std::vector<size_t> mOpenStack = {};
+		size_t mSize = 0;
+
+		ScanError mError = ScanError::None;
+		size_t mErrorPos = -1;
+
+		// single-byte parentheses: index of the pair, opening ones are marked in mIsOpen
+		static constexpr uint8_t kNoPair = 0xFF;
+		std::array<uint8_t, 256> mPair = {};
+		std::array<bool, 256> mIsOpen = {};
+		std::vector<char> mParenthesisBytes = {};
+		bool mCheckParentheses = false;
+
+		ASTLexer::RegistryList mRegistries = {};
+		std::array<uint64_t, ASTLexer::kCategoryCount> mVersions = {};
+		bool mConfigured = false;
+	};
+}
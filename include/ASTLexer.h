@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string_view>
+
+#include "DataTypes/Symbol.h"
+#include "DataTypes/Operator.h"
+#include "DataTypes/SymbolInterner.h"
+
+namespace AST
+{
+	enum class TokenCategory : uint8_t
+	{
+		Parenthesis,
+		Irrational,
+		Operator,
+		CustomSymbol,
+		Count,
+	};
+
+	// Flat trie compiled from every symbol registry a parser uses.
+	// A single scan reports the longest match of each category, so the parser
+	// classifies a token without walking one trie per registry.
+	class ASTLexer
+	{
+	public:
+		static constexpr size_t kCategoryCount = static_cast<size_t>(TokenCategory::Count);
+		static constexpr uint32_t kNoState = 0xFFFFFFFF;
+
+		// registries indexed by TokenCategory
+		using RegistryList = std::array<const SymbolRegistry*, kCategoryCount>;
+
+		struct Match
+		{
+			std::array<uint32_t, kCategoryCount> mLength = {};
+			std::array<uint32_t, kCategoryCount> mState = { kNoState, kNoState, kNoState, kNoState };
+
+			bool Has(const TokenCategory category) const { return mState[static_cast<size_t>(category)] != kNoState; }
+			uint32_t GetLength(const TokenCategory category) const { return mLength[static_cast<size_t>(category)]; }
+		};
+
+		explicit ASTLexer(const RegistryList& registries);
+
+		// true while none of the registries changed since the lexer was built
+		bool IsCurrent(const RegistryList& registries) const;
+
+		Match Scan(std::string_view expression, const size_t offset) const;
+
+		// first registered symbol of the category at the longest match, or nullptr
+		const Symbol* GetSymbol(const Match& match, const TokenCategory category) const;
+
+		// first operator at the longest operator match; binary operators are skipped unless allowed
+		const Operator* GetOperator(const Match& match, const bool allowBinary) const;
+
+		// the interned variable of the longest custom symbol match; mSymbol is null without one
+		InternedSymbol GetVariable(const Match& match) const;
+
+		size_t GetStateCount() const { return mStates.size(); }
+
+	private:
+		struct Accept
+		{
+			const Symbol* mSymbol = nullptr;
+			const Operator* mOperator = nullptr; // set for the operator category
+			InternedSymbol mVariable = {}; // set for the custom symbol category
+			TokenCategory mCategory = TokenCategory::Count;
+		};
+
+		struct State
+		{
+			uint32_t mEdgeBegin = 0;
+			uint32_t mAcceptBegin = 0;
+			uint16_t mEdgeCount = 0;
+			uint16_t mAcceptCount = 0;
+			uint8_t mCategoryMask = 0;
+		};
+
+		struct Entry
+		{
+			std::string_view mText;
+			Accept mAccept;
+			size_t mOrder = 0;
+		};
+
+		uint32_t BuildState(const std::vector<Entry>& entries, size_t begin, const size_t end, const size_t depth);
+
+		std::array<uint32_t, 256> mFirstByte = {}; // root transitions, kNoState when absent
+		std::vector<State> mStates = {};
+		std::vector<unsigned char> mEdgeBytes = {};
+		std::vector<uint32_t> mEdgeTargets = {};
+		std::vector<Accept> mAccepts = {};
+
+		RegistryList mRegistries = {};
+		std::array<uint64_t, kCategoryCount> mVersions = {};
+	};
+}
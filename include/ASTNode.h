@@ -1,8 +1,12 @@
 #pragma once
 #include <vector>
+#include <memory_resource>
+#include <atomic>
+#include <cstdint>
 
 #include "DataTypes/Rational.h"
 #include "DataTypes/Symbol.h"
+#include "DataTypes/SymbolInterner.h"
 #include "DataTypes/Operator.h"
 #include "DataTypes/Irrational.h"
 #include "DataTypes/Parenthesis.h"
@@ -22,7 +26,22 @@ namespace AST
 			Parenthesis,
 		};
 
+		// who frees the node: heap nodes are deleted by their parent,
+		// arena nodes are released together with their ASTNodeArena,
+		// shared nodes are immutable and deleted with their last reference (see ASTSharedNode)
+		enum class NodeOwnership : uint8_t
+		{
+			Heap,
+			Arena,
+			Shared,
+		};
+
 		NodeType mType = NodeType::Unknown;
+		NodeOwnership mOwnership = NodeOwnership::Heap;
+
+		// key into side tables such as ASTSourceSpans, 0 when the node has no entry;
+		// fits the padding after the fields above, so nodes do not grow
+		uint32_t mNodeId = 0;
 
 		ASTNode(const NodeType type) : mType(type) {}
 
@@ -32,10 +51,54 @@ namespace AST
 
 		virtual bool operator==(const ASTNode& other) const;
 		bool operator!=(const ASTNode& other) const { return !(*this == other); }
+
+		// Structural hash of the subtree, equal subtrees hash equal. Computed on first use and kept,
+		// so code that replaces operands of a hashed node calls InvalidateHash on it and its ancestors.
+		uint64_t GetHash() const;
+		void InvalidateHash() const { mHash.store(0, std::memory_order_relaxed); }
+
+		// References to a shared node, held by its parents and ASTSharedNode handles.
+		// RemoveReference deletes the node with the last one.
+		ASTNode* AddReference() const;
+		void RemoveReference() const;
+		uint32_t GetReferenceCount() const { return mReferenceCount.load(std::memory_order_relaxed); }
+
+		// a copy for a new parent: shared nodes give out one more reference to themselves, others are cloned
+		ASTNode* CloneOrShare() const { return mOwnership == NodeOwnership::Shared ? AddReference() : Clone(); }
+
+	protected:
+		virtual uint64_t ComputeHash() const = 0;
+
+		// clones keep the id, so side table entries follow the copy
+		template <typename T>
+		T* CopyNodeId(T* node) const
+		{
+			node->mNodeId = mNodeId;
+			return node;
+		}
+
+	private:
+		// 0 until computed; atomic because cached trees are compared from several threads
+		mutable std::atomic<uint64_t> mHash{ 0 };
+		mutable std::atomic<uint32_t> mReferenceCount{ 0 };
+	};
+
+	// Keys unordered containers by subtree structure, e.g.
+	// std::unordered_map<const ASTNode*, T, ASTNodeHash, ASTNodeEqual>
+	struct ASTNodeHash
+	{
+		size_t operator()(const ASTNode* node) const { return static_cast<size_t>(node->GetHash()); }
+	};
+
+	struct ASTNodeEqual
+	{
+		bool operator()(const ASTNode* left, const ASTNode* right) const { return *left == *right; }
 	};
 
 	struct RationalNode : public ASTNode
 	{
+		static constexpr NodeType kType = NodeType::Rational;
+
 		Rational mValue;
 
 		RationalNode(const Rational& value)
@@ -45,14 +108,19 @@ namespace AST
 
 		virtual ASTNode* Clone() const override
 		{
-			return new RationalNode(mValue);
+			return CopyNodeId(new RationalNode(mValue));
 		}
 
 		virtual bool operator==(const ASTNode& other) const override;
+
+	protected:
+		virtual uint64_t ComputeHash() const override;
 	};
 
 	struct IrrationalNode : public ASTNode
 	{
+		static constexpr NodeType kType = NodeType::Irrational;
+
 		const Irrational* mIrrational;
 		IrrationalNode(const Symbol* symbol)
 			: mIrrational(dynamic_cast<const Irrational*>(symbol)), ASTNode(NodeType::Irrational)
@@ -61,40 +129,65 @@ namespace AST
 
 		virtual ASTNode* Clone() const override
 		{
-			return new IrrationalNode(mIrrational);
+			return CopyNodeId(new IrrationalNode(mIrrational));
 		}
 
 		virtual bool operator==(const ASTNode& other) const override;
+
+	protected:
+		virtual uint64_t ComputeHash() const override;
 	};
 
 	struct VariableNode : public ASTNode
 	{
+		static constexpr NodeType kType = NodeType::Variable;
+
+		// interned through SymbolInterner::GetDefault(), equal names share the Symbol and the id
 		const Symbol* mVariable;
+		uint32_t mId;
 		VariableNode(const Symbol* symbol)
-			: mVariable(symbol), ASTNode(NodeType::Variable)
+			: VariableNode(SymbolInterner::GetDefault().Intern(symbol->mSymbol))
+		{
+		}
+
+		VariableNode(const InternedSymbol& variable)
+			: mVariable(variable.mSymbol), mId(variable.mId), ASTNode(NodeType::Variable)
 		{
 		}
 
 		virtual ASTNode* Clone() const override
 		{
-			return new VariableNode(mVariable);
+			return CopyNodeId(new VariableNode(InternedSymbol{ mVariable, mId }));
 		}
 
 		virtual bool operator==(const ASTNode& other) const override;
+
+	protected:
+		virtual uint64_t ComputeHash() const override;
 	};
 
 	struct OperatorNode : public ASTNode
 	{
+		static constexpr NodeType kType = NodeType::Operator;
+
 		// support for unary, binary, function singular, function dual, function multiple
 		const Operator* mOperator;
-		std::vector<ASTNode*> mOperands;
-		OperatorNode(const Symbol* symbol)
-			: mOperator(dynamic_cast<const Operator*>(symbol)), ASTNode(NodeType::Operator)
+
+		// the operands of arena nodes are stored in their ASTNodeArena, of other nodes on the heap
+		std::pmr::vector<ASTNode*> mOperands;
+
+		OperatorNode(const Symbol* symbol, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: mOperator(dynamic_cast<const Operator*>(symbol)), mOperands(resource), ASTNode(NodeType::Operator)
+		{
+		}
+
+		OperatorNode(const Operator* op, const std::vector<ASTNode*>& operands, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: mOperator(op), mOperands(operands.begin(), operands.end(), resource), ASTNode(NodeType::Operator)
 		{
 		}
 
-		OperatorNode(const Operator* op, const std::vector<ASTNode*>& operands)
-			: mOperator(op), mOperands(operands), ASTNode(NodeType::Operator)
+		OperatorNode(const Operator* op, ASTNode* const* operands, const size_t operandCount, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: mOperator(op), mOperands(operands, operands + operandCount, resource), ASTNode(NodeType::Operator)
 		{
 		}
 
@@ -102,10 +195,11 @@ namespace AST
 
 		virtual ASTNode* Clone() const override
 		{
-			OperatorNode* node = new OperatorNode(mOperator);
+			// shared operands are referenced, not copied, so cloning a shared tree copies only its root
+			OperatorNode* node = CopyNodeId(new OperatorNode(mOperator));
 			for (auto& operand : mOperands)
 			{
-				node->mOperands.push_back(operand->Clone());
+				node->mOperands.push_back(operand->CloneOrShare());
 			}
 			return node;
 		}
@@ -115,17 +209,22 @@ namespace AST
 
 		virtual ASTNode* CloneWithNewOperands(const std::vector<ASTNode*>& operands) const
 		{
-			OperatorNode* node = new OperatorNode(mOperator);
+			OperatorNode* node = CopyNodeId(new OperatorNode(mOperator));
 			for (auto& operand : operands)
 			{
-				node->mOperands.push_back(operand->Clone());
+				node->mOperands.push_back(operand->CloneOrShare());
 			}
 			return node;
 		}
+
+	protected:
+		virtual uint64_t ComputeHash() const override;
 	};
 
 	struct ParenthesisNode : public ASTNode
 	{
+		static constexpr NodeType kType = NodeType::Parenthesis;
+
 		const Parenthesis* mParenthesis;
 		ParenthesisNode(const Symbol* symbol)
 			: mParenthesis(dynamic_cast<const Parenthesis*>(symbol)), ASTNode(NodeType::Parenthesis)
@@ -134,9 +233,77 @@ namespace AST
 
 		virtual ASTNode* Clone() const override
 		{
-			return new ParenthesisNode(mParenthesis);
+			return CopyNodeId(new ParenthesisNode(mParenthesis));
 		}
 
 		virtual bool operator==(const ASTNode& other) const override;
+
+	protected:
+		virtual uint64_t ComputeHash() const override;
+	};
+
+	// static_cast checked against mType instead of RTTI, null when the node has another type
+	template <typename T>
+	const T* NodeCast(const ASTNode* node)
+	{
+		return node && node->mType == T::kType ? static_cast<const T*>(node) : nullptr;
+	}
+
+	template <typename T>
+	T* NodeCast(ASTNode* node)
+	{
+		return node && node->mType == T::kType ? static_cast<T*>(node) : nullptr;
+	}
+
+	// combines lambdas into one visitor: Visit(node, Overloaded{ [](const RationalNode*) {...}, [](const auto*) {...} })
+	template <typename... Visitors>
+	struct Overloaded : Visitors...
+	{
+		using Visitors::operator()...;
 	};
-}
\ No newline at end of file
+
+	template <typename... Visitors>
+	Overloaded(Visitors...) -> Overloaded<Visitors...>;
+
+	// Calls the visitor with the node cast to its concrete type, picked by a switch on mType.
+	// Nodes of NodeType::Unknown are passed as ASTNode, every call must return the same type.
+	template <typename Visitor>
+	decltype(auto) Visit(const ASTNode* node, Visitor&& visitor)
+	{
+		switch (node->mType)
+		{
+		case ASTNode::NodeType::Rational:
+			return visitor(static_cast<const RationalNode*>(node));
+		case ASTNode::NodeType::Irrational:
+			return visitor(static_cast<const IrrationalNode*>(node));
+		case ASTNode::NodeType::Variable:
+			return visitor(static_cast<const VariableNode*>(node));
+		case ASTNode::NodeType::Operator:
+			return visitor(static_cast<const OperatorNode*>(node));
+		case ASTNode::NodeType::Parenthesis:
+			return visitor(static_cast<const ParenthesisNode*>(node));
+		default:
+			return visitor(node);
+		}
+	}
+
+	template <typename Visitor>
+	decltype(auto) Visit(ASTNode* node, Visitor&& visitor)
+	{
+		switch (node->mType)
+		{
+		case ASTNode::NodeType::Rational:
+			return visitor(static_cast<RationalNode*>(node));
+		case ASTNode::NodeType::Irrational:
+			return visitor(static_cast<IrrationalNode*>(node));
+		case ASTNode::NodeType::Variable:
+			return visitor(static_cast<VariableNode*>(node));
+		case ASTNode::NodeType::Operator:
+			return visitor(static_cast<OperatorNode*>(node));
+		case ASTNode::NodeType::Parenthesis:
+			return visitor(static_cast<ParenthesisNode*>(node));
+		default:
+			return visitor(node);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "ASTNode.h"
+
+namespace AST
+{
+	// Bump allocator for the nodes of a single expression and the operand lists of its operators.
+	// Nodes are never freed one by one and never destroyed: an arena node only refers to nodes of
+	// its own arena, so nothing it holds needs a destructor, and the whole arena is released at once.
+	class ASTNodeArena : public std::pmr::memory_resource
+	{
+	public:
+		static constexpr size_t kDefaultBlockSize = 16 * 1024;
+
+		explicit ASTNodeArena(const size_t blockSize = kDefaultBlockSize);
+		~ASTNodeArena();
+
+		ASTNodeArena(const ASTNodeArena&) = delete;
+		ASTNodeArena& operator=(const ASTNodeArena&) = delete;
+
+		template <typename T, typename... Args>
+		T* New(Args&&... args)
+		{
+			static_assert(std::is_base_of<ASTNode, T>::value, "ASTNodeArena can only allocate AST nodes.");
+
+			void* memory = Allocate(sizeof(T), alignof(T));
+			T* node = nullptr;
+			if constexpr (std::is_same<T, OperatorNode>::value)
+			{
+				node = new (memory) T(std::forward<Args>(args)..., this);
+			}
+			else
+			{
+				node = new (memory) T(std::forward<Args>(args)...);
+			}
+			node->mOwnership = ASTNode::NodeOwnership::Arena;
+			++mNodeCount;
+			return node;
+		}
+
+		// releases every node and keeps the first block for reuse
+		void Reset();
+
+		size_t GetNodeCount() const { return mNodeCount; }
+		size_t GetReservedBytes() const;
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<unsigned char[]> mData;
+			size_t mSize = 0;
+		};
+
+		void* Allocate(const size_t size, const size_t alignment);
+
+		// std::pmr::memory_resource, for operand lists; their storage is released with the arena
+		void* do_allocate(const size_t bytes, const size_t alignment) override { return Allocate(bytes, alignment); }
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		std::vector<Block> mBlocks = {};
+		size_t mNodeCount = 0;
+		size_t mBlockSize = kDefaultBlockSize;
+		size_t mBlockOffset = 0;
+	};
+
+	// Owning handle for a tree whose nodes live in an ASTNodeArena.
+	// Destroying the handle frees the whole tree at once.
+	class ASTArenaTree
+	{
+		std::unique_ptr<ASTNodeArena> mArena = nullptr;
+		ASTNode* mRoot = nullptr;
+
+	public:
+		ASTArenaTree() = default;
+		ASTArenaTree(std::unique_ptr<ASTNodeArena> arena, ASTNode* root)
+			: mArena(std::move(arena)), mRoot(root)
+		{
+		}
+
+		ASTNode* GetRoot() const { return mRoot; }
+		const ASTNodeArena* GetArena() const { return mArena.get(); }
+
+		explicit operator bool() const { return mRoot != nullptr; }
+		const ASTNode& operator*() const { return *mRoot; }
+		const ASTNode* operator->() const { return mRoot; }
+	};
+}
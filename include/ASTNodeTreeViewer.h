@@ -1,4 +1,6 @@
 #include "ASTNode.h"
+#include "ASTNodeArena.h"
+#include "ASTBuffer.h"
 #include <iostream>
 
 namespace AST
@@ -30,12 +32,16 @@ namespace AST
 	private:
 		static void UpdateLeafNodeTreeInfo(ASTNodeTreeViewer::NodeTreeInfo& outNodeTreeInfo, const std::string& symbol);
 
-		static void FormOperatorSubtree(const OperatorNode* operatorNode, ASTNodeTreeViewer::NodeTreeInfo& outNodeTreeInfo);
+		// lays out the operator symbol above the already formed operand subtrees, which it merges
+		static void FormOperatorSubtree(const std::string& symbol, std::vector<NodeTreeInfo>& childNodeTreeInfos, ASTNodeTreeViewer::NodeTreeInfo& outNodeTreeInfo);
 
 		static void PrintTreeInternal(const ASTNode* node, NodeTreeInfo& outNodeTreeInfo);
+		static void PrintTreeInternal(const ASTBuffer& buffer, const ASTBuffer::NodeIndex index, NodeTreeInfo& outNodeTreeInfo);
 
 	public:
 		static std::string PrintTree(const ASTNode* node);
+		static std::string PrintTree(const ASTArenaTree& tree);
+		static std::string PrintTree(const ASTBuffer& buffer);
 	};
 
 	std::ostream& operator<<(std::ostream& os, const ASTNodeTreeViewer::NodeTreeInfo& nodeTreeInfo);
@@ -0,0 +1,69 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "ASTParser.h"
+
+namespace AST
+{
+	// Bounded LRU cache of parsed trees, keyed by the normalized expression text
+	// and the parser's settings fingerprint. Registering or unregistering a symbol
+	// changes the fingerprint, so trees parsed with the old grammar are never returned
+	// again and age out of the cache.
+	class ASTParseCache
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t mHits = 0;
+			uint64_t mMisses = 0;
+			uint64_t mEvictions = 0;
+		};
+
+		explicit ASTParseCache(const size_t capacity = 4096, const size_t shardCount = 16);
+
+		ASTParseCache(const ASTParseCache&) = delete;
+		ASTParseCache& operator=(const ASTParseCache&) = delete;
+
+		// Thread-safe as long as every thread passes its own parser.
+		// Returned trees are shared and must not be modified; null when the expression is invalid.
+		std::shared_ptr<const ASTNode> Parse(ASTParser& parser, std::string_view expression);
+
+		Statistics GetStatistics() const;
+		size_t GetSize() const;
+		void Clear();
+
+		// trims the ends and collapses runs of spaces, which never changes the parse
+		static void NormalizeExpression(std::string_view expression, std::string& outText);
+
+	private:
+		struct Entry
+		{
+			std::string mText;
+			uint64_t mFingerprint = 0;
+			std::shared_ptr<const ASTNode> mRoot = nullptr;
+		};
+
+		struct Shard
+		{
+			mutable std::mutex mMutex;
+			std::list<Entry> mEntries; // most recently used first
+			std::unordered_multimap<std::string_view, std::list<Entry>::iterator> mIndex; // keys view Entry::mText
+		};
+
+		std::list<Entry>::iterator Find(Shard& shard, std::string_view text, const uint64_t fingerprint);
+
+		std::unique_ptr<Shard[]> mShards;
+		size_t mShardCount = 1;
+		size_t mShardCapacity = 1;
+
+		std::atomic<uint64_t> mHits = { 0 };
+		std::atomic<uint64_t> mMisses = { 0 };
+		std::atomic<uint64_t> mEvictions = { 0 };
+	};
+}
@@ -1,5 +1,8 @@
 #pragma once
-#include <deque>
+#include <vector>
+#include <array>
+#include <string_view>
+#include <unordered_map>
 
 #include "DataTypes/Rational.h"
 #include "DataTypes/Symbol.h"
@@ -7,6 +10,14 @@
 #include "DataTypes/Irrational.h"
 #include "DataTypes/Parenthesis.h"
 #include "ASTNode.h"
+#include "ASTNodeArena.h"
+#include "ASTLexer.h"
+#include "ASTWorkerPool.h"
+#include "ASTPostfix.h"
+#include "ASTInputScan.h"
+#include "ASTSimplifier.h"
+#include "ASTIngest.h"
+#include "ASTSourceSpans.h"
 
 #include <functional>
 
@@ -15,16 +26,39 @@ namespace AST
 	struct ASTNode;
 	struct OperatorNode;
 
+	// how ASTParser turns tokens into a tree
+	enum class ParserEngine : uint8_t
+	{
+		ShuntingYard, // operator and operand stacks, also used for postfix output and incremental parsing
+		PrecedenceClimbing, // recursive descent, adds argument lists for FunctionDual and FunctionMultiple, see OperatorRegistry::GetArgumentListRegistry
+	};
+
 	struct ASTParserSettings
 	{
 		OperatorRegistry* mOperatorRegistry = OperatorRegistry::GetDefaultRegistry();
 		IrrationalRegistry* mIrrationalRegistry = IrrationalRegistry::GetDefaultRegistry();
 		ParenthesisRegistry* mParenthesisRegistry = ParenthesisRegistry::GetDefaultRegistry();
-		SymbolRegistry* mCustomSymbolRegistry = nullptr;
+		SymbolRegistry* mCustomSymbolRegistry = nullptr; // created by the first ASTParser::RegisterCustomSymbol when null
 		bool mMatchExactParenthesis = true;
 		bool mImplicitOperatorInsertion = true;
 		std::shared_ptr<Operator> mImplicitOperator = nullptr;
 
+		// rejects control characters and unbalanced parentheses in one vectorized pass before any node is allocated
+		bool mPreValidateInput = false;
+
+		// Folds +, -, * and / of two literals into one literal while parsing, with exact Rational arithmetic.
+		// Results that would overflow and divisions by zero are kept as operators. Not applied by ASTIncrementalParser.
+		bool mFoldConstants = false;
+
+		ParserEngine mEngine = ParserEngine::ShuntingYard;
+		char mArgumentSeparator = ','; // between the arguments of FunctionDual and FunctionMultiple
+
+		// Limits for untrusted input, 0 for none. A parse that exceeds one fails with ResultType::ResourceLimitExceeded
+		// before it reads the input, allocates more nodes or recurses any deeper.
+		size_t mMaxInputLength = 0;
+		size_t mMaxNodeCount = 0;
+		size_t mMaxDepth = 0; // of the tree, and of parentheses nested in each other
+
 		ASTParserSettings();
 	};
 
@@ -40,12 +74,39 @@ namespace AST
 			InvalidParenthesis,
 			InvalidExpression,
 			EmptyExpression,
+			ResourceLimitExceeded, // one of the limits of ASTParserSettings
+		};
+
+		// outcome of parsing one whole expression
+		struct ParsedExpression
+		{
+			ASTNode* mRoot = nullptr; // owned by the caller
+			size_t mErrorPos = -1;
+			ResultType mErrorType = ResultType::NoError;
+
+			operator bool() const { return mErrorType == ResultType::NoError; }
+		};
+
+		// outcome of ParseProgram; every node, shared or not, is owned by the arena of mTree
+		struct ParsedProgram
+		{
+			ASTArenaTree mTree;
+			size_t mErrorPos = -1;
+			ResultType mErrorType = ResultType::NoError;
+
+			operator bool() const { return mErrorType == ResultType::NoError; }
 		};
 #ifndef UNIT_TEST
 	private:
 #endif
 		ASTParserSettings mSettings;
 
+		// compiled from the registries in mSettings, rebuilt lazily when one of them changes
+		std::shared_ptr<const ASTLexer> mLexer = nullptr;
+
+		// the custom symbol registry this parser created, shared with its copies
+		std::shared_ptr<SymbolRegistry> mOwnedCustomSymbolRegistry = nullptr;
+
 		struct ParseResult
 		{
 			size_t mExtractedLength = 0;
@@ -85,6 +146,9 @@ namespace AST
 					case ResultType::EmptyExpression:
 						os << "Empty expression";
 						break;
+					case ResultType::ResourceLimitExceeded:
+						os << "Resource limit exceeded";
+						break;
 					default:
 						os << "Unknown error";
 						break;
@@ -100,30 +164,282 @@ namespace AST
 
 		/// <summary>
 		/// This function extracts a valid number from the expression.
+		/// The expression is only viewed, tokens are offset/length pairs into the caller's buffer.
 		/// </summary>
 		/// <param name="expression">expression to extract the number from</param>
+		/// <param name="scan">bitmaps of the validated expression, lets digit runs be skipped at once</param>
 		/// <returns>ParseResult object containing the extracted length and error information</returns>
-		ParseResult ExtractRational(const std::string& expression, const size_t& offset = 0);
+		ParseResult ExtractRational(std::string_view expression, const size_t& offset = 0, const ASTInputScan* scan = nullptr);
+
+		// converts the literal found by ExtractRational in place, without copying it out of the expression;
+		// false when the literal does not fit a Rational
+		bool ParseRational(std::string_view expression, const size_t& offset, const size_t& extractedLength, Rational& outValue);
+
+		ASTLexer::RegistryList GetRegistries() const;
+		const ASTLexer& GetLexer();
+
+		ParseResult ResolveSymbol(const ASTLexer::Match& match, const TokenCategory category);
+
+		ParseResult ResolveOperator(const ASTLexer::Match& match, const ASTNode::NodeType& lastNodeType);
+
+		ParseResult ExtractOperator(std::string_view expression, const ASTNode::NodeType& lastNodeType, const size_t& offset = 0);
+
+		ParseResult ExtractIrrational(std::string_view expression, const size_t& offset = 0);
+
+		ParseResult ExtractParenthesis(std::string_view expression, const size_t& offset = 0);
+
+		ParseResult ExtractCustomSymbol(std::string_view expression, const size_t& offset = 0);
+
+		ParseResult ExtractUnknownVariable(std::string_view expression, const size_t& offset = 0);
+
+		// unknown variables are single characters, interned on first use
+		std::array<InternedSymbol, 256> mUnknownVariables = {};
+
+		const InternedSymbol& GetUnknownVariable(const char c);
+
+		// an operator or opening parenthesis waiting on the operator stack;
+		// operator nodes are only created once their operands are known
+		struct PendingOperator
+		{
+			const Operator* mOperator = nullptr; // null for an opening parenthesis
+			const Parenthesis* mParenthesis = nullptr;
+			size_t mPos = 0;
+			size_t mOperandBase = 0; // operands below this index are out of reach
+		};
+
+		// a matched parenthesis pair and the subtree of its content
+		struct ParenthesisGroup
+		{
+			size_t mBegin = 0; // opening parenthesis
+			size_t mContentBegin = 0;
+			size_t mContentEnd = 0; // closing parenthesis
+			size_t mEnd = 0;
+			ASTNode* mNode = nullptr;
+		};
+
+		// state of a single Parse call
+		struct ParseContext
+		{
+			std::vector<ASTNode*> mOperandStack;
+			std::vector<PendingOperator> mOperatorStack;
+			ASTNodeArena* mArena = nullptr; // nodes are heap allocated when null
+
+			// the last token decides between unary and binary operators and implicit insertion
+			ASTNode::NodeType mLastType = ASTNode::NodeType::Unknown;
+			bool mLastIsOpenParenthesis = false;
+
+			// first operand of the innermost open parenthesis
+			size_t mGroupBase = 0;
+
+			std::vector<ParenthesisGroup>* mGroups = nullptr; // every matched pair is recorded when set
+
+			// written instead of nodes when set; the operand stack then only holds placeholders
+			ASTPostfix* mPostfix = nullptr;
+
+			// set when the input was pre-validated
+			const ASTInputScan* mInputScan = nullptr;
+
+			// operators are simplified as they are reduced when set, nodes must be heap allocated
+			const ASTSimplifier* mSimplifier = nullptr;
+			size_t mSimplifySteps = 0; // rule applications, against the mMaxSteps of mSimplifier
+
+			// Subtrees bound by ParseProgram with the SymbolInterner id of their name, used in place of their
+			// variable. Searched, a program binds a few names while ids count every name of the process.
+			const std::vector<std::pair<uint32_t, ASTNode*>>* mBindings = nullptr;
+
+			ASTNode* GetBinding(const uint32_t id) const;
+
+			// offsets of the created nodes are recorded when set
+			ASTSourceSpans* mSpans = nullptr;
+
+			// no-op without a span table
+			void RecordSpan(ASTNode* node, const SourceSpan& span) const;
+
+			// the operator token and every operand
+			SourceSpan GetOperatorSpan(const Operator* op, const size_t pos, ASTNode* const* operands, const size_t operandCount) const;
+
+			size_t mErrorPos = -1;
+			ResultType mErrorType = ResultType::NoError;
 
-		Rational ParseRational(const std::string& expression, const size_t& offset, const size_t& mExtractedLength);
+			// checked against the limits of ASTParserSettings
+			mutable size_t mNodeCount = 0;
+			size_t mParenthesisDepth = 0;
 
-		ParseResult ExtractSymbol(const SymbolRegistry* symbolRegistry, const std::string& expression, const std::function<bool(const std::shared_ptr<Symbol>&)>& findFirstMatch, const size_t& offset = 0);
+			// Depths of the operand stack entries, kept by the shunting-yard and ingest under a depth limit.
+			// Leaves pushed since the last reduce have no entry yet.
+			std::vector<uint32_t> mOperandDepths;
 
-		ParseResult ExtractOperator(const std::string& expression, const ASTNode::NodeType& lastNodeType, const size_t& offset = 0);
+			// depth of the subtree completed last
+			uint32_t mNodeDepth = 1;
 
-		ParseResult ExtractIrrational(const std::string& expression, const size_t& offset = 0);
+			// depths of the subtrees bound by ParseProgram, which are leaves of the expressions using them
+			const std::unordered_map<const ASTNode*, uint32_t>* mBindingDepths = nullptr;
 
-		ParseResult ExtractParenthesis(const std::string& expression, const size_t& offset = 0);
+			uint32_t GetLeafDepth(const ASTNode* node) const;
 
-		ParseResult ExtractCustomSymbol(const std::string& expression, const size_t& offset = 0);
+			// replaces the depths of the top operandCount operands by the depth of their operator, which is returned
+			uint32_t ReduceOperandDepths(const size_t operandCount);
 
-		ParseResult ExtractUnknownVariable(const std::string& expression, const size_t& offset = 0);
+			template <typename T, typename... Args>
+			T* NewNode(Args&&... args) const
+			{
+				++mNodeCount;
+				if (mArena)
+				{
+					return mArena->New<T>(std::forward<Args>(args)...);
+				}
+				return new T(std::forward<Args>(args)...);
+			}
+
+			void PushOperand(ASTNode* node);
+			void PushRational(const Rational& value);
+			void PushIrrational(const Symbol* irrational);
+			void PushVariable(const InternedSymbol& variable);
+
+			// records the first error and returns false so callers can bail out with it
+			bool Fail(const size_t pos, const ResultType type);
+
+			// frees the partial trees left on the operand stack
+			void ReleaseOperands();
+
+			// frees a partial tree that is not on the operand stack
+			void ReleaseNode(ASTNode* node) const;
+		};
+
+		// first step of every parse when mPreValidateInput is set
+		bool PreValidate(std::string_view expression, ParseContext& context);
+
+		// false, with ResourceLimitExceeded at pos, once the nodes allocated or the given depth pass the limits
+		bool CheckLimits(ParseContext& context, const size_t depth, const size_t pos) const;
+
+		bool HasResourceLimits() const { return mSettings.mMaxInputLength || mSettings.mMaxNodeCount || mSettings.mMaxDepth; }
+
+		bool ReduceOperator(ParseContext& context);
+
+		// The operator node, or what the context's simplifier turns it into; pos is the operator token.
+		// The operands are copied into the node, so they may point into the operand stack.
+		// Null once the simplifier exceeds its mMaxSteps, the operands are released then.
+		ASTNode* NewOperatorNode(ParseContext& context, const Operator* op, ASTNode* const* operands, const size_t operandCount, const size_t pos) const;
+
+		// the operator node, or the literal holding the result when mFoldConstants applies
+		ASTNode* NewBinaryNode(ParseContext& context, const Operator* op, ASTNode* left, ASTNode* right, const size_t pos) const;
 
-		void ReduceOperator(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, OperatorNode* topOperator = nullptr);
+		// false when the operation is not foldable or its result does not fit a Rational
+		static bool FoldConstants(const Operator* op, const Rational& left, const Rational& right, Rational& outValue);
 
-		void HandleOperatorExtraction(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, const Symbol* operatorSymbol);
+		bool HandleOperatorExtraction(ParseContext& context, const Operator* op, const size_t pos);
+
+		bool ImplicitOperatorInsertion(ParseContext& context, const size_t pos);
+
+		// literals, with their sign, are read unless the last token was a literal or a closing parenthesis
+		static bool ShouldParseRational(const ASTNode::NodeType lastType, const bool lastIsOpenParenthesis);
+
+		bool ParseTokens(std::string_view expression, ParseContext& context);
+
+		// returns null on failure, with the error recorded in the context and no node leaked
+		ASTNode* ParseInternal(std::string_view expression, ParseContext& context);
+
+		// a token read by the precedence climbing engine
+		struct ClimbToken
+		{
+			enum class Type : uint8_t
+			{
+				End,
+				Rational,
+				Irrational,
+				Variable,
+				Operator,
+				Parenthesis,
+				Separator,
+			};
+
+			Type mType = Type::End;
+			size_t mPos = 0;
+			size_t mLength = 0;
+			const Symbol* mSymbol = nullptr; // operators, irrationals and parentheses
+			InternedSymbol mVariable = {};
+			Rational mValue;
+		};
+
+		// one token of lookahead over the expression of a precedence climbing parse
+		struct ClimbState
+		{
+			std::string_view mExpression;
+			size_t mOffset = 0;
+			ClimbToken mToken;
+			bool mHasToken = false;
+
+			size_t mLastOperatorPos = -1;
+			size_t mGroupPos = -1; // innermost open parenthesis
+
+			size_t mRecursionDepth = 0;
+		};
 
-		void ImplicitOperatorInsertion(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, const ASTNode* lastNode);
+		// bounds the native recursion of a precedence climbing parse when mMaxDepth does not
+		static constexpr size_t kMaxClimbingRecursion = 4096;
+
+		// classifies the next token exactly like ParseTokens does; false on an invalid literal
+		bool PeekClimbToken(ClimbState& state, ParseContext& context);
+		void ConsumeClimbToken(ClimbState& state, ParseContext& context);
+
+		// Precedence climbing: operators of at least minPrecedence are folded into the left operand,
+		// equal precedence groups by the associativity of the operator like the shunting-yard engine. Recursion depth grows
+		// with nesting and is bounded by mMaxDepth, or by kMaxClimbingRecursion without one; the depth of the returned subtree is left in context.mNodeDepth.
+		ASTNode* ParseClimbingExpression(ClimbState& state, ParseContext& context, const uint32_t minPrecedence);
+		ASTNode* ParseClimbingOperators(ClimbState& state, ParseContext& context, const uint32_t minPrecedence);
+		ASTNode* ParseClimbingOperand(ClimbState& state, ParseContext& context);
+		ASTNode* ParseArgumentList(ClimbState& state, ParseContext& context, const Operator* function, const size_t pos);
+
+		// false when the group around the current token is not closed by the next one
+		bool ParseClosingParenthesis(ClimbState& state, ParseContext& context, const Parenthesis* open, const size_t openPos);
+
+		ASTNode* ParseClimbing(std::string_view expression, ParseContext& context);
+
+		// false when the name would not be read back as this variable inside an expression
+		bool ParseBindingName(std::string_view name, InternedSymbol& outVariable);
+
+		// operators and irrationals by id, looked up once per ingest call
+		struct IngestTables
+		{
+			std::array<const Operator*, 256> mOperators = {};
+			std::array<bool, 256> mHasOperator = {};
+			std::array<const Irrational*, 256> mIrrationals = {};
+			bool mHasIrrationals = false;
+		};
+
+		const Operator* GetIngestOperator(IngestTables& tables, const uint8_t operationId) const;
+		const Irrational* GetIngestIrrational(IngestTables& tables, const uint8_t irrationalId) const;
+
+		// Replaces the operands on top of the stack with the operator node. Operands read right to left,
+		// as in prefix order, are on the stack in reverse. operandCount is 0 when the input gave none.
+		bool IngestOperator(ParseContext& context, const Operator* op, size_t operandCount, const size_t pos, const bool reversed);
+
+		bool IngestTextToken(ParseContext& context, IngestTables& tables, std::string_view token, const size_t pos, const bool reversed);
+
+		// a top-level term of ParseParallel, between two split operators
+		struct ParallelTerm
+		{
+			size_t mBegin = 0;
+			size_t mEnd = 0;
+			ASTNode* mRoot = nullptr;
+			ASTNode::NodeType mLastType = ASTNode::NodeType::Unknown;
+			bool mLastIsOpenParenthesis = false;
+			const Operator* mNextOperator = nullptr; // the operator joining the next term
+			bool mDirty = false; // merged, waiting to be parsed again
+			bool mRetried = false; // failed once and was merged, is not merged again
+		};
+
+		// Bytes of the operators an expression may be split at: single-byte, left associative
+		// binary operators of the lowest precedence that no other symbol contains.
+		// False when the grammar cannot be split safely, e.g. with multi-byte parentheses.
+		bool GetSplitBytes(std::array<bool, 256>& outSplitBytes, std::array<int8_t, 256>& outDepthDelta) const;
+
+		void ParseTerm(std::string_view expression, ParallelTerm& term);
+
+		// the operator the sequential parse reads right after the term, when it is a split operator
+		const Operator* GetSplitOperator(std::string_view expression, const ParallelTerm& term, const std::array<bool, 256>& splitBytes);
+
+		friend class ASTIncrementalParser;
 
 	public:
 		ASTParser(const ASTParserSettings& settings = ASTParserSettings())
@@ -136,7 +452,49 @@ namespace AST
 		ASTParser& operator=(const ASTParser&) = default;
 		virtual ~ASTParser() = default;
 
-		ASTNode* Parse(const std::string& expression);
+		// null when the expression is invalid, use TryParse for the reason
+		ASTNode* Parse(std::string_view expression);
+
+		// Never throws; malformed input costs about as much as a successful parse.
+		ParsedExpression TryParse(std::string_view expression) noexcept;
+
+		// Writes the expression to outPostfix in postfix order without allocating any node.
+		// outPostfix is cleared first, reusing it across calls keeps its buffers.
+		ParsedExpression ParseToPostfix(std::string_view expression, ASTPostfix& outPostfix) noexcept;
+
+		// Parses one long expression on the pool's workers by splitting it at top-level operators
+		// of the lowest precedence; the result is identical to TryParse. Shorter inputs and
+		// grammars that cannot be split safely are parsed sequentially.
+		ParsedExpression ParseParallel(std::string_view expression, ASTWorkerPool& pool = ASTWorkerPool::GetDefault(), const size_t minParallelLength = 1 << 16);
+
+		// Parses and simplifies in one pass: each operator is simplified as soon as it is reduced,
+		// so no second tree is cloned. The result equals simplifier.Simplify(Parse(expression)).
+		ParsedExpression ParseAndSimplify(std::string_view expression, const ASTSimplifier& simplifier = ASTSimplifier::GetDefault());
+
+		// Records the source offsets of every node into outSpans, which ASTSimplifier::Simplify
+		// can carry over to its result. Operators span their token and operands, parentheses
+		// widen the span of their content.
+		ParsedExpression ParseWithSpans(std::string_view expression, ASTSourceSpans& outSpans);
+
+		// Parses into a private arena; the returned handle frees the whole tree at once.
+		ASTArenaTree ParseToArena(std::string_view expression, const size_t blockSize = ASTNodeArena::kDefaultBlockSize);
+
+		// Parses "a = x + 1; b = a*a + a; b": statements are separated by ';', all but the last bind a
+		// variable name to an expression, and the last one is the result. Every use of a bound name
+		// points at the one subtree of its binding, so the result is a DAG living in a single arena.
+		ParsedProgram ParseProgram(std::string_view program, const size_t blockSize = ASTNodeArena::kDefaultBlockSize);
+
+		// Read the machine-written formats described in ASTIngest.h in a single linear pass.
+		// Error positions are character offsets for text and byte offsets for binary input.
+		ParsedExpression IngestText(std::string_view text, const IngestOrder order = IngestOrder::Postfix);
+		ParsedExpression IngestBinary(std::string_view data);
+
+		// Parses independent expressions on the pool's workers; results keep the input order.
+		// Every worker parses with its own copy of this parser, the registries are shared read-only.
+		std::vector<ParsedExpression> ParseBatch(const std::vector<std::string_view>& expressions, ASTWorkerPool& pool = ASTWorkerPool::GetDefault());
+
+		// changes whenever the grammar does: registries, their versions and the parse options
+		uint64_t GetSettingsFingerprint() const;
 
 		void RegisterCustomSymbol(const std::string& symbol);
 		void UnregisterCustomSymbol(const std::string& symbol);
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "DataTypes/Rational.h"
+#include "DataTypes/Symbol.h"
+#include "DataTypes/Operator.h"
+#include "DataTypes/SymbolInterner.h"
+
+namespace AST
+{
+	struct ASTNode;
+
+	enum class PostfixOpcode : uint8_t
+	{
+		Rational,
+		Irrational,
+		Variable,
+		Operator,
+	};
+
+	struct PostfixInstruction
+	{
+		PostfixOpcode mOpcode = PostfixOpcode::Rational;
+		uint32_t mSymbolId = 0; // variables: SymbolInterner id, operators and irrationals: index into mSymbols
+		uint32_t mLiteralIndex = 0; // rationals: index into mLiterals
+
+		bool operator==(const PostfixInstruction& other) const
+		{
+			return mOpcode == other.mOpcode && mSymbolId == other.mSymbolId && mLiteralIndex == other.mLiteralIndex;
+		}
+	};
+
+	// An expression in postfix order, written by the parser without building nodes.
+	// Operators pop as many operands as their OperatorType takes.
+	struct ASTPostfix
+	{
+		std::vector<PostfixInstruction> mInstructions = {};
+		std::vector<Rational> mLiterals = {};
+		std::vector<const Symbol*> mSymbols = {}; // each symbol once, in order of first use
+		std::unordered_map<const Symbol*, uint32_t> mSymbolIndices = {};
+
+		void PushRational(const Rational& value);
+		void PushIrrational(const Symbol* irrational);
+		void PushVariable(const InternedSymbol& variable);
+		void PushOperator(const Operator* op);
+
+		// keeps the capacity so a reused postfix does not allocate
+		void Clear();
+
+		// the same expression parsed with the same registries gives equal postfix
+		bool operator==(const ASTPostfix& other) const;
+		bool operator!=(const ASTPostfix& other) const { return !(*this == other); }
+
+		// builds the equivalent heap tree; null when the postfix is empty or malformed
+		ASTNode* ToTree() const;
+
+		static size_t GetOperandCount(const OperatorType type);
+
+	private:
+		uint32_t AddSymbol(const Symbol* symbol);
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "ASTNode.h"
+
+namespace AST
+{
+	// Holds one reference to an immutable NodeOwnership::Shared tree. Copying a handle is O(1), and
+	// versions of a formula made with the functions below share every subtree they did not change,
+	// so a set of variants takes memory in proportion to their differences.
+	class ASTSharedNode
+	{
+		const ASTNode* mNode = nullptr;
+
+		explicit ASTSharedNode(const ASTNode* node) : mNode(node) {}
+
+	public:
+		ASTSharedNode() = default;
+		ASTSharedNode(const ASTSharedNode& other) : mNode(other.mNode ? other.mNode->AddReference() : nullptr) {}
+		ASTSharedNode(ASTSharedNode&& other) noexcept : mNode(other.mNode) { other.mNode = nullptr; }
+		~ASTSharedNode() { Reset(); }
+
+		ASTSharedNode& operator=(ASTSharedNode other) noexcept
+		{
+			std::swap(mNode, other.mNode);
+			return *this;
+		}
+
+		// Takes a heap tree: its heap nodes become shared in place, without copies, and shared
+		// subtrees in it keep the reference it holds. Null gives an empty handle.
+		static ASTSharedNode Adopt(ASTNode* tree);
+
+		// one more reference to a node that is shared already, e.g. an operand of a shared tree
+		static ASTSharedNode Share(const ASTNode* node);
+
+		const ASTNode* Get() const { return mNode; }
+		const ASTNode* operator->() const { return mNode; }
+		const ASTNode& operator*() const { return *mNode; }
+		explicit operator bool() const { return mNode != nullptr; }
+
+		// gives up the reference without releasing it, e.g. to a new parent
+		const ASTNode* Detach();
+		void Reset();
+	};
+
+	// A copy of root with the subtree at operandPath, a list of operand indices, replaced.
+	// Only the nodes on the path are copied. Empty when the path does not exist.
+	ASTSharedNode ReplaceSubtree(const ASTSharedNode& root, const std::vector<size_t>& operandPath, const ASTSharedNode& replacement);
+
+	// A copy of root with every use of the variable replaced, copying only the paths to them.
+	ASTSharedNode SubstituteVariable(const ASTSharedNode& root, const uint32_t variableId, const ASTSharedNode& replacement);
+}
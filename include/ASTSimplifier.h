@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
+#include <array>
 #include <unordered_map>
+#include <memory>
 #include "DataTypes/Rational.h"
 #include "DataTypes/Operation.h"
 #include "DataTypes/Operator.h"
@@ -11,6 +13,11 @@ namespace AST
 	struct RationalNode;
 	struct OperatorNode;
 	class ASTSimplifier;
+	class ASTArenaTree;
+	class ASTNodeArena;
+	class ASTSourceSpans;
+	class ASTBuffer;
+	class ASTSharedNode;
 
 	struct SimplifyCheckResult
 	{
@@ -36,21 +43,27 @@ namespace AST
 	{
 		int32_t mPriority = 0; // lower is higher priority
 		ISimplifyRule(const int32_t priority) : mPriority(priority) {}
+		virtual ~ISimplifyRule() = default;
 
 		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const = 0;
 		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const = 0;
+
+		// A node of the operands, or under them, that the result holds: the node itself when the caller
+		// frees the operands after the rule, a copy otherwise. Only for a successful result, and not
+		// for a node inside another kept one.
+		static ASTNode* Keep(ASTNode* node);
 	};
 
 	struct OrderedSimplifyRuleList
 	{
 	private:
-		std::vector<ISimplifyRule*> mRules = {};
+		std::vector<std::unique_ptr<ISimplifyRule>> mRules = {};
 
 	public:
-		void AddRule(ISimplifyRule* rule);
+		void AddRule(std::unique_ptr<ISimplifyRule> rule);
 
-		using Iterator = std::vector<ISimplifyRule*>::iterator;
-		using ConstIterator = std::vector<ISimplifyRule*>::const_iterator;
+		using Iterator = std::vector<std::unique_ptr<ISimplifyRule>>::iterator;
+		using ConstIterator = std::vector<std::unique_ptr<ISimplifyRule>>::const_iterator;
 
 		Iterator begin() { return mRules.begin(); }
 		Iterator end() { return mRules.end(); }
@@ -62,6 +75,11 @@ namespace AST
 	{
 		OperatorRegistry* mOperatorRegistry = OperatorRegistry::GetDefaultRegistry();
 
+		// Limits for untrusted trees, 0 for none. Simplify returns null once a tree is nested deeper
+		// or needs more rule applications than this.
+		size_t mMaxDepth = 0;
+		size_t mMaxSteps = 0;
+
 		ASTSimplifierSettings() = default;
 	};
 
@@ -83,15 +101,77 @@ namespace AST
 	{
 		ASTSimplifierSettings mSettings = {};
 
-		std::unordered_map<OperationId, const OperationSimplifyRule*> mSimplifyRules;
+		// indexed by OperationId, null where no rule is bound
+		std::array<const OperationSimplifyRule*, 256> mSimplifyRules = {};
+		std::vector<std::unique_ptr<OperationSimplifyRule>> mDefaultRules;
+
+		// state of a single Simplify call
+		struct SimplifyState
+		{
+			ASTSourceSpans* mSpans = nullptr;
+			size_t mDepth = 1; // of the node being simplified
+			size_t mSteps = 0;
+		};
+
+		// Counts the rule application in steps, with the operations the rule simplifies on its own.
+		// False once there were more than mMaxSteps, outResult is empty then. With outKept the caller
+		// frees the operands after the rule, so what the rule keeps of them is moved and listed there.
+		bool ApplyRule(const OperationSimplifyRule* rule, const std::vector<ASTNode*>& operands, size_t& steps, SimplifyResult& outResult,
+			std::vector<ASTNode*>* outKept = nullptr) const;
+
+		ASTNode* SimplifyShared(const ASTNode* node, ASTNodeArena& arena, std::unordered_map<const ASTNode*, ASTNode*>& simplified, SimplifyState& state) const;
+
+		ASTNode* SimplifyNode(ASTNode* node, SimplifyState& state) const;
+
+		// Takes the node, returns it or what replaces it; null and the node freed when a limit is exceeded.
+		// outModified is set when anything in the subtree changed, so the cached hashes above it are stale.
+		ASTNode* SimplifyInPlace(ASTNode* node, SimplifyState& state, bool& outModified) const;
+
+		ASTSharedNode SimplifySharedNode(const ASTSharedNode& node, SimplifyState& state) const;
 
 	public:
+		// binds the rules of the default simplifier
+		ASTSimplifier(const ASTSimplifierSettings& settings = {});
+
+		ASTSimplifier(const ASTSimplifier&) = delete;
+		ASTSimplifier& operator=(const ASTSimplifier&) = delete;
+
 		void BindSimplifyRule(const OperationId operation, const OperationSimplifyRule* rule);
 
+		// null when a limit of the settings is exceeded
 		ASTNode* Simplify(ASTNode* node) const;
 
+		// Nodes of the result that a rule built anew get the span of the operator they replace,
+		// so the spans of ASTParser::ParseWithSpans still point into the source afterwards.
+		ASTNode* Simplify(ASTNode* node, ASTSourceSpans& spans) const;
+
+		// Takes a heap tree and rewrites it in place: unchanged subtrees move into the result and only
+		// the nodes a rule replaces are freed, so allocations follow the number of rewrites.
+		// Null when a limit of the settings is exceeded, the tree is freed then.
+		std::unique_ptr<ASTNode> Simplify(std::unique_ptr<ASTNode> node) const;
+
+		// For ASTSharedNode versions: subtrees no rule changes are shared with the input, only the
+		// paths to rewritten nodes are copied. Empty when a limit of the settings is exceeded.
+		ASTSharedNode Simplify(const ASTSharedNode& tree) const;
+
+		// reads the arena tree in place; the result is an independent heap tree
+		ASTNode* Simplify(const ASTArenaTree& tree) const;
+
+		// For DAGs such as ASTParser::ParseProgram results: each distinct node is simplified once
+		// and stays shared in the result, which lives in an arena of its own. Empty when a limit is exceeded.
+		ASTArenaTree SimplifyShared(const ASTArenaTree& tree) const;
+
+		// Walks the buffer in its post-order without building the tree; only the operands of an
+		// operation that has a rule are materialized for the rule. Empty when a limit is exceeded.
+		ASTBuffer Simplify(const ASTBuffer& buffer) const;
+
+		// inside a rule the application counts against the steps of the Simplify call running the rule
 		SimplifyResult SimplifyOperation(const OperationId operation, const std::vector<ASTNode*>& operands) const;
 
+		// For callers applying operations one at a time: steps counts the rule applications across calls.
+		// False once there were more than mMaxSteps, outResult is empty then.
+		bool SimplifyOperation(const OperationId operation, const std::vector<ASTNode*>& operands, size_t& steps, SimplifyResult& outResult) const;
+
 		const ASTSimplifierSettings& GetSettings() const { return mSettings; }
 
 		static const ASTSimplifier& GetDefault();
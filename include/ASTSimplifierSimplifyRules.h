@@ -4,7 +4,8 @@ namespace AST
 {
 	struct AdditionSimplifyRule : public OperationSimplifyRule
 	{
-		ASTNode* CombineCommonTerms(const ASTNode* left, const ASTNode* right, const ASTNode* common);
+		// takes the terms, they end up in the result or are freed
+		ASTNode* CombineCommonTerms(ASTNode* left, ASTNode* right, ASTNode* common);
 		AdditionSimplifyRule(ASTSimplifier* simplifier);
 	};
 
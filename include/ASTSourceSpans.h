@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "ASTNode.h"
+
+namespace AST
+{
+	// [mBegin, mEnd) offsets into the parsed expression
+	struct SourceSpan
+	{
+		size_t mBegin = 0;
+		size_t mEnd = 0;
+	};
+
+	// Source offsets of nodes, kept next to the tree rather than in it, so nodes stay small and
+	// parses that do not ask for spans pay nothing. Entries are found through ASTNode::mNodeId,
+	// which Record assigns and Clone keeps. A node holds a single id, so a tree records its
+	// spans into one table.
+	class ASTSourceSpans
+	{
+		std::vector<SourceSpan> mSpans; // indexed by node id - 1
+
+	public:
+		// assigns the node an id when it has none of this table, otherwise replaces the span of its id
+		void Record(ASTNode* node, const SourceSpan& span);
+
+		// null when the node has no span in this table
+		const SourceSpan* Find(const ASTNode* node) const;
+
+		// Nodes under result without a span share the entry of source. Subtrees that have one,
+		// such as clones of recorded nodes, keep theirs.
+		void Propagate(const ASTNode* source, ASTNode* result);
+
+		size_t GetSize() const { return mSpans.size(); }
+		void Clear() { mSpans.clear(); }
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <cstdint>
+
+namespace AST
+{
+	// Persistent worker threads running index ranges with work stealing.
+	// Every worker owns a slice of the range and takes chunks from its front;
+	// idle workers steal the back half of another worker's slice.
+	class ASTWorkerPool
+	{
+	public:
+		// receives the worker index and a chunk [begin, end) of the range
+		using RangeTask = std::function<void(size_t workerIndex, size_t begin, size_t end)>;
+
+		// 0 threads uses the hardware concurrency
+		explicit ASTWorkerPool(size_t threadCount = 0);
+		~ASTWorkerPool();
+
+		ASTWorkerPool(const ASTWorkerPool&) = delete;
+		ASTWorkerPool& operator=(const ASTWorkerPool&) = delete;
+
+		// worker 0 is the calling thread
+		size_t GetWorkerCount() const { return mThreads.size() + 1; }
+
+		// blocks until every index in [0, count) ran; rethrows the first exception of a task
+		void ParallelFor(const size_t count, const RangeTask& task, const size_t grainSize = 16);
+
+		static ASTWorkerPool& GetDefault();
+
+	private:
+		struct WorkerRange
+		{
+			std::mutex mMutex;
+			size_t mBegin = 0;
+			size_t mEnd = 0;
+		};
+
+		void WorkerLoop(const size_t workerIndex);
+		void RunWorker(const size_t workerIndex);
+		bool TakeChunk(const size_t workerIndex, size_t& outBegin, size_t& outEnd);
+		bool StealChunk(const size_t workerIndex, size_t& outBegin, size_t& outEnd);
+
+		std::vector<std::thread> mThreads = {};
+		std::vector<std::unique_ptr<WorkerRange>> mRanges = {};
+
+		std::mutex mJobMutex;
+		std::mutex mRunMutex; // one ParallelFor at a time
+		std::condition_variable mJobStarted;
+		std::condition_variable mJobFinished;
+		const RangeTask* mTask = nullptr;
+		size_t mGrainSize = 1;
+		uint64_t mGeneration = 0;
+		size_t mActiveWorkers = 0;
+		bool mStopping = false;
+		std::exception_ptr mException = nullptr;
+	};
+}
@@ -26,6 +26,10 @@ namespace AST
 		Logarithm,         // Dual-argument function "log"
 		NaturalLogarithm,  // Singular function "ln"
 		SquareRoot,        // Singular function "sqrt"
-		AbsoluteValue      // Singular function "abs"
+		AbsoluteValue,     // Singular function "abs"
+		Sum,               // Multiple-argument function "sum"
+		Product,           // Multiple-argument function "product"
+		Minimum,           // Multiple-argument function "min"
+		Maximum            // Multiple-argument function "max"
 	};
 } // namespace AST
\ No newline at end of file
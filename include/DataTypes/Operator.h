@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include "DataTypes/Symbol.h"
 #include "DataTypes/Operation.h"
 
@@ -39,12 +40,17 @@ namespace AST
 
 	class OperatorRegistry : public SymbolRegistry
 	{
-		std::map<OperationId, std::shared_ptr<Operator>> mOperatorMap;
+		// indexed by OperationId, looked up for every operator node a simplifier builds
+		std::array<std::shared_ptr<Operator>, 256> mOperators = {};
 	public:
 		static OperatorRegistry* GetDefaultRegistry();
 
+		// the default operators plus sum, product, min and max, for ParserEngine::PrecedenceClimbing
+		static OperatorRegistry* GetArgumentListRegistry();
+
 		void RegisterOperator(const OperatorType& type, const Associativity& associativity, const uint16_t& precedence, const std::string& symbol, const OperationId& operationId);
 
-		std::shared_ptr<Operator> GetOperator(const OperationId& operationId) const;
+		// null when no operator of the id was registered
+		const std::shared_ptr<Operator>& GetOperator(const OperationId& operationId) const;
 	};
 }
\ No newline at end of file
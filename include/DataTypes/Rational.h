@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <string_view>
+#include <cstdint>
 
 namespace AST
 {
@@ -29,6 +31,12 @@ namespace AST
 		Rational& operator*=(const Rational& other);
 		Rational& operator/=(const Rational& other);
 
+		// Exact arithmetic that returns false instead of overflowing or dividing by zero.
+		bool TryAdd(const Rational& other, Rational& outValue) const;
+		bool TrySubtract(const Rational& other, Rational& outValue) const;
+		bool TryMultiply(const Rational& other, Rational& outValue) const;
+		bool TryDivide(const Rational& other, Rational& outValue) const;
+
 		Rational operator-() const;
 		bool operator==(const Rational& other) const;
 		bool operator!=(const Rational& other) const;
@@ -44,7 +52,15 @@ namespace AST
 		bool CanYieldRationalLogResult(const Rational& base) const;
 		Rational Log(const Rational& base) const;
 
+		// Reduces numerator/denominator with either sign. Returns false for a zero denominator or when the
+		// reduced value does not fit, so every int pair from untrusted input is safe to pass.
+		static bool TryFromFraction(const int64_t numerator, const int64_t denominator, Rational& outValue);
+
 		static Rational FromString(const std::string& str);
+
+		// Converts a "[+-]digits[.digits]" literal without copying it.
+		// Returns false when the value does not fit into the numerator/denominator range.
+		static bool TryFromDecimalString(std::string_view str, Rational& outValue);
 		std::string ToString() const;
 
 		explicit operator int() const;
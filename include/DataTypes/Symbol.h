@@ -3,6 +3,8 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <memory>
+#include <cstdint>
 
 namespace AST
 {
@@ -45,12 +47,24 @@ namespace AST
 	{
 	private:
 		std::shared_ptr<SymbolSearchNode> mRoot = std::make_shared<SymbolSearchNode>();
+		uint64_t mVersion = 0; // bumped on every change, lets compiled lexers detect stale tables
+		uint64_t mInstanceId = NextInstanceId(); // unique per registry, unlike its address never reused
+
+		static uint64_t NextInstanceId();
 	public:
 		SymbolRegistry() = default;
+		// copies get a trie of their own, a change through one must not alter the grammar of another
+		SymbolRegistry(const SymbolRegistry& other);
+		SymbolRegistry& operator=(const SymbolRegistry& other);
 		void RegisterSymbol(std::shared_ptr<Symbol> symbol);
 		void UnregisterSymbol(const std::string& symbol);
 
 		const std::shared_ptr<SymbolSearchNode>& GetRoot() const { return mRoot; }
+		uint64_t GetVersion() const { return mVersion; }
+		uint64_t GetInstanceId() const { return mInstanceId; }
+
+		// all registered symbols, in trie order
+		std::vector<std::shared_ptr<Symbol>> GetSymbols() const;
 
 		std::shared_ptr<Symbol> GetSymbol(const std::string& symbol, const std::function<bool(const std::shared_ptr<Symbol>&)>& findFirstMatch) const;
 	};
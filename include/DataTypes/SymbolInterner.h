@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+
+#include "DataTypes/Symbol.h"
+
+namespace AST
+{
+	// an interned name: the Symbol is shared by every use of the name
+	struct InternedSymbol
+	{
+		const Symbol* mSymbol = nullptr;
+		uint32_t mId = 0;
+	};
+
+	// Gives every variable name a stable, dense integer id.
+	// Ids start at 0 and are never reused, so evaluators can bind variables
+	// through an array of GetSize() entries instead of a string map.
+	class SymbolInterner
+	{
+	public:
+		SymbolInterner() = default;
+		SymbolInterner(const SymbolInterner&) = delete;
+		SymbolInterner& operator=(const SymbolInterner&) = delete;
+
+		// thread-safe; the returned Symbol lives as long as the interner
+		InternedSymbol Intern(std::string_view name);
+
+		const Symbol* GetSymbol(const uint32_t id) const;
+
+		size_t GetSize() const;
+
+		static SymbolInterner& GetDefault();
+
+	private:
+		mutable std::shared_mutex mMutex;
+		std::vector<std::unique_ptr<Symbol>> mSymbols = {};
+		std::unordered_map<std::string_view, uint32_t> mIds = {}; // keys view the names in mSymbols
+	};
+}
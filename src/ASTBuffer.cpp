@@ -0,0 +1,251 @@
+#include "ASTBuffer.h"
+
+namespace AST
+{
+	ASTBuffer::NodeIndex ASTBuffer::AddNode(const ASTNode::NodeType type, const uint32_t payload)
+	{
+		mTypes.push_back(type);
+		mOperationIds.push_back(OperationId::Invalid);
+		mFirstOperands.push_back(static_cast<uint32_t>(mOperands.size()));
+		mOperandCounts.push_back(0);
+		mPayloads.push_back(payload);
+		return static_cast<NodeIndex>(mTypes.size() - 1);
+	}
+
+	uint32_t ASTBuffer::AddSymbol(const Symbol* symbol)
+	{
+		auto it = mSymbolIndices.find(symbol);
+		if (it != mSymbolIndices.end())
+		{
+			return it->second;
+		}
+		uint32_t index = static_cast<uint32_t>(mSymbols.size());
+		mSymbols.push_back(symbol);
+		mSymbolIndices.emplace(symbol, index);
+		return index;
+	}
+
+	ASTBuffer ASTBuffer::FromTree(const ASTNode* root)
+	{
+		ASTBuffer buffer;
+		if (root)
+		{
+			buffer.AddTree(root);
+		}
+		return buffer;
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddRational(const Rational& value)
+	{
+		mRationals.push_back(value);
+		return AddNode(ASTNode::NodeType::Rational, static_cast<uint32_t>(mRationals.size() - 1));
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddIrrational(const Irrational* irrational)
+	{
+		return AddNode(ASTNode::NodeType::Irrational, AddSymbol(irrational));
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddVariable(const InternedSymbol& variable)
+	{
+		return AddNode(ASTNode::NodeType::Variable, variable.mId);
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddParenthesis(const Parenthesis* parenthesis)
+	{
+		return AddNode(ASTNode::NodeType::Parenthesis, AddSymbol(parenthesis));
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddOperator(const Operator* op, const std::vector<NodeIndex>& operands)
+	{
+		NodeIndex index = AddNode(ASTNode::NodeType::Operator, AddSymbol(op));
+		mOperationIds[index] = op->mOperationId;
+		mOperandCounts[index] = static_cast<uint32_t>(operands.size());
+		mOperands.insert(mOperands.end(), operands.begin(), operands.end());
+		return index;
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddTree(const ASTNode* node)
+	{
+		switch (node->mType)
+		{
+		case ASTNode::NodeType::Rational:
+			return AddRational(static_cast<const RationalNode*>(node)->mValue);
+		case ASTNode::NodeType::Irrational:
+			return AddIrrational(static_cast<const IrrationalNode*>(node)->mIrrational);
+		case ASTNode::NodeType::Variable:
+		{
+			const VariableNode* variableNode = static_cast<const VariableNode*>(node);
+			return AddVariable(InternedSymbol{ variableNode->mVariable, variableNode->mId });
+		}
+		case ASTNode::NodeType::Parenthesis:
+			return AddParenthesis(static_cast<const ParenthesisNode*>(node)->mParenthesis);
+		case ASTNode::NodeType::Operator:
+		{
+			const OperatorNode* opNode = static_cast<const OperatorNode*>(node);
+			std::vector<NodeIndex> operands;
+			operands.reserve(opNode->mOperands.size());
+			for (const ASTNode* operand : opNode->mOperands)
+			{
+				operands.push_back(AddTree(operand));
+			}
+			return AddOperator(opNode->mOperator, operands);
+		}
+		default:
+			return AddNode(ASTNode::NodeType::Unknown, 0);
+		}
+	}
+
+	ASTBuffer::NodeIndex ASTBuffer::AddSubtree(const ASTBuffer& source, const NodeIndex index)
+	{
+		switch (source.mTypes[index])
+		{
+		case ASTNode::NodeType::Rational:
+			return AddRational(source.GetRational(index));
+		case ASTNode::NodeType::Irrational:
+			return AddIrrational(source.GetIrrational(index));
+		case ASTNode::NodeType::Variable:
+			return AddNode(ASTNode::NodeType::Variable, source.mPayloads[index]);
+		case ASTNode::NodeType::Parenthesis:
+			return AddParenthesis(source.GetParenthesis(index));
+		case ASTNode::NodeType::Operator:
+		{
+			std::vector<NodeIndex> operands;
+			operands.reserve(source.mOperandCounts[index]);
+			for (size_t i = 0; i < source.mOperandCounts[index]; ++i)
+			{
+				operands.push_back(AddSubtree(source, source.GetOperand(index, i)));
+			}
+			return AddOperator(source.GetOperator(index), operands);
+		}
+		default:
+			return AddNode(ASTNode::NodeType::Unknown, 0);
+		}
+	}
+
+	ASTNode* ASTBuffer::ToTree() const
+	{
+		return IsEmpty() ? nullptr : ToTree(GetRoot());
+	}
+
+	ASTNode* ASTBuffer::ToTree(const NodeIndex index) const
+	{
+		switch (mTypes[index])
+		{
+		case ASTNode::NodeType::Rational:
+			return new RationalNode(GetRational(index));
+		case ASTNode::NodeType::Irrational:
+			return new IrrationalNode(GetIrrational(index));
+		case ASTNode::NodeType::Variable:
+			return new VariableNode(GetVariable(index));
+		case ASTNode::NodeType::Parenthesis:
+			return new ParenthesisNode(GetParenthesis(index));
+		case ASTNode::NodeType::Operator:
+		{
+			std::vector<ASTNode*> operands;
+			operands.reserve(mOperandCounts[index]);
+			for (size_t i = 0; i < mOperandCounts[index]; ++i)
+			{
+				operands.push_back(ToTree(GetOperand(index, i)));
+			}
+			return new OperatorNode(GetOperator(index), operands);
+		}
+		default:
+			return nullptr;
+		}
+	}
+
+	InternedSymbol ASTBuffer::GetVariable(const NodeIndex index) const
+	{
+		return InternedSymbol{ SymbolInterner::GetDefault().GetSymbol(mPayloads[index]), mPayloads[index] };
+	}
+
+	bool ASTBuffer::Equals(const NodeIndex index, const ASTBuffer& other, const NodeIndex otherIndex) const
+	{
+		// explicit stack, deep trees do not recurse
+		std::vector<std::pair<NodeIndex, NodeIndex>> pending = { { index, otherIndex } };
+		while (!pending.empty())
+		{
+			auto [left, right] = pending.back();
+			pending.pop_back();
+
+			if (mTypes[left] != other.mTypes[right])
+			{
+				return false;
+			}
+
+			switch (mTypes[left])
+			{
+			case ASTNode::NodeType::Rational:
+				if (GetRational(left) != other.GetRational(right))
+				{
+					return false;
+				}
+				break;
+			case ASTNode::NodeType::Irrational:
+				if (*GetIrrational(left) != *other.GetIrrational(right))
+				{
+					return false;
+				}
+				break;
+			case ASTNode::NodeType::Variable:
+				if (mPayloads[left] != other.mPayloads[right])
+				{
+					return false;
+				}
+				break;
+			case ASTNode::NodeType::Parenthesis:
+				if (GetParenthesis(left) != other.GetParenthesis(right))
+				{
+					return false;
+				}
+				break;
+			case ASTNode::NodeType::Operator:
+				if (*GetOperator(left) != *other.GetOperator(right) || mOperandCounts[left] != other.mOperandCounts[right])
+				{
+					return false;
+				}
+				for (size_t i = 0; i < mOperandCounts[left]; ++i)
+				{
+					pending.emplace_back(GetOperand(left, i), other.GetOperand(right, i));
+				}
+				break;
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ASTBuffer::operator==(const ASTBuffer& other) const
+	{
+		if (IsEmpty() || other.IsEmpty())
+		{
+			return IsEmpty() == other.IsEmpty();
+		}
+		return Equals(GetRoot(), other, other.GetRoot());
+	}
+
+	void ASTBuffer::Reserve(const size_t nodeCount)
+	{
+		mTypes.reserve(nodeCount);
+		mOperationIds.reserve(nodeCount);
+		mFirstOperands.reserve(nodeCount);
+		mOperandCounts.reserve(nodeCount);
+		mPayloads.reserve(nodeCount);
+		mOperands.reserve(nodeCount);
+	}
+
+	void ASTBuffer::Clear()
+	{
+		mTypes.clear();
+		mOperationIds.clear();
+		mFirstOperands.clear();
+		mOperandCounts.clear();
+		mPayloads.clear();
+		mOperands.clear();
+		mRationals.clear();
+		mSymbols.clear();
+		mSymbolIndices.clear();
+	}
+}
@@ -0,0 +1,204 @@
+#include "ASTExpressionReader.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace AST
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+	{
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Cannot open " + path);
+		}
+		mFileHandle = file;
+
+		LARGE_INTEGER size = {};
+		GetFileSizeEx(file, &size);
+		mSize = static_cast<size_t>(size.QuadPart);
+		if (mSize == 0)
+		{
+			return;
+		}
+
+		mMappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMappingHandle)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Cannot map " + path);
+		}
+		mData = static_cast<const char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!mData)
+		{
+			CloseHandle(mMappingHandle);
+			CloseHandle(file);
+			throw std::runtime_error("Cannot map " + path);
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (mData)
+		{
+			UnmapViewOfFile(mData);
+		}
+		if (mMappingHandle)
+		{
+			CloseHandle(mMappingHandle);
+		}
+		if (mFileHandle)
+		{
+			CloseHandle(mFileHandle);
+		}
+	}
+
+	void MappedFile::ReleaseBefore(const size_t offset)
+	{
+		// mapped views are trimmed by the working set manager on Windows
+		mReleasedOffset = std::max(mReleasedOffset, offset);
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+	{
+		mFileDescriptor = open(path.c_str(), O_RDONLY);
+		if (mFileDescriptor < 0)
+		{
+			throw std::runtime_error("Cannot open " + path);
+		}
+
+		struct stat fileStat = {};
+		if (fstat(mFileDescriptor, &fileStat) != 0)
+		{
+			close(mFileDescriptor);
+			throw std::runtime_error("Cannot stat " + path);
+		}
+		mSize = static_cast<size_t>(fileStat.st_size);
+		if (mSize == 0)
+		{
+			return;
+		}
+
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+		if (data == MAP_FAILED)
+		{
+			close(mFileDescriptor);
+			throw std::runtime_error("Cannot map " + path);
+		}
+		mData = static_cast<const char*>(data);
+		madvise(data, mSize, MADV_SEQUENTIAL);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (mData)
+		{
+			munmap(const_cast<char*>(mData), mSize);
+		}
+		if (mFileDescriptor >= 0)
+		{
+			close(mFileDescriptor);
+		}
+	}
+
+	void MappedFile::ReleaseBefore(const size_t offset)
+	{
+		if (!mData)
+		{
+			return;
+		}
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t releaseEnd = std::min(offset, mSize) / pageSize * pageSize;
+		if (releaseEnd > mReleasedOffset)
+		{
+			madvise(const_cast<char*>(mData) + mReleasedOffset, releaseEnd - mReleasedOffset, MADV_DONTNEED);
+			mReleasedOffset = releaseEnd;
+		}
+	}
+#endif
+
+	ASTExpressionReader::ASTExpressionReader(const std::string& path, const Delimiter delimiter)
+		: mFile(path), mDelimiter(delimiter)
+	{
+	}
+
+	bool ASTExpressionReader::Next(Record& outRecord)
+	{
+		const std::string_view data = mFile.GetData();
+		const char delimiter = mDelimiter == Delimiter::Newline ? '\n' : '\0';
+
+		while (mOffset < data.size())
+		{
+			const char* begin = data.data() + mOffset;
+			const char* found = static_cast<const char*>(std::memchr(begin, delimiter, data.size() - mOffset));
+			size_t length = found ? static_cast<size_t>(found - begin) : data.size() - mOffset;
+
+			outRecord.mOffset = mOffset;
+			mOffset += found ? length + 1 : length;
+
+			if (mDelimiter == Delimiter::Newline && length > 0 && begin[length - 1] == '\r')
+			{
+				--length;
+			}
+			if (length == 0)
+			{
+				continue;
+			}
+
+			outRecord.mText = std::string_view(begin, length);
+			outRecord.mIndex = mRecordIndex++;
+			return true;
+		}
+		return false;
+	}
+
+	size_t ASTExpressionReader::ParseAll(ASTParser& parser, const RecordHandler& handler, const size_t windowSize, ASTWorkerPool& pool)
+	{
+		std::vector<Record> records;
+		std::vector<std::string_view> views;
+		records.reserve(windowSize);
+		views.reserve(windowSize);
+
+		size_t recordCount = 0;
+		Record record;
+		bool hasMore = true;
+		while (hasMore)
+		{
+			records.clear();
+			views.clear();
+			while (records.size() < windowSize && (hasMore = Next(record)))
+			{
+				records.push_back(record);
+				views.push_back(record.mText);
+			}
+			if (records.empty())
+			{
+				break;
+			}
+
+			std::vector<ASTParser::ParsedExpression> results = parser.ParseBatch(views, pool);
+			for (size_t i = 0; i < records.size(); ++i)
+			{
+				handler(records[i], results[i]);
+			}
+			recordCount += records.size();
+
+			// the window is consumed, its pages are no longer needed
+			mFile.ReleaseBefore(mOffset);
+		}
+		return recordCount;
+	}
+}
@@ -0,0 +1,199 @@
+#include "ASTIncrementalParser.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace AST
+{
+	ASTIncrementalParser::ASTIncrementalParser(const ASTParser& parser)
+		: mParser(parser)
+	{
+	}
+
+	ASTIncrementalParser::~ASTIncrementalParser()
+	{
+		Reset();
+	}
+
+	bool ASTIncrementalParser::Parse(std::string_view expression)
+	{
+		mText.assign(expression.data(), expression.size());
+		return ParseAll();
+	}
+
+	bool ASTIncrementalParser::Edit(const size_t offset, const size_t removedLength, std::string_view insertedText)
+	{
+		if (offset > mText.size() || removedLength > mText.size() - offset)
+		{
+			throw std::out_of_range("Edit outside of the expression.");
+		}
+
+		mText.replace(offset, removedLength, insertedText.data(), insertedText.size());
+		if (!mRoot)
+		{
+			return ParseAll();
+		}
+
+		// groups are sorted by their start, so the last one holding the edit is the innermost
+		size_t groupIndex = mGroups.size();
+		for (size_t i = 0; i < mGroups.size() && mGroups[i].mBegin < offset; ++i)
+		{
+			if (mGroups[i].mContentBegin <= offset && offset + removedLength <= mGroups[i].mContentEnd)
+			{
+				groupIndex = i;
+			}
+		}
+
+		if (groupIndex == mGroups.size() || !ReparseGroup(groupIndex, removedLength, insertedText.size()))
+		{
+			return ParseAll();
+		}
+		return true;
+	}
+
+	bool ASTIncrementalParser::ParseAll()
+	{
+		Reset();
+
+		ASTParser::ParseContext context;
+		context.mGroups = &mGroups;
+		mRoot = mParser.ParseInternal(mText, context);
+		mLastParsedLength = mText.size();
+		mErrorType = context.mErrorType;
+		mErrorPos = context.mErrorPos;
+
+		if (!mRoot)
+		{
+			mGroups.clear();
+			return false;
+		}
+
+		SortGroups(mGroups);
+		LinkSubtree(mRoot, nullptr, 0);
+		return true;
+	}
+
+	bool ASTIncrementalParser::ReparseGroup(const size_t groupIndex, const size_t removedLength, const size_t insertedLength)
+	{
+		const ASTParser::ParenthesisGroup group = mGroups[groupIndex];
+		const size_t contentEnd = group.mContentEnd + insertedLength - removedLength;
+		std::string_view content = std::string_view(mText).substr(group.mContentBegin, contentEnd - group.mContentBegin);
+
+		// the content of a group parses like a whole expression
+		std::vector<ASTParser::ParenthesisGroup> innerGroups;
+		ASTParser::ParseContext context;
+		context.mGroups = &innerGroups;
+		ASTNode* node = mParser.ParseInternal(content, context);
+		mLastParsedLength = content.size();
+		if (!node)
+		{
+			return false;
+		}
+
+		ASTNode* oldNode = group.mNode;
+		const ParentLink link = mParents[oldNode];
+		UnlinkSubtree(oldNode);
+		if (link.mParent)
+		{
+			link.mParent->mOperands[link.mIndex] = node;
+		}
+		else
+		{
+			mRoot = node;
+		}
+		LinkSubtree(node, link.mParent, link.mIndex);
+		delete oldNode;
+
+		// the cached hashes above the new subtree describe the old one
+		for (const OperatorNode* ancestor = link.mParent; ancestor; ancestor = mParents[ancestor].mParent)
+		{
+			ancestor->InvalidateHash();
+		}
+
+		// the groups of the old content were parsed again
+		size_t innerEnd = groupIndex + 1;
+		while (innerEnd < mGroups.size() && mGroups[innerEnd].mBegin < group.mContentEnd)
+		{
+			++innerEnd;
+		}
+		mGroups.erase(mGroups.begin() + groupIndex + 1, mGroups.begin() + innerEnd);
+
+		for (ASTParser::ParenthesisGroup& other : mGroups)
+		{
+			if (other.mBegin >= group.mContentEnd)
+			{
+				other.mBegin = other.mBegin + insertedLength - removedLength;
+				other.mContentBegin = other.mContentBegin + insertedLength - removedLength;
+				other.mContentEnd = other.mContentEnd + insertedLength - removedLength;
+				other.mEnd = other.mEnd + insertedLength - removedLength;
+			}
+			else if (other.mEnd >= group.mEnd)
+			{
+				// encloses the edited group
+				other.mContentEnd = other.mContentEnd + insertedLength - removedLength;
+				other.mEnd = other.mEnd + insertedLength - removedLength;
+			}
+
+			// nested parentheses around one operand share its node
+			if (other.mNode == oldNode)
+			{
+				other.mNode = node;
+			}
+		}
+
+		for (ASTParser::ParenthesisGroup& inner : innerGroups)
+		{
+			inner.mBegin += group.mContentBegin;
+			inner.mContentBegin += group.mContentBegin;
+			inner.mContentEnd += group.mContentBegin;
+			inner.mEnd += group.mContentBegin;
+		}
+		SortGroups(innerGroups);
+		mGroups.insert(mGroups.begin() + groupIndex + 1, innerGroups.begin(), innerGroups.end());
+
+		mErrorType = ASTParser::ResultType::NoError;
+		mErrorPos = -1;
+		return true;
+	}
+
+	void ASTIncrementalParser::SortGroups(std::vector<ASTParser::ParenthesisGroup>& groups)
+	{
+		// recorded when they close, inner groups come first
+		std::sort(groups.begin(), groups.end(), [](const ASTParser::ParenthesisGroup& a, const ASTParser::ParenthesisGroup& b)
+			{
+				return a.mBegin < b.mBegin;
+			});
+	}
+
+	void ASTIncrementalParser::LinkSubtree(ASTNode* node, OperatorNode* parent, const size_t index)
+	{
+		mParents[node] = { parent, index };
+		if (node->mType == ASTNode::NodeType::Operator)
+		{
+			OperatorNode* operatorNode = static_cast<OperatorNode*>(node);
+			for (size_t i = 0; i < operatorNode->mOperands.size(); ++i)
+			{
+				LinkSubtree(operatorNode->mOperands[i], operatorNode, i);
+			}
+		}
+	}
+
+	void ASTIncrementalParser::UnlinkSubtree(const ASTNode* node)
+	{
+		mParents.erase(node);
+		if (node->mType == ASTNode::NodeType::Operator)
+		{
+			for (const ASTNode* operand : static_cast<const OperatorNode*>(node)->mOperands)
+			{
+				UnlinkSubtree(operand);
+			}
+		}
+	}
+
+	void ASTIncrementalParser::Reset()
+	{
+		delete mRoot;
+		mRoot = nullptr;
+		mGroups.clear();
+		mParents.clear();
+	}
+}
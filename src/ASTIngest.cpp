@@ -0,0 +1,471 @@
+#include "ASTIngest.h"
+#include "ASTParser.h"
+#include <algorithm>
+#include <charconv>
+
+namespace AST
+{
+	static bool IsIngestSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	static bool ParseIngestInteger(std::string_view text, int& outValue)
+	{
+		if (!text.empty() && text[0] == '+')
+		{
+			text.remove_prefix(1);
+		}
+		std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), outValue);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size() && !text.empty();
+	}
+
+	static void AppendIngestInteger(std::string& out, const uint64_t value, const size_t byteCount)
+	{
+		for (size_t i = 0; i < byteCount; ++i)
+		{
+			out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+		}
+	}
+
+	static bool WriteIngestToken(const ASTNode* node, std::string& out)
+	{
+		if (!out.empty())
+		{
+			out.push_back(' ');
+		}
+
+		switch (node->mType)
+		{
+		case ASTNode::NodeType::Rational:
+			out += static_cast<const RationalNode*>(node)->mValue.ToString();
+			return true;
+		case ASTNode::NodeType::Irrational:
+			out += '#';
+			out += std::to_string(static_cast<unsigned>(static_cast<const IrrationalNode*>(node)->mIrrational->mId));
+			return true;
+		case ASTNode::NodeType::Variable:
+		{
+			const std::string& name = static_cast<const VariableNode*>(node)->mVariable->mSymbol;
+			for (const char c : name)
+			{
+				if (IsIngestSpace(c))
+				{
+					return false;
+				}
+			}
+			out += '$';
+			out += name;
+			return !name.empty();
+		}
+		case ASTNode::NodeType::Operator:
+		{
+			const OperatorNode* opNode = static_cast<const OperatorNode*>(node);
+			out += '@';
+			out += std::to_string(static_cast<unsigned>(opNode->mOperator->mOperationId));
+			if (opNode->mOperator->mType == OperatorType::FunctionMultiple)
+			{
+				out += ':';
+				out += std::to_string(opNode->mOperands.size());
+			}
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	bool WriteIngestText(const ASTNode* root, const IngestOrder order, std::string& out)
+	{
+		if (order == IngestOrder::Prefix && !WriteIngestToken(root, out))
+		{
+			return false;
+		}
+		if (root->mType == ASTNode::NodeType::Operator)
+		{
+			for (const ASTNode* operand : static_cast<const OperatorNode*>(root)->mOperands)
+			{
+				if (!WriteIngestText(operand, order, out))
+				{
+					return false;
+				}
+			}
+		}
+		return order == IngestOrder::Prefix || WriteIngestToken(root, out);
+	}
+
+	bool WriteIngestBinary(const ASTNode* root, std::string& out)
+	{
+		switch (root->mType)
+		{
+		case ASTNode::NodeType::Rational:
+		{
+			const Rational& value = static_cast<const RationalNode*>(root)->mValue;
+			out.push_back(static_cast<char>(PostfixOpcode::Rational));
+			AppendIngestInteger(out, static_cast<uint32_t>(value.GetNumerator()), 4);
+			AppendIngestInteger(out, static_cast<uint32_t>(value.GetDenominator()), 4);
+			return true;
+		}
+		case ASTNode::NodeType::Irrational:
+			out.push_back(static_cast<char>(PostfixOpcode::Irrational));
+			AppendIngestInteger(out, static_cast<uint8_t>(static_cast<const IrrationalNode*>(root)->mIrrational->mId), 1);
+			return true;
+		case ASTNode::NodeType::Variable:
+		{
+			const std::string& name = static_cast<const VariableNode*>(root)->mVariable->mSymbol;
+			if (name.size() > UINT16_MAX)
+			{
+				return false;
+			}
+			out.push_back(static_cast<char>(PostfixOpcode::Variable));
+			AppendIngestInteger(out, name.size(), 2);
+			out += name;
+			return true;
+		}
+		case ASTNode::NodeType::Operator:
+		{
+			const OperatorNode* opNode = static_cast<const OperatorNode*>(root);
+			if (opNode->mOperands.size() > UINT16_MAX)
+			{
+				return false;
+			}
+			for (const ASTNode* operand : opNode->mOperands)
+			{
+				if (!WriteIngestBinary(operand, out))
+				{
+					return false;
+				}
+			}
+			out.push_back(static_cast<char>(PostfixOpcode::Operator));
+			AppendIngestInteger(out, static_cast<uint8_t>(opNode->mOperator->mOperationId), 1);
+			AppendIngestInteger(out, opNode->mOperands.size(), 2);
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	const Operator* ASTParser::GetIngestOperator(IngestTables& tables, const uint8_t operationId) const
+	{
+		if (!tables.mHasOperator[operationId])
+		{
+			tables.mOperators[operationId] = mSettings.mOperatorRegistry->GetOperator(static_cast<OperationId>(operationId)).get();
+			tables.mHasOperator[operationId] = true;
+		}
+		return tables.mOperators[operationId];
+	}
+
+	const Irrational* ASTParser::GetIngestIrrational(IngestTables& tables, const uint8_t irrationalId) const
+	{
+		if (!tables.mHasIrrationals)
+		{
+			for (const std::shared_ptr<Symbol>& symbol : mSettings.mIrrationalRegistry->GetSymbols())
+			{
+				const Irrational* irrational = static_cast<const Irrational*>(symbol.get());
+				tables.mIrrationals[static_cast<uint8_t>(irrational->mId)] = irrational;
+			}
+			tables.mHasIrrationals = true;
+		}
+		return tables.mIrrationals[irrationalId];
+	}
+
+	bool ASTParser::IngestOperator(ParseContext& context, const Operator* op, size_t operandCount, const size_t pos, const bool reversed)
+	{
+		size_t fixedCount = ASTPostfix::GetOperandCount(op->mType);
+		if (fixedCount != 0)
+		{
+			if (operandCount != 0 && operandCount != fixedCount)
+			{
+				return context.Fail(pos, ResultType::InvalidExpression);
+			}
+			operandCount = fixedCount;
+		}
+		else if (op->mType != OperatorType::FunctionMultiple || operandCount == 0)
+		{
+			return context.Fail(pos, ResultType::InvalidExpression);
+		}
+
+		std::vector<ASTNode*>& operandStack = context.mOperandStack;
+		if (operandStack.size() < operandCount)
+		{
+			return context.Fail(pos, ResultType::InvalidExpression);
+		}
+		if (mSettings.mMaxDepth && !CheckLimits(context, context.ReduceOperandDepths(operandCount), pos))
+		{
+			return false;
+		}
+
+		std::vector<ASTNode*> operands(operandStack.end() - operandCount, operandStack.end());
+		if (reversed)
+		{
+			std::reverse(operands.begin(), operands.end());
+		}
+		operandStack.resize(operandStack.size() - operandCount);
+		operandStack.push_back(context.NewNode<OperatorNode>(op, operands));
+		return true;
+	}
+
+	bool ASTParser::IngestTextToken(ParseContext& context, IngestTables& tables, std::string_view token, const size_t pos, const bool reversed)
+	{
+		if (!CheckLimits(context, 0, pos))
+		{
+			return false;
+		}
+
+		const char tag = token[0];
+		if (tag == '$')
+		{
+			if (token.size() == 1)
+			{
+				return context.Fail(pos, ResultType::InvalidExpression);
+			}
+			context.PushVariable(SymbolInterner::GetDefault().Intern(token.substr(1)));
+			return true;
+		}
+
+		if (tag == '#' || tag == '@')
+		{
+			size_t countSeparator = tag == '@' ? token.find(':') : std::string_view::npos;
+			int id = 0;
+			int operandCount = 0;
+			if (!ParseIngestInteger(token.substr(1, countSeparator == std::string_view::npos ? std::string_view::npos : countSeparator - 1), id) || id < 0 || id > UINT8_MAX ||
+				(countSeparator != std::string_view::npos && (!ParseIngestInteger(token.substr(countSeparator + 1), operandCount) || operandCount <= 0)))
+			{
+				return context.Fail(pos, ResultType::InvalidNumberFormat);
+			}
+
+			if (tag == '#')
+			{
+				const Irrational* irrational = GetIngestIrrational(tables, static_cast<uint8_t>(id));
+				if (!irrational)
+				{
+					return context.Fail(pos, ResultType::InvalidOperator);
+				}
+				context.PushIrrational(irrational);
+				return true;
+			}
+
+			const Operator* op = GetIngestOperator(tables, static_cast<uint8_t>(id));
+			if (!op)
+			{
+				return context.Fail(pos, ResultType::InvalidOperator);
+			}
+			return IngestOperator(context, op, static_cast<size_t>(operandCount), pos, reversed);
+		}
+
+		if ((tag >= '0' && tag <= '9') || tag == '-' || tag == '+')
+		{
+			size_t fraction = token.find('/');
+			int numerator = 0;
+			int denominator = 1;
+			Rational value;
+			// reduced in 64 bits, a negative denominator or INT_MIN must not overflow Rational's own reduction
+			if (!ParseIngestInteger(token.substr(0, fraction), numerator) ||
+				(fraction != std::string_view::npos && !ParseIngestInteger(token.substr(fraction + 1), denominator)) ||
+				!Rational::TryFromFraction(numerator, denominator, value))
+			{
+				return context.Fail(pos, ResultType::InvalidNumberFormat);
+			}
+			context.PushRational(value);
+			return true;
+		}
+
+		return context.Fail(pos, ResultType::InvalidCharacter);
+	}
+
+	ASTParser::ParsedExpression ASTParser::IngestText(std::string_view text, const IngestOrder order)
+	{
+		ParseContext context;
+		IngestTables tables;
+		bool success = true;
+		if (mSettings.mMaxInputLength && text.size() > mSettings.mMaxInputLength)
+		{
+			success = context.Fail(mSettings.mMaxInputLength, ResultType::ResourceLimitExceeded);
+		}
+
+		if (order == IngestOrder::Postfix)
+		{
+			for (size_t offset = 0; success && offset < text.size();)
+			{
+				if (IsIngestSpace(text[offset]))
+				{
+					++offset;
+					continue;
+				}
+				size_t end = offset;
+				while (end < text.size() && !IsIngestSpace(text[end]))
+				{
+					++end;
+				}
+				success = IngestTextToken(context, tables, text.substr(offset, end - offset), offset, false);
+				offset = end;
+			}
+		}
+		else
+		{
+			// prefix order is postfix read backwards, operands then come off the stack first to last
+			for (size_t end = text.size(); success && end > 0;)
+			{
+				if (IsIngestSpace(text[end - 1]))
+				{
+					--end;
+					continue;
+				}
+				size_t begin = end;
+				while (begin > 0 && !IsIngestSpace(text[begin - 1]))
+				{
+					--begin;
+				}
+				success = IngestTextToken(context, tables, text.substr(begin, end - begin), begin, true);
+				end = begin;
+			}
+		}
+
+		ParsedExpression parsed;
+		if (success)
+		{
+			if (context.mOperandStack.empty())
+			{
+				context.Fail(0, ResultType::EmptyExpression);
+			}
+			else if (context.mOperandStack.size() != 1)
+			{
+				context.Fail(text.size(), ResultType::InvalidExpression);
+			}
+			else
+			{
+				parsed.mRoot = context.mOperandStack.back();
+				context.mOperandStack.clear();
+			}
+		}
+		context.ReleaseOperands();
+
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		return parsed;
+	}
+
+	ASTParser::ParsedExpression ASTParser::IngestBinary(std::string_view data)
+	{
+		ParseContext context;
+		IngestTables tables;
+
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+		auto read = [&](size_t& offset, const size_t byteCount)
+			{
+				uint32_t value = 0;
+				for (size_t i = 0; i < byteCount; ++i)
+				{
+					value |= static_cast<uint32_t>(bytes[offset + i]) << (8 * i);
+				}
+				offset += byteCount;
+				return value;
+			};
+
+		// payload sizes of the fixed-size records, by PostfixOpcode
+		static constexpr size_t kPayloadSize[] = { 8, 1, 2, 3 };
+
+		bool success = true;
+		if (mSettings.mMaxInputLength && data.size() > mSettings.mMaxInputLength)
+		{
+			success = context.Fail(mSettings.mMaxInputLength, ResultType::ResourceLimitExceeded);
+		}
+
+		for (size_t offset = 0; success && offset < data.size();)
+		{
+			const size_t pos = offset;
+			if (!CheckLimits(context, 0, pos))
+			{
+				success = false;
+				break;
+			}
+			const uint8_t tag = bytes[offset++];
+			if (tag > static_cast<uint8_t>(PostfixOpcode::Operator))
+			{
+				success = context.Fail(pos, ResultType::InvalidCharacter);
+				break;
+			}
+			if (data.size() - offset < kPayloadSize[tag])
+			{
+				success = context.Fail(pos, ResultType::InvalidExpression);
+				break;
+			}
+
+			switch (static_cast<PostfixOpcode>(tag))
+			{
+			case PostfixOpcode::Rational:
+			{
+				int numerator = static_cast<int>(read(offset, 4));
+				int denominator = static_cast<int>(read(offset, 4));
+				Rational value;
+				if (!Rational::TryFromFraction(numerator, denominator, value))
+				{
+					success = context.Fail(pos, ResultType::InvalidNumberFormat);
+					break;
+				}
+				context.PushRational(value);
+				break;
+			}
+			case PostfixOpcode::Irrational:
+			{
+				const Irrational* irrational = GetIngestIrrational(tables, static_cast<uint8_t>(read(offset, 1)));
+				if (!irrational)
+				{
+					success = context.Fail(pos, ResultType::InvalidOperator);
+					break;
+				}
+				context.PushIrrational(irrational);
+				break;
+			}
+			case PostfixOpcode::Variable:
+			{
+				size_t length = read(offset, 2);
+				if (length == 0 || data.size() - offset < length)
+				{
+					success = context.Fail(pos, ResultType::InvalidExpression);
+					break;
+				}
+				context.PushVariable(SymbolInterner::GetDefault().Intern(data.substr(offset, length)));
+				offset += length;
+				break;
+			}
+			case PostfixOpcode::Operator:
+			{
+				const Operator* op = GetIngestOperator(tables, static_cast<uint8_t>(read(offset, 1)));
+				size_t operandCount = read(offset, 2);
+				if (!op)
+				{
+					success = context.Fail(pos, ResultType::InvalidOperator);
+					break;
+				}
+				success = IngestOperator(context, op, operandCount, pos, false);
+				break;
+			}
+			}
+		}
+
+		ParsedExpression parsed;
+		if (success)
+		{
+			if (context.mOperandStack.empty())
+			{
+				context.Fail(0, ResultType::EmptyExpression);
+			}
+			else if (context.mOperandStack.size() != 1)
+			{
+				context.Fail(data.size(), ResultType::InvalidExpression);
+			}
+			else
+			{
+				parsed.mRoot = context.mOperandStack.back();
+				context.mOperandStack.clear();
+			}
+		}
+		context.ReleaseOperands();
+
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		return parsed;
+	}
+}
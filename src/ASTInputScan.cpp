@@ -0,0 +1,281 @@
+#include "ASTInputScan.h"
+#include "DataTypes/Parenthesis.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AST_INPUT_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace AST
+{
+	static inline unsigned CountTrailingZeros(const uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, value);
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+	}
+
+	void ASTInputScan::Configure(const ASTLexer::RegistryList& registries)
+	{
+		bool isCurrent = mConfigured;
+		for (size_t category = 0; category < ASTLexer::kCategoryCount && isCurrent; ++category)
+		{
+			isCurrent = registries[category] == mRegistries[category] &&
+				(!registries[category] || registries[category]->GetVersion() == mVersions[category]);
+		}
+		if (isCurrent)
+		{
+			return;
+		}
+
+		mRegistries = registries;
+		for (size_t category = 0; category < ASTLexer::kCategoryCount; ++category)
+		{
+			mVersions[category] = registries[category] ? registries[category]->GetVersion() : 0;
+		}
+		mConfigured = true;
+
+		mPair.fill(kNoPair);
+		mIsOpen.fill(false);
+		mParenthesisBytes.clear();
+		mCheckParentheses = true;
+
+		const SymbolRegistry* parenthesisRegistry = registries[static_cast<size_t>(TokenCategory::Parenthesis)];
+		std::vector<std::shared_ptr<Symbol>> parentheses = parenthesisRegistry ? parenthesisRegistry->GetSymbols() : std::vector<std::shared_ptr<Symbol>>();
+
+		// pairs are numbered by their opening byte
+		uint8_t pairCount = 0;
+		for (const std::shared_ptr<Symbol>& symbol : parentheses)
+		{
+			const Parenthesis* parenthesis = static_cast<const Parenthesis*>(symbol.get());
+			if (parenthesis->mSymbol.size() != 1 || pairCount == kNoPair)
+			{
+				// multi-byte parentheses are left to the parser
+				mCheckParentheses = false;
+				return;
+			}
+			if (parenthesis->mIsOpen)
+			{
+				unsigned char c = static_cast<unsigned char>(parenthesis->mSymbol[0]);
+				mPair[c] = pairCount++;
+				mIsOpen[c] = true;
+				mParenthesisBytes.push_back(parenthesis->mSymbol[0]);
+			}
+		}
+		for (const std::shared_ptr<Symbol>& symbol : parentheses)
+		{
+			const Parenthesis* parenthesis = static_cast<const Parenthesis*>(symbol.get());
+			if (!parenthesis->mIsOpen)
+			{
+				unsigned char c = static_cast<unsigned char>(parenthesis->mSymbol[0]);
+				const Parenthesis* opposite = parenthesis->mOpposite;
+				mPair[c] = opposite && opposite->mSymbol.size() == 1 ? mPair[static_cast<unsigned char>(opposite->mSymbol[0])] : kNoPair;
+				mParenthesisBytes.push_back(parenthesis->mSymbol[0]);
+			}
+		}
+
+		// a parenthesis byte inside another symbol is not always a parenthesis token
+		for (size_t category = 0; category < ASTLexer::kCategoryCount; ++category)
+		{
+			if (category == static_cast<size_t>(TokenCategory::Parenthesis) || !registries[category])
+			{
+				continue;
+			}
+			for (const std::shared_ptr<Symbol>& symbol : registries[category]->GetSymbols())
+			{
+				for (const char c : symbol->mSymbol)
+				{
+					if (std::find(mParenthesisBytes.begin(), mParenthesisBytes.end(), c) != mParenthesisBytes.end())
+					{
+						mCheckParentheses = false;
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	ASTInputScan::BlockMasks ASTInputScan::ClassifyBlock(const char* data, const size_t length) const
+	{
+		BlockMasks masks;
+		size_t i = 0;
+
+#if defined(__AVX2__)
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i beforeZero = _mm256_set1_epi8('0' - 1);
+		const __m256i afterNine = _mm256_set1_epi8('9' + 1);
+		const __m256i minusOne = _mm256_set1_epi8(-1);
+		const __m256i controlEnd = _mm256_set1_epi8(0x20);
+		const __m256i del = _mm256_set1_epi8(0x7F);
+		for (; i + 32 <= length; i += 32)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+			__m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, beforeZero), _mm256_cmpgt_epi8(afterNine, bytes));
+			__m256i control = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(bytes, minusOne), _mm256_cmpgt_epi8(controlEnd, bytes)), _mm256_cmpeq_epi8(bytes, del));
+			__m256i parentheses = _mm256_setzero_si256();
+			for (const char c : mParenthesisBytes)
+			{
+				parentheses = _mm256_or_si256(parentheses, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c)));
+			}
+
+			masks.mWhitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, space)))) << i;
+			masks.mDigits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(digits))) << i;
+			masks.mControl |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(control))) << i;
+			masks.mParentheses |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(parentheses))) << i;
+		}
+#elif defined(AST_INPUT_SCAN_SSE2)
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i beforeZero = _mm_set1_epi8('0' - 1);
+		const __m128i afterNine = _mm_set1_epi8('9' + 1);
+		const __m128i minusOne = _mm_set1_epi8(-1);
+		const __m128i controlEnd = _mm_set1_epi8(0x20);
+		const __m128i del = _mm_set1_epi8(0x7F);
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			__m128i digits = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeZero), _mm_cmplt_epi8(bytes, afterNine));
+			__m128i control = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(bytes, minusOne), _mm_cmplt_epi8(bytes, controlEnd)), _mm_cmpeq_epi8(bytes, del));
+			__m128i parentheses = _mm_setzero_si128();
+			for (const char c : mParenthesisBytes)
+			{
+				parentheses = _mm_or_si128(parentheses, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)));
+			}
+
+			masks.mWhitespace |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space))) << i;
+			masks.mDigits |= static_cast<uint64_t>(_mm_movemask_epi8(digits)) << i;
+			masks.mControl |= static_cast<uint64_t>(_mm_movemask_epi8(control)) << i;
+			masks.mParentheses |= static_cast<uint64_t>(_mm_movemask_epi8(parentheses)) << i;
+		}
+#endif
+
+		for (; i < length; ++i)
+		{
+			const unsigned char c = static_cast<unsigned char>(data[i]);
+			const uint64_t bit = 1ull << i;
+			if (c == ' ')
+			{
+				masks.mWhitespace |= bit;
+			}
+			else if (c >= '0' && c <= '9')
+			{
+				masks.mDigits |= bit;
+			}
+			else if (c < 0x20 || c == 0x7F)
+			{
+				masks.mControl |= bit;
+			}
+			else if (mPair[c] != kNoPair || mIsOpen[c])
+			{
+				masks.mParentheses |= bit;
+			}
+		}
+
+		return masks;
+	}
+
+	bool ASTInputScan::CheckParentheses(std::string_view expression, uint64_t mask, const size_t blockBegin, const bool matchExactParenthesis)
+	{
+		// only the parenthesis bytes of the block are visited
+		while (mask)
+		{
+			const size_t pos = blockBegin + CountTrailingZeros(mask);
+			mask &= mask - 1;
+
+			const unsigned char c = static_cast<unsigned char>(expression[pos]);
+			if (mIsOpen[c])
+			{
+				mOpenStack.push_back(pos);
+				continue;
+			}
+
+			if (mOpenStack.empty() ||
+				(matchExactParenthesis && mPair[static_cast<unsigned char>(expression[mOpenStack.back()])] != mPair[c]) ||
+				(matchExactParenthesis && mPair[c] == kNoPair))
+			{
+				mError = ScanError::InvalidParenthesis;
+				mErrorPos = pos;
+				return false;
+			}
+			mOpenStack.pop_back();
+		}
+		return true;
+	}
+
+	bool ASTInputScan::Scan(std::string_view expression, const ASTLexer::RegistryList& registries, const bool matchExactParenthesis)
+	{
+		Configure(registries);
+
+		mSize = expression.size();
+		mError = ScanError::None;
+		mErrorPos = -1;
+		mOpenStack.clear();
+
+		const size_t wordCount = (mSize + 63) / 64;
+		mWhitespace.resize(wordCount);
+		mDigits.resize(wordCount);
+
+		for (size_t word = 0; word < wordCount; ++word)
+		{
+			const size_t blockBegin = word * 64;
+			const BlockMasks masks = ClassifyBlock(expression.data() + blockBegin, std::min<size_t>(64, mSize - blockBegin));
+			mWhitespace[word] = masks.mWhitespace;
+			mDigits[word] = masks.mDigits;
+
+			// report whichever error comes first in the text
+			uint64_t parentheses = masks.mParentheses;
+			if (masks.mControl)
+			{
+				parentheses &= (masks.mControl & (0 - masks.mControl)) - 1;
+			}
+			if (mCheckParentheses && parentheses && !CheckParentheses(expression, parentheses, blockBegin, matchExactParenthesis))
+			{
+				return false;
+			}
+			if (masks.mControl)
+			{
+				mError = ScanError::InvalidCharacter;
+				mErrorPos = blockBegin + CountTrailingZeros(masks.mControl);
+				return false;
+			}
+		}
+
+		if (mCheckParentheses && !mOpenStack.empty())
+		{
+			mError = ScanError::InvalidParenthesis;
+			mErrorPos = mOpenStack.back();
+			return false;
+		}
+		return true;
+	}
+
+	size_t ASTInputScan::FindClear(const std::vector<uint64_t>& bits, size_t pos) const
+	{
+		if (pos >= mSize)
+		{
+			return pos;
+		}
+
+		size_t word = pos / 64;
+		uint64_t clear = ~bits[word] & (~0ull << (pos % 64));
+		while (!clear)
+		{
+			if (++word == bits.size())
+			{
+				return mSize;
+			}
+			clear = ~bits[word];
+		}
+		return std::min(word * 64 + CountTrailingZeros(clear), mSize);
+	}
+}
@@ -0,0 +1,236 @@
+#include "ASTLexer.h"
+#include <algorithm>
+
+namespace AST
+{
+	ASTLexer::ASTLexer(const RegistryList& registries)
+		: mRegistries(registries)
+	{
+		std::vector<Entry> entries;
+
+		for (size_t category = 0; category < kCategoryCount; ++category)
+		{
+			const SymbolRegistry* registry = registries[category];
+			if (!registry)
+			{
+				continue;
+			}
+			mVersions[category] = registry->GetVersion();
+
+			for (const std::shared_ptr<Symbol>& symbol : registry->GetSymbols())
+			{
+				if (symbol->mSymbol.empty())
+				{
+					continue;
+				}
+
+				Entry entry = {};
+				entry.mText = symbol->mSymbol;
+				entry.mAccept.mSymbol = symbol.get();
+				entry.mAccept.mCategory = static_cast<TokenCategory>(category);
+				if (entry.mAccept.mCategory == TokenCategory::Operator)
+				{
+					entry.mAccept.mOperator = dynamic_cast<const Operator*>(symbol.get());
+					if (!entry.mAccept.mOperator)
+					{
+						continue;
+					}
+				}
+				else if (entry.mAccept.mCategory == TokenCategory::CustomSymbol)
+				{
+					entry.mAccept.mVariable = SymbolInterner::GetDefault().Intern(symbol->mSymbol);
+				}
+				entry.mOrder = entries.size();
+				entries.push_back(entry);
+			}
+		}
+
+		// registration order decides between symbols of the same text and category
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+			{
+				if (a.mText != b.mText)
+				{
+					return a.mText < b.mText;
+				}
+				if (a.mAccept.mCategory != b.mAccept.mCategory)
+				{
+					return a.mAccept.mCategory < b.mAccept.mCategory;
+				}
+				return a.mOrder < b.mOrder;
+			});
+
+		mFirstByte.fill(kNoState);
+		mStates.reserve(entries.size() + 1);
+		BuildState(entries, 0, entries.size(), 0);
+
+		const State& root = mStates[0];
+		for (uint32_t i = 0; i < root.mEdgeCount; ++i)
+		{
+			mFirstByte[mEdgeBytes[root.mEdgeBegin + i]] = mEdgeTargets[root.mEdgeBegin + i];
+		}
+	}
+
+	uint32_t ASTLexer::BuildState(const std::vector<Entry>& entries, size_t begin, const size_t end, const size_t depth)
+	{
+		uint32_t index = static_cast<uint32_t>(mStates.size());
+		mStates.emplace_back();
+
+		// entries ending here sort before the longer ones sharing this prefix
+		State state = {};
+		state.mAcceptBegin = static_cast<uint32_t>(mAccepts.size());
+		for (; begin < end && entries[begin].mText.size() == depth; ++begin)
+		{
+			mAccepts.push_back(entries[begin].mAccept);
+			state.mCategoryMask |= 1 << static_cast<uint8_t>(entries[begin].mAccept.mCategory);
+			++state.mAcceptCount;
+		}
+
+		// reserve the edges first so they stay contiguous, then build the children
+		size_t edgeCount = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (i == begin || entries[i].mText[depth] != entries[i - 1].mText[depth])
+			{
+				++edgeCount;
+			}
+		}
+		state.mEdgeBegin = static_cast<uint32_t>(mEdgeBytes.size());
+		state.mEdgeCount = static_cast<uint16_t>(edgeCount);
+		mEdgeBytes.resize(mEdgeBytes.size() + edgeCount);
+		mEdgeTargets.resize(mEdgeTargets.size() + edgeCount);
+		mStates[index] = state;
+
+		size_t edge = state.mEdgeBegin;
+		while (begin < end)
+		{
+			char c = entries[begin].mText[depth];
+			size_t groupEnd = begin + 1;
+			while (groupEnd < end && entries[groupEnd].mText[depth] == c)
+			{
+				++groupEnd;
+			}
+
+			mEdgeBytes[edge] = static_cast<unsigned char>(c);
+			mEdgeTargets[edge] = BuildState(entries, begin, groupEnd, depth + 1);
+			++edge;
+			begin = groupEnd;
+		}
+
+		return index;
+	}
+
+	bool ASTLexer::IsCurrent(const RegistryList& registries) const
+	{
+		for (size_t category = 0; category < kCategoryCount; ++category)
+		{
+			if (registries[category] != mRegistries[category])
+			{
+				return false;
+			}
+			if (registries[category] && registries[category]->GetVersion() != mVersions[category])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	ASTLexer::Match ASTLexer::Scan(std::string_view expression, const size_t offset) const
+	{
+		Match match;
+		if (offset >= expression.size())
+		{
+			return match;
+		}
+
+		uint32_t stateIndex = mFirstByte[static_cast<unsigned char>(expression[offset])];
+		uint32_t length = 1;
+		while (stateIndex != kNoState)
+		{
+			const State& state = mStates[stateIndex];
+			if (state.mCategoryMask)
+			{
+				for (size_t category = 0; category < kCategoryCount; ++category)
+				{
+					if (state.mCategoryMask & (1 << category))
+					{
+						match.mLength[category] = length;
+						match.mState[category] = stateIndex;
+					}
+				}
+			}
+
+			if (offset + length >= expression.size() || state.mEdgeCount == 0)
+			{
+				break;
+			}
+
+			const unsigned char c = static_cast<unsigned char>(expression[offset + length]);
+			const unsigned char* edgeBegin = mEdgeBytes.data() + state.mEdgeBegin;
+			const unsigned char* edgeEnd = edgeBegin + state.mEdgeCount;
+			const unsigned char* edge = std::lower_bound(edgeBegin, edgeEnd, c);
+			stateIndex = (edge != edgeEnd && *edge == c) ? mEdgeTargets[state.mEdgeBegin + (edge - edgeBegin)] : kNoState;
+			++length;
+		}
+
+		return match;
+	}
+
+	const Symbol* ASTLexer::GetSymbol(const Match& match, const TokenCategory category) const
+	{
+		uint32_t stateIndex = match.mState[static_cast<size_t>(category)];
+		if (stateIndex == kNoState)
+		{
+			return nullptr;
+		}
+
+		const State& state = mStates[stateIndex];
+		for (uint32_t i = state.mAcceptBegin; i < state.mAcceptBegin + state.mAcceptCount; ++i)
+		{
+			if (mAccepts[i].mCategory == category)
+			{
+				return mAccepts[i].mSymbol;
+			}
+		}
+		return nullptr;
+	}
+
+	const Operator* ASTLexer::GetOperator(const Match& match, const bool allowBinary) const
+	{
+		uint32_t stateIndex = match.mState[static_cast<size_t>(TokenCategory::Operator)];
+		if (stateIndex == kNoState)
+		{
+			return nullptr;
+		}
+
+		const State& state = mStates[stateIndex];
+		for (uint32_t i = state.mAcceptBegin; i < state.mAcceptBegin + state.mAcceptCount; ++i)
+		{
+			const Accept& accept = mAccepts[i];
+			if (accept.mCategory == TokenCategory::Operator && (allowBinary || accept.mOperator->mType != OperatorType::Binary))
+			{
+				return accept.mOperator;
+			}
+		}
+		return nullptr;
+	}
+
+	InternedSymbol ASTLexer::GetVariable(const Match& match) const
+	{
+		uint32_t stateIndex = match.mState[static_cast<size_t>(TokenCategory::CustomSymbol)];
+		if (stateIndex == kNoState)
+		{
+			return {};
+		}
+
+		const State& state = mStates[stateIndex];
+		for (uint32_t i = state.mAcceptBegin; i < state.mAcceptBegin + state.mAcceptCount; ++i)
+		{
+			if (mAccepts[i].mCategory == TokenCategory::CustomSymbol)
+			{
+				return mAccepts[i].mVariable;
+			}
+		}
+		return {};
+	}
+}
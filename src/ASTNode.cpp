@@ -1,54 +1,85 @@
 #include "ASTNode.h"
+#include <algorithm>
+#include <functional>
 
 namespace AST
 {
+	static uint64_t CombineHash(const uint64_t hash, const uint64_t value)
+	{
+		return (hash ^ value) * 1099511628211ull;
+	}
+
+	static uint64_t SeedHash(const ASTNode::NodeType type)
+	{
+		return CombineHash(14695981039346656037ull, static_cast<uint64_t>(type));
+	}
+
+	uint64_t ASTNode::GetHash() const
+	{
+		uint64_t hash = mHash.load(std::memory_order_relaxed);
+		if (hash == 0)
+		{
+			// 0 marks a hash not computed yet, so a computed 0 becomes 1
+			hash = std::max<uint64_t>(ComputeHash(), 1);
+			mHash.store(hash, std::memory_order_relaxed);
+		}
+		return hash;
+	}
+
+	ASTNode* ASTNode::AddReference() const
+	{
+		mReferenceCount.fetch_add(1, std::memory_order_relaxed);
+		return const_cast<ASTNode*>(this);
+	}
+
+	void ASTNode::RemoveReference() const
+	{
+		if (mReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
+	}
+
 	bool ASTNode::operator==(const ASTNode& other) const
 	{
 		if (mType != other.mType)
 			return false;
 
-		switch (mType)
-		{
-		case NodeType::Rational:
-			return *dynamic_cast<const RationalNode*>(this) == *dynamic_cast<const RationalNode*>(&other);
-		case NodeType::Irrational:
-			return *dynamic_cast<const IrrationalNode*>(this) == *dynamic_cast<const IrrationalNode*>(&other);
-		case NodeType::Variable:
-			return *dynamic_cast<const VariableNode*>(this) == *dynamic_cast<const VariableNode*>(&other);
-		case NodeType::Operator:
-			return *dynamic_cast<const OperatorNode*>(this) == *dynamic_cast<const OperatorNode*>(&other);
-		case NodeType::Parenthesis:
-			return *dynamic_cast<const ParenthesisNode*>(this) == *dynamic_cast<const ParenthesisNode*>(&other);
-		default:
-			return false;
-		}
+		return Visit(this, Overloaded{
+			[](const ASTNode*) { return false; },
+			[&other](const auto* node) { return *node == other; },
+			});
 	}
 
 	bool RationalNode::operator==(const ASTNode& other) const
 	{
-		if (const auto* rhs = dynamic_cast<const RationalNode*>(&other))
+		if (const auto* rhs = NodeCast<RationalNode>(&other))
 			return mValue == rhs->mValue;
 		return false;
 	}
 
 	bool AST::IrrationalNode::operator==(const ASTNode& other) const
 	{
-		if (const auto* rhs = dynamic_cast<const IrrationalNode*>(&other))
+		if (const auto* rhs = NodeCast<IrrationalNode>(&other))
 			return *mIrrational == *rhs->mIrrational;
 		return false;
 	}
 
 	bool AST::VariableNode::operator==(const ASTNode& other) const
 	{
-		if (const auto* rhs = dynamic_cast<const VariableNode*>(&other))
-			return *mVariable == *rhs->mVariable;
+		if (const auto* rhs = NodeCast<VariableNode>(&other))
+			return mId == rhs->mId;
 		return false;
 	}
 
 	bool AST::OperatorNode::operator==(const ASTNode& other) const
 	{
-		if (const auto* rhs = dynamic_cast<const OperatorNode*>(&other))
+		if (const auto* rhs = NodeCast<OperatorNode>(&other))
 		{
+			// unequal subtrees almost always differ in their hash, only a match walks the operands
+			if (GetHash() != rhs->GetHash())
+				return false;
+
 			if (*mOperator != *rhs->mOperator || mOperands.size() != rhs->mOperands.size())
 				return false;
 
@@ -66,14 +97,54 @@ namespace AST
 	{
 		for (auto& operand : mOperands)
 		{
-			delete operand;
+			if (operand->mOwnership == NodeOwnership::Heap)
+			{
+				delete operand;
+			}
+			else if (operand->mOwnership == NodeOwnership::Shared)
+			{
+				operand->RemoveReference();
+			}
 		}
 	}
 
 	bool AST::ParenthesisNode::operator==(const ASTNode& other) const
 	{
-		if (const auto* rhs = dynamic_cast<const ParenthesisNode*>(&other))
+		if (const auto* rhs = NodeCast<ParenthesisNode>(&other))
 			return mParenthesis == rhs->mParenthesis;
 		return false;
 	}
-}
\ No newline at end of file
+
+	uint64_t RationalNode::ComputeHash() const
+	{
+		uint64_t hash = SeedHash(mType);
+		hash = CombineHash(hash, static_cast<uint64_t>(mValue.GetNumerator()));
+		return CombineHash(hash, static_cast<uint64_t>(mValue.GetDenominator()));
+	}
+
+	uint64_t IrrationalNode::ComputeHash() const
+	{
+		return CombineHash(SeedHash(mType), std::hash<std::string>()(mIrrational->mSymbol));
+	}
+
+	uint64_t VariableNode::ComputeHash() const
+	{
+		return CombineHash(SeedHash(mType), mId);
+	}
+
+	uint64_t OperatorNode::ComputeHash() const
+	{
+		uint64_t hash = CombineHash(SeedHash(mType), static_cast<uint64_t>(mOperator->mOperationId));
+		hash = CombineHash(hash, std::hash<std::string>()(mOperator->mSymbol));
+		for (const ASTNode* operand : mOperands)
+		{
+			hash = CombineHash(hash, operand->GetHash());
+		}
+		return hash;
+	}
+
+	uint64_t ParenthesisNode::ComputeHash() const
+	{
+		return CombineHash(SeedHash(mType), reinterpret_cast<uintptr_t>(mParenthesis));
+	}
+}
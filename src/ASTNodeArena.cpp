@@ -0,0 +1,59 @@
+#include "ASTNodeArena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace AST
+{
+	ASTNodeArena::ASTNodeArena(const size_t blockSize)
+		: mBlockSize(blockSize)
+	{
+	}
+
+	ASTNodeArena::~ASTNodeArena() = default;
+
+	void ASTNodeArena::Reset()
+	{
+		mNodeCount = 0;
+		if (mBlocks.size() > 1)
+		{
+			mBlocks.resize(1);
+		}
+		mBlockOffset = 0;
+	}
+
+	size_t ASTNodeArena::GetReservedBytes() const
+	{
+		size_t reserved = 0;
+		for (const Block& block : mBlocks)
+		{
+			reserved += block.mSize;
+		}
+		return reserved;
+	}
+
+	void* ASTNodeArena::Allocate(const size_t size, const size_t alignment)
+	{
+		if (!mBlocks.empty())
+		{
+			Block& block = mBlocks.back();
+			size_t alignedOffset = (mBlockOffset + alignment - 1) & ~(alignment - 1);
+			if (alignedOffset + size <= block.mSize)
+			{
+				mBlockOffset = alignedOffset + size;
+				return block.mData.get() + alignedOffset;
+			}
+		}
+
+		// oversized nodes get a block of their own
+		size_t blockSize = std::max(mBlockSize, size + alignment);
+		Block block = {};
+		block.mData = std::make_unique<unsigned char[]>(blockSize);
+		block.mSize = blockSize;
+		mBlocks.push_back(std::move(block));
+
+		unsigned char* data = mBlocks.back().mData.get();
+		size_t alignedOffset = (alignment - reinterpret_cast<uintptr_t>(data) % alignment) % alignment;
+		mBlockOffset = alignedOffset + size;
+		return data + alignedOffset;
+	}
+}
@@ -94,12 +94,12 @@ namespace AST
 		size_t mRightOffset = 0;
 	};
 
-	void ASTNodeTreeViewer::FormOperatorSubtree(const OperatorNode* operatorNode, ASTNodeTreeViewer::NodeTreeInfo& outNodeTreeInfo)
+	void ASTNodeTreeViewer::FormOperatorSubtree(const std::string& symbol, std::vector<NodeTreeInfo>& childNodeTreeInfos, ASTNodeTreeViewer::NodeTreeInfo& outNodeTreeInfo)
 	{
 		// corner case: if the operator node has no operands, use UpdateLeafNodeTreeInfo
-		if (operatorNode->mOperands.empty())
+		if (childNodeTreeInfos.empty())
 		{
-			UpdateLeafNodeTreeInfo(outNodeTreeInfo, operatorNode->mOperator->mSymbol);
+			UpdateLeafNodeTreeInfo(outNodeTreeInfo, symbol);
 			return;
 		}
 
@@ -109,23 +109,21 @@ namespace AST
 		// 3. add 1 to the pivot point to get the offset of the operator symbol
 		// 4. add the operator symbol to the line
 		// 5. return
-		if (operatorNode->mOperands.size() == 1)
+		if (childNodeTreeInfos.size() == 1)
 		{
-			const ASTNode* operand = operatorNode->mOperands[0];
-			NodeTreeInfo childNodeTreeInfo = {};
-			PrintTreeInternal(operand, childNodeTreeInfo);
+			const NodeTreeInfo& childNodeTreeInfo = childNodeTreeInfos[0];
 			outNodeTreeInfo.mLines.reserve(childNodeTreeInfo.mLines.size() + 2);
 			outNodeTreeInfo.mLineContentBeginOffset.reserve(childNodeTreeInfo.mLines.size() + 2);
 
 			// add the operator symbol to the line
-			outNodeTreeInfo.mLines.push_back(operatorNode->mOperator->mSymbol);
+			outNodeTreeInfo.mLines.push_back(symbol);
 			outNodeTreeInfo.mLineContentBeginOffset.push_back(childNodeTreeInfo.GetLeftPivot() + 1);
 
 			// add a line to connect the operator symbol and the child node
 			outNodeTreeInfo.mLines.push_back("/");
 			outNodeTreeInfo.mLineContentBeginOffset.push_back(childNodeTreeInfo.GetLeftPivot());
 
-			size_t operatorSize = operatorNode->mOperator->mSymbol.size();
+			size_t operatorSize = symbol.size();
 			if (operatorSize + outNodeTreeInfo.mLineContentBeginOffset[0] > outNodeTreeInfo.mWidth)
 			{
 				outNodeTreeInfo.mWidth = operatorSize + outNodeTreeInfo.mLineContentBeginOffset[0];
@@ -142,28 +140,19 @@ namespace AST
 			return;
 		}
 
-		// read all child nodes
-		std::vector<NodeTreeInfo> childNodeTreeInfos = {};
-
 		std::vector<size_t> pivotOffsets = {};
 		std::vector<size_t> firstLineInterval = {};
 		size_t maxFirstLineInterval = 0;
 		std::vector<int32_t> lineOffsetAdjustions = {};
 		size_t accumulativeWidth = 0;
 
-		childNodeTreeInfos.reserve(operatorNode->mOperands.size());
-
-		pivotOffsets.reserve(operatorNode->mOperands.size());
-		firstLineInterval.reserve(operatorNode->mOperands.size() - 1);
-		lineOffsetAdjustions.reserve(operatorNode->mOperands.size() - 1);
+		pivotOffsets.reserve(childNodeTreeInfos.size());
+		firstLineInterval.reserve(childNodeTreeInfos.size() - 1);
+		lineOffsetAdjustions.reserve(childNodeTreeInfos.size() - 1);
 
-		for (size_t i = 0; i < operatorNode->mOperands.size(); i++)
+		for (size_t i = 0; i < childNodeTreeInfos.size(); i++)
 		{
-			// read child node
-			const ASTNode* operand = operatorNode->mOperands[i];
-			NodeTreeInfo childNodeTreeInfo = {};
-			PrintTreeInternal(operand, childNodeTreeInfo);
-			childNodeTreeInfos.push_back(childNodeTreeInfo);
+			const NodeTreeInfo& childNodeTreeInfo = childNodeTreeInfos[i];
 
 			// store pivot points
 			// pivot points are the offset of the beginning of the line between each child node and the parent node
@@ -177,7 +166,7 @@ namespace AST
 				pivotOffsets.push_back(pivotOffset);
 				accumulativeWidth += childNodeTreeInfo.mWidth;
 			}
-			else if (i == operatorNode->mOperands.size() - 1)
+			else if (i == childNodeTreeInfos.size() - 1)
 			{
 				pivotOffset = childNodeTreeInfo.GetRightPivot();
 			}
@@ -260,10 +249,10 @@ namespace AST
 		// also, in this case, we know that the line height is 1
 		size_t lineHeight = 0;
 		size_t pivotLineContentWidth = pivotOffsets.back() - pivotOffsets.front() - 1;
-		if (pivotLineContentWidth < operatorNode->mOperator->mSymbol.size())
+		if (pivotLineContentWidth < symbol.size())
 		{
-			size_t additionalSpaceDivided = (operatorNode->mOperator->mSymbol.size() - pivotLineContentWidth) / lineOffsetAdjustions.size();
-			size_t additionalSpaceRemainder = (operatorNode->mOperator->mSymbol.size() - pivotLineContentWidth) % lineOffsetAdjustions.size();
+			size_t additionalSpaceDivided = (symbol.size() - pivotLineContentWidth) / lineOffsetAdjustions.size();
+			size_t additionalSpaceRemainder = (symbol.size() - pivotLineContentWidth) % lineOffsetAdjustions.size();
 			for (size_t i = 0; i < lineOffsetAdjustions.size(); i++)
 			{
 				lineOffsetAdjustions[i] += static_cast<int32_t>(additionalSpaceDivided);
@@ -282,7 +271,7 @@ namespace AST
 		}
 		else
 		{
-			size_t firstLineContentWidthDifference = pivotLineContentWidth - operatorNode->mOperator->mSymbol.size();
+			size_t firstLineContentWidthDifference = pivotLineContentWidth - symbol.size();
 
 			// if the first line content is larger than the operator symbol, but
 			// the difference between the first line content and the operator symbol is odd
@@ -305,7 +294,7 @@ namespace AST
 		outNodeTreeInfo.mLineContentBeginOffset.resize(lineHeight + 1);
 
 		// 2. add the operator symbol to the line
-		outNodeTreeInfo.mLines[0] = operatorNode->mOperator->mSymbol;
+		outNodeTreeInfo.mLines[0] = symbol;
 		outNodeTreeInfo.mLineContentBeginOffset[0] = childNodeTreeInfos[0].GetLeftPivot() + lineHeight;
 
 		// 3. add the line to connect the operator symbol and the child node
@@ -313,7 +302,7 @@ namespace AST
 		size_t rightNodeClosestLine = pivotOffsets.size() - 2;
 		for (size_t i = lineHeight; i > 0; i--)
 		{
-			for (size_t j = 0; j < operatorNode->mOperands.size(); j++)
+			for (size_t j = 0; j < childNodeTreeInfos.size(); j++)
 			{
 				if (j == 0)
 				{
@@ -325,12 +314,12 @@ namespace AST
 						if (leftNodeClosestLine > rightNodeClosestLine ||
 							(leftNodeClosestLine == rightNodeClosestLine && pivotOffsets[pivotOffsets.size() - 1] - pivotOffsets[rightNodeClosestLine] == 0))
 						{
-							leftNodeClosestLine = operatorNode->mOperands.size() - 1;
+							leftNodeClosestLine = childNodeTreeInfos.size() - 1;
 						}
 					}
 					pivotOffsets[j]++;
 				}
-				else if (j == operatorNode->mOperands.size() - 1)
+				else if (j == childNodeTreeInfos.size() - 1)
 				{
 					int32_t isNotLeftNode = j != leftNodeClosestLine && rightNodeClosestLine != 0;
 					size_t spaceToFill = static_cast<int32_t>(pivotOffsets[j] - pivotOffsets[rightNodeClosestLine] - isNotLeftNode);
@@ -372,37 +361,50 @@ namespace AST
 	{
 		if (!node) return;
 
-		switch (node->mType)
+		Visit(node, Overloaded{
+			[&outNodeTreeInfo](const RationalNode* rationalNode) { UpdateLeafNodeTreeInfo(outNodeTreeInfo, rationalNode->mValue.ToString()); },
+			[&outNodeTreeInfo](const IrrationalNode* irrationalNode) { UpdateLeafNodeTreeInfo(outNodeTreeInfo, irrationalNode->mIrrational->mSymbol); },
+			[&outNodeTreeInfo](const VariableNode* variableNode) { UpdateLeafNodeTreeInfo(outNodeTreeInfo, variableNode->mVariable->mSymbol); },
+			[&outNodeTreeInfo](const ParenthesisNode* parenthesisNode) { UpdateLeafNodeTreeInfo(outNodeTreeInfo, parenthesisNode->mParenthesis->mSymbol); },
+			[&outNodeTreeInfo](const OperatorNode* operatorNode)
+			{
+				std::vector<NodeTreeInfo> childNodeTreeInfos(operatorNode->mOperands.size());
+				for (size_t i = 0; i < operatorNode->mOperands.size(); i++)
+				{
+					PrintTreeInternal(operatorNode->mOperands[i], childNodeTreeInfos[i]);
+				}
+				outNodeTreeInfo = {};
+				FormOperatorSubtree(operatorNode->mOperator->mSymbol, childNodeTreeInfos, outNodeTreeInfo);
+			},
+			[](const ASTNode*) {},
+			});
+	}
+
+	void ASTNodeTreeViewer::PrintTreeInternal(const ASTBuffer& buffer, const ASTBuffer::NodeIndex index, NodeTreeInfo& outNodeTreeInfo)
+	{
+		switch (buffer.GetType(index))
 		{
 		case ASTNode::NodeType::Rational:
-		{
-			const RationalNode* rationalNode = dynamic_cast<const RationalNode*>(node);
-			UpdateLeafNodeTreeInfo(outNodeTreeInfo, rationalNode->mValue.ToString());
+			UpdateLeafNodeTreeInfo(outNodeTreeInfo, buffer.GetRational(index).ToString());
 			break;
-		}
 		case ASTNode::NodeType::Irrational:
-		{
-			const IrrationalNode* irrationalNode = dynamic_cast<const IrrationalNode*>(node);
-			UpdateLeafNodeTreeInfo(outNodeTreeInfo, irrationalNode->mIrrational->mSymbol);
+			UpdateLeafNodeTreeInfo(outNodeTreeInfo, buffer.GetIrrational(index)->mSymbol);
 			break;
-		}
 		case ASTNode::NodeType::Variable:
-		{
-			const VariableNode* variableNode = dynamic_cast<const VariableNode*>(node);
-			UpdateLeafNodeTreeInfo(outNodeTreeInfo, variableNode->mVariable->mSymbol);
+			UpdateLeafNodeTreeInfo(outNodeTreeInfo, buffer.GetVariable(index).mSymbol->mSymbol);
 			break;
-		}
 		case ASTNode::NodeType::Parenthesis:
-		{
-			const ParenthesisNode* parenthesisNode = dynamic_cast<const ParenthesisNode*>(node);
-			UpdateLeafNodeTreeInfo(outNodeTreeInfo, parenthesisNode->mParenthesis->mSymbol);
+			UpdateLeafNodeTreeInfo(outNodeTreeInfo, buffer.GetParenthesis(index)->mSymbol);
 			break;
-		}
 		case ASTNode::NodeType::Operator:
 		{
-			const OperatorNode* operatorNode = dynamic_cast<const OperatorNode*>(node);
+			std::vector<NodeTreeInfo> childNodeTreeInfos(buffer.GetOperandCount(index));
+			for (size_t i = 0; i < childNodeTreeInfos.size(); i++)
+			{
+				PrintTreeInternal(buffer, buffer.GetOperand(index, i), childNodeTreeInfos[i]);
+			}
 			outNodeTreeInfo = {};
-			FormOperatorSubtree(operatorNode, outNodeTreeInfo);
+			FormOperatorSubtree(buffer.GetOperator(index)->mSymbol, childNodeTreeInfos, outNodeTreeInfo);
 			break;
 		}
 		default:
@@ -418,6 +420,21 @@ namespace AST
 		return nodeTreeInfo.ToString();
 	}
 
+	std::string ASTNodeTreeViewer::PrintTree(const ASTArenaTree& tree)
+	{
+		return PrintTree(tree.GetRoot());
+	}
+
+	std::string ASTNodeTreeViewer::PrintTree(const ASTBuffer& buffer)
+	{
+		NodeTreeInfo nodeTreeInfo = {};
+		if (!buffer.IsEmpty())
+		{
+			PrintTreeInternal(buffer, buffer.GetRoot(), nodeTreeInfo);
+		}
+		return nodeTreeInfo.ToString();
+	}
+
 	std::ostream& operator<<(std::ostream& os, const ASTNodeTreeViewer::NodeTreeInfo& nodeTreeInfo)
 	{
 		for (size_t i = 0; i < nodeTreeInfo.mLines.size(); i++)
@@ -0,0 +1,134 @@
+#include "ASTParseCache.h"
+#include <algorithm>
+
+namespace AST
+{
+	ASTParseCache::ASTParseCache(const size_t capacity, const size_t shardCount)
+		: mShardCount(std::max<size_t>(1, shardCount))
+	{
+		mShards = std::make_unique<Shard[]>(mShardCount);
+		mShardCapacity = std::max<size_t>(1, (capacity + mShardCount - 1) / mShardCount);
+	}
+
+	void ASTParseCache::NormalizeExpression(std::string_view expression, std::string& outText)
+	{
+		outText.clear();
+		bool pendingSpace = false;
+		for (const char c : expression)
+		{
+			if (c == ' ')
+			{
+				pendingSpace = !outText.empty();
+				continue;
+			}
+			if (pendingSpace)
+			{
+				outText.push_back(' ');
+				pendingSpace = false;
+			}
+			outText.push_back(c);
+		}
+	}
+
+	std::list<ASTParseCache::Entry>::iterator ASTParseCache::Find(Shard& shard, std::string_view text, const uint64_t fingerprint)
+	{
+		auto range = shard.mIndex.equal_range(text);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->mFingerprint == fingerprint)
+			{
+				return it->second;
+			}
+		}
+		return shard.mEntries.end();
+	}
+
+	std::shared_ptr<const ASTNode> ASTParseCache::Parse(ASTParser& parser, std::string_view expression)
+	{
+		// reused across calls so a hit does not allocate
+		thread_local std::string text;
+		NormalizeExpression(expression, text);
+
+		const uint64_t fingerprint = parser.GetSettingsFingerprint();
+		Shard& shard = mShards[(std::hash<std::string_view>()(text) ^ fingerprint) % mShardCount];
+
+		{
+			std::lock_guard<std::mutex> lock(shard.mMutex);
+			auto it = Find(shard, text, fingerprint);
+			if (it != shard.mEntries.end())
+			{
+				shard.mEntries.splice(shard.mEntries.begin(), shard.mEntries, it);
+				++mHits;
+				return it->mRoot;
+			}
+		}
+
+		// parse outside the lock, a miss must not stall the other users of the shard
+		++mMisses;
+		ASTParser::ParsedExpression parsed = parser.TryParse(text);
+		if (!parsed)
+		{
+			return nullptr;
+		}
+		std::shared_ptr<const ASTNode> root(parsed.mRoot);
+
+		std::lock_guard<std::mutex> lock(shard.mMutex);
+		auto it = Find(shard, text, fingerprint);
+		if (it != shard.mEntries.end())
+		{
+			// another thread parsed it first
+			shard.mEntries.splice(shard.mEntries.begin(), shard.mEntries, it);
+			return it->mRoot;
+		}
+
+		shard.mEntries.push_front({ text, fingerprint, root });
+		shard.mIndex.emplace(shard.mEntries.front().mText, shard.mEntries.begin());
+
+		while (shard.mEntries.size() > mShardCapacity)
+		{
+			auto last = std::prev(shard.mEntries.end());
+			auto range = shard.mIndex.equal_range(last->mText);
+			for (auto indexIt = range.first; indexIt != range.second; ++indexIt)
+			{
+				if (indexIt->second == last)
+				{
+					shard.mIndex.erase(indexIt);
+					break;
+				}
+			}
+			shard.mEntries.erase(last);
+			++mEvictions;
+		}
+		return root;
+	}
+
+	ASTParseCache::Statistics ASTParseCache::GetStatistics() const
+	{
+		Statistics statistics;
+		statistics.mHits = mHits.load();
+		statistics.mMisses = mMisses.load();
+		statistics.mEvictions = mEvictions.load();
+		return statistics;
+	}
+
+	size_t ASTParseCache::GetSize() const
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < mShardCount; ++i)
+		{
+			std::lock_guard<std::mutex> lock(mShards[i].mMutex);
+			size += mShards[i].mEntries.size();
+		}
+		return size;
+	}
+
+	void ASTParseCache::Clear()
+	{
+		for (size_t i = 0; i < mShardCount; ++i)
+		{
+			std::lock_guard<std::mutex> lock(mShards[i].mMutex);
+			mShards[i].mIndex.clear();
+			mShards[i].mEntries.clear();
+		}
+	}
+}
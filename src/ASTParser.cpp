@@ -13,9 +13,8 @@ namespace AST
 
 	OperatorType GetOperatorNodeType(const ASTNode* node)
 	{
-		if (node && node->mType == ASTNode::NodeType::Operator)
+		if (const OperatorNode* opNode = NodeCast<OperatorNode>(node))
 		{
-			const OperatorNode* opNode = dynamic_cast<const OperatorNode*>(node);
 			return opNode->mOperator->mType;
 		}
 		return OperatorType::Invalid;
@@ -23,18 +22,11 @@ namespace AST
 
 	ASTParserSettings::ASTParserSettings()
 	{
-		if (mCustomSymbolRegistry == nullptr)
-		{
-			mCustomSymbolRegistry = new SymbolRegistry();
-		}
-
 		if (mImplicitOperatorInsertion)
 		{
 			if (mImplicitOperator == nullptr)
 			{
-				mImplicitOperator = std::dynamic_pointer_cast<Operator>(
-					mOperatorRegistry->GetSymbol("*", [&](const std::shared_ptr<Symbol>&) { return true; })
-				);
+				mImplicitOperator = mOperatorRegistry->GetOperator(OperationId::Multiplication);
 			}
 			else if (mImplicitOperator->mType != OperatorType::Binary)
 			{
@@ -43,7 +35,7 @@ namespace AST
 		}
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractRational(const std::string& expression, const size_t& offset)
+	ASTParser::ParseResult ASTParser::ExtractRational(std::string_view expression, const size_t& offset, const ASTInputScan* scan)
 	{
 		if (expression.size() <= offset)
 		{
@@ -66,9 +58,14 @@ namespace AST
 		{
 			char c = expression[offset + extractedLength];
 
-			if (std::isdigit(c))
+			if (c >= '0' && c <= '9')
 			{
 				hasDigit = true;
+				if (scan)
+				{
+					// jump to the last digit of the run, the loop steps past it
+					extractedLength = scan->GetDigitRunEnd(offset + extractedLength) - offset - 1;
+				}
 			}
 			else if (c == '.')
 			{
@@ -98,360 +95,1116 @@ namespace AST
 		}
 	}
 
-	Rational ASTParser::ParseRational(const std::string& expression, const size_t& offset, const size_t& mExtractedLength)
+	bool ASTParser::ParseRational(std::string_view expression, const size_t& offset, const size_t& extractedLength, Rational& outValue)
+	{
+		if (extractedLength == 0)
+		{
+			outValue = Rational();
+			return true;
+		}
+
+		return Rational::TryFromDecimalString(expression.substr(offset, extractedLength), outValue);
+	}
+
+	ASTLexer::RegistryList ASTParser::GetRegistries() const
+	{
+		return {
+			mSettings.mParenthesisRegistry,
+			mSettings.mIrrationalRegistry,
+			mSettings.mOperatorRegistry,
+			mSettings.mCustomSymbolRegistry,
+		};
+	}
+
+	const ASTLexer& ASTParser::GetLexer()
+	{
+		ASTLexer::RegistryList registries = GetRegistries();
+
+		if (!mLexer || !mLexer->IsCurrent(registries))
+		{
+			// parsers on the unchanged default registries share one lexer, built once per process
+			static const std::shared_ptr<const ASTLexer> defaultLexer = std::make_shared<const ASTLexer>(ASTLexer::RegistryList{
+				ParenthesisRegistry::GetDefaultRegistry(),
+				IrrationalRegistry::GetDefaultRegistry(),
+				OperatorRegistry::GetDefaultRegistry(),
+				nullptr,
+			});
+			mLexer = defaultLexer->IsCurrent(registries) ? defaultLexer : std::make_shared<const ASTLexer>(registries);
+		}
+		return *mLexer;
+	}
+
+	ASTParser::ParseResult ASTParser::ResolveSymbol(const ASTLexer::Match& match, const TokenCategory category)
 	{
-		if (mExtractedLength == 0)
+		if (const Symbol* symbol = mLexer->GetSymbol(match, category))
 		{
-			return Rational();
+			return ParseResult(match.GetLength(category), symbol);
 		}
-		std::string numberStr = expression.substr(offset, mExtractedLength);
-		return Rational::FromString(numberStr);
+		return ParseResult(0, ResultType::InvalidOperator);
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractSymbol(const SymbolRegistry* symbolRegistry, const std::string& expression, const std::function<bool(const std::shared_ptr<Symbol>&)>& findFirstMatch, const size_t& offset)
+	ASTParser::ParseResult ASTParser::ResolveOperator(const ASTLexer::Match& match, const ASTNode::NodeType& lastNodeType)
+	{
+		// binary operators need a left operand
+		bool allowBinary = lastNodeType != ASTNode::NodeType::Operator && lastNodeType != ASTNode::NodeType::Unknown;
+		if (const Operator* op = mLexer->GetOperator(match, allowBinary))
+		{
+			return ParseResult(match.GetLength(TokenCategory::Operator), op);
+		}
+		return ParseResult(0, ResultType::InvalidOperator);
+	}
+
+	ASTParser::ParseResult ASTParser::ExtractOperator(std::string_view expression, const ASTNode::NodeType& lastNodeType, const size_t& offset)
 	{
 		if (expression.empty())
 		{
 			return ParseResult(0, ResultType::EmptyExpression);
 		}
+		return ResolveOperator(GetLexer().Scan(expression, offset), lastNodeType);
+	}
 
-		std::shared_ptr<SymbolSearchNode> node = symbolRegistry->GetRoot();
-		std::shared_ptr<Symbol> longestMatchSymbol = nullptr;
-		size_t extractedLength = 0;
-		size_t searchLength = 0;
+	ASTParser::ParseResult ASTParser::ExtractIrrational(std::string_view expression, const size_t& offset)
+	{
+		if (expression.empty())
+		{
+			return ParseResult(0, ResultType::EmptyExpression);
+		}
+		return ResolveSymbol(GetLexer().Scan(expression, offset), TokenCategory::Irrational);
+	}
 
-		while (node)
+	ASTParser::ParseResult ASTParser::ExtractParenthesis(std::string_view expression, const size_t& offset)
+	{
+		if (expression.empty())
 		{
-			if (offset + searchLength >= expression.size())
-			{
-				break;
-			}
-			char c = expression[offset + searchLength];
-			if (node->mChildren.find(c) == node->mChildren.end())
-			{
-				break;
-			}
-			node = node->mChildren[c];
-			if (node->mSymbols.size())
-			{
-				longestMatchSymbol = node->FindFirstMatch(findFirstMatch);
-				extractedLength = searchLength + 1;
-			}
-			++searchLength;
+			return ParseResult(0, ResultType::EmptyExpression);
+		}
+		return ResolveSymbol(GetLexer().Scan(expression, offset), TokenCategory::Parenthesis);
+	}
+
+	ASTParser::ParseResult ASTParser::ExtractCustomSymbol(std::string_view expression, const size_t& offset)
+	{
+		if (expression.empty())
+		{
+			return ParseResult(0, ResultType::EmptyExpression);
 		}
+		return ResolveSymbol(GetLexer().Scan(expression, offset), TokenCategory::CustomSymbol);
+	}
 
-		if (longestMatchSymbol)
+	const InternedSymbol& ASTParser::GetUnknownVariable(const char c)
+	{
+		InternedSymbol& variable = mUnknownVariables[static_cast<unsigned char>(c)];
+		if (!variable.mSymbol)
 		{
-			return ParseResult(extractedLength, longestMatchSymbol.get());
+			variable = SymbolInterner::GetDefault().Intern(std::string_view(&c, 1));
+		}
+		return variable;
+	}
+
+	ASTParser::ParseResult ASTParser::ExtractUnknownVariable(std::string_view expression, const size_t& offset)
+	{
+		if (expression.size() > offset)
+		{
+			return ParseResult(1, GetUnknownVariable(expression[offset]).mSymbol);
 		}
 		else
 		{
-			return ParseResult(0, ResultType::InvalidOperator);
+			return ParseResult(0, ResultType::InvalidExpression);
 		}
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractOperator(const std::string& expression, const ASTNode::NodeType& lastNodeType, const size_t& offset)
+	void ASTParser::ParseContext::PushOperand(ASTNode* node)
 	{
-		return ExtractSymbol(mSettings.mOperatorRegistry, expression, [&](const std::shared_ptr<Symbol>& symbol)
-			{
-				const Operator* op = dynamic_cast<const Operator*>(symbol.get());
-				if (op->mType == OperatorType::Binary && (lastNodeType == ASTNode::NodeType::Operator || lastNodeType == ASTNode::NodeType::Unknown)) {
-					return false;
-				}
-				return true; }, offset);
+		mOperandStack.push_back(node);
+		mLastType = node->mType;
+		mLastIsOpenParenthesis = false;
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractIrrational(const std::string& expression, const size_t& offset)
+	void ASTParser::ParseContext::PushRational(const Rational& value)
 	{
-		return ExtractSymbol(mSettings.mIrrationalRegistry, expression, [&](const std::shared_ptr<Symbol>&) { return true; }, offset);
+		if (mPostfix)
+		{
+			mPostfix->PushRational(value);
+			mOperandStack.push_back(nullptr);
+			mLastType = ASTNode::NodeType::Rational;
+			mLastIsOpenParenthesis = false;
+			return;
+		}
+		PushOperand(NewNode<RationalNode>(value));
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractParenthesis(const std::string& expression, const size_t& offset)
+	void ASTParser::ParseContext::PushIrrational(const Symbol* irrational)
 	{
-		return ExtractSymbol(mSettings.mParenthesisRegistry, expression, [&](const std::shared_ptr<Symbol>&) { return true; }, offset);
+		if (mPostfix)
+		{
+			mPostfix->PushIrrational(irrational);
+			mOperandStack.push_back(nullptr);
+			mLastType = ASTNode::NodeType::Irrational;
+			mLastIsOpenParenthesis = false;
+			return;
+		}
+		PushOperand(NewNode<IrrationalNode>(irrational));
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractCustomSymbol(const std::string& expression, const size_t& offset)
+	void ASTParser::ParseContext::PushVariable(const InternedSymbol& variable)
 	{
-		return ExtractSymbol(mSettings.mCustomSymbolRegistry, expression, [&](const std::shared_ptr<Symbol>&) { return true; }, offset);
+		if (mPostfix)
+		{
+			mPostfix->PushVariable(variable);
+			mOperandStack.push_back(nullptr);
+			mLastType = ASTNode::NodeType::Variable;
+			mLastIsOpenParenthesis = false;
+			return;
+		}
+		if (ASTNode* bound = GetBinding(variable.mId))
+		{
+			mOperandStack.push_back(bound);
+			mLastType = ASTNode::NodeType::Variable;
+			mLastIsOpenParenthesis = false;
+			return;
+		}
+		PushOperand(NewNode<VariableNode>(variable));
 	}
 
-	ASTParser::ParseResult ASTParser::ExtractUnknownVariable(const std::string& expression, const size_t& offset)
+	void ASTParser::ParseContext::RecordSpan(ASTNode* node, const SourceSpan& span) const
 	{
-		if (expression.size() > offset)
+		if (mSpans && node)
 		{
-			Symbol* symbol = new Symbol(expression.substr(offset, 1));
-			return ParseResult(1, symbol);
+			mSpans->Record(node, span);
 		}
-		else
+	}
+
+	SourceSpan ASTParser::ParseContext::GetOperatorSpan(const Operator* op, const size_t pos, ASTNode* const* operands, const size_t operandCount) const
+	{
+		SourceSpan span = { pos, pos + op->mSymbol.size() };
+		for (size_t i = 0; i < operandCount; ++i)
 		{
-			return ParseResult(0, ResultType::InvalidExpression);
+			if (const SourceSpan* operandSpan = mSpans->Find(operands[i]))
+			{
+				span.mBegin = std::min(span.mBegin, operandSpan->mBegin);
+				span.mEnd = std::max(span.mEnd, operandSpan->mEnd);
+			}
 		}
+		return span;
 	}
 
-	void ASTParser::ReduceOperator(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, OperatorNode* topOperator)
+	uint32_t ASTParser::ParseContext::GetLeafDepth(const ASTNode* node) const
 	{
-		if (topOperator->mOperator->mType == OperatorType::Binary)
+		if (mBindingDepths)
 		{
-			if (operandStack.size() < 2)
+			auto it = mBindingDepths->find(node);
+			if (it != mBindingDepths->end())
 			{
-				throw std::runtime_error("Invalid expression");
+				return it->second;
 			}
+		}
+		return 1;
+	}
 
-			ASTNode* right = operandStack.back();
-			operandStack.pop_back();
-			ASTNode* left = operandStack.back();
-			operandStack.pop_back();
-			operatorStack.pop_back();
+	uint32_t ASTParser::ParseContext::ReduceOperandDepths(const size_t operandCount)
+	{
+		for (size_t i = mOperandDepths.size(); i < mOperandStack.size(); ++i)
+		{
+			mOperandDepths.push_back(GetLeafDepth(mOperandStack[i]));
+		}
 
-			topOperator->mOperands.push_back(left);
-			topOperator->mOperands.push_back(right);
+		uint32_t depth = 0;
+		for (size_t i = mOperandDepths.size() - operandCount; i < mOperandDepths.size(); ++i)
+		{
+			depth = std::max(depth, mOperandDepths[i]);
+		}
+		mOperandDepths.resize(mOperandDepths.size() - operandCount);
+		mOperandDepths.push_back(depth + 1);
+		return depth + 1;
+	}
 
-			operandStack.push_back(topOperator);
+	bool ASTParser::ParseContext::Fail(const size_t pos, const ResultType type)
+	{
+		if (mErrorType == ResultType::NoError)
+		{
+			mErrorPos = pos;
+			mErrorType = type;
 		}
-		else if (topOperator->mOperator->mType == OperatorType::Unary)
+		return false;
+	}
+
+	void ASTParser::ParseContext::ReleaseOperands()
+	{
+		for (ASTNode* operand : mOperandStack)
 		{
-			if (operandStack.empty())
+			if (operand && operand->mOwnership == ASTNode::NodeOwnership::Heap)
 			{
-				throw std::runtime_error("Invalid expression");
+				delete operand;
 			}
+		}
+		mOperandStack.clear();
+		mOperatorStack.clear();
+	}
 
-			ASTNode* operand = operandStack.back();
-			operandStack.pop_back();
-			operatorStack.pop_back();
-			topOperator->mOperands.push_back(operand);
-			operandStack.push_back(topOperator);
+	ASTNode* ASTParser::ParseContext::GetBinding(const uint32_t id) const
+	{
+		if (mBindings)
+		{
+			for (const auto& [bindingId, node] : *mBindings)
+			{
+				if (bindingId == id)
+				{
+					return node;
+				}
+			}
 		}
-		else if (topOperator->mOperator->mType == OperatorType::FunctionSingular)
+		return nullptr;
+	}
+
+	void ASTParser::ParseContext::ReleaseNode(ASTNode* node) const
+	{
+		if (node && node->mOwnership == ASTNode::NodeOwnership::Heap)
 		{
-			ASTNode* operand = operandStack.back();
-			operandStack.pop_back();
-			operatorStack.pop_back();
-			topOperator->mOperands.push_back(operand);
-			operandStack.push_back(topOperator);
+			delete node;
+		}
+	}
+
+	bool ASTParser::ReduceOperator(ParseContext& context)
+	{
+		const PendingOperator top = context.mOperatorStack.back();
+		context.mOperatorStack.pop_back();
+
+		size_t operandCount = ASTPostfix::GetOperandCount(top.mOperator->mType);
+		if (operandCount == 0)
+		{
+			// argument lists are not supported by this parser
+			return context.Fail(top.mPos, ResultType::InvalidOperator);
+		}
+
+		std::vector<ASTNode*>& operandStack = context.mOperandStack;
+		if (operandStack.size() - top.mOperandBase < operandCount)
+		{
+			return context.Fail(top.mPos, ResultType::InvalidExpression);
 		}
-		else if (topOperator->mOperator->mType == OperatorType::FunctionDual)
+		if (mSettings.mMaxDepth && !CheckLimits(context, context.ReduceOperandDepths(operandCount), top.mPos))
+		{
+			return false;
+		}
+
+		if (context.mPostfix)
+		{
+			// two literals on top of the stack are the last two instructions
+			std::vector<PostfixInstruction>& instructions = context.mPostfix->mInstructions;
+			std::vector<Rational>& literals = context.mPostfix->mLiterals;
+			Rational value;
+			if (mSettings.mFoldConstants && operandCount == 2 && instructions.size() >= 2 &&
+				instructions[instructions.size() - 1].mOpcode == PostfixOpcode::Rational &&
+				instructions[instructions.size() - 2].mOpcode == PostfixOpcode::Rational &&
+				FoldConstants(top.mOperator, literals[literals.size() - 2], literals.back(), value))
+			{
+				instructions.pop_back();
+				literals.pop_back();
+				literals.back() = value;
+				operandStack.pop_back();
+				return true;
+			}
+
+			context.mPostfix->PushOperator(top.mOperator);
+			operandStack.resize(operandStack.size() - operandCount);
+			operandStack.push_back(nullptr);
+			return true;
+		}
+
+		if (operandCount == 2)
 		{
 			ASTNode* right = operandStack.back();
 			operandStack.pop_back();
 			ASTNode* left = operandStack.back();
-			operandStack.pop_back();
-			operatorStack.pop_back();
-			topOperator->mOperands.push_back(left);
-			topOperator->mOperands.push_back(right);
-			operandStack.push_back(topOperator);
+			// null once the simplifier ran out of steps, the operands are released with the node
+			operandStack.back() = NewBinaryNode(context, top.mOperator, left, right, top.mPos);
+			return operandStack.back() != nullptr;
 		}
+
+		ASTNode* node = NewOperatorNode(context, top.mOperator, operandStack.data() + operandStack.size() - operandCount, operandCount, top.mPos);
+		operandStack.resize(operandStack.size() - operandCount);
+		operandStack.push_back(node);
+		return node != nullptr;
 	}
 
-	void ASTParser::HandleOperatorExtraction(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, const Symbol* operatorSymbol)
+	ASTNode* ASTParser::NewBinaryNode(ParseContext& context, const Operator* op, ASTNode* left, ASTNode* right, const size_t pos) const
 	{
-		const Operator* op = dynamic_cast<const Operator*>(operatorSymbol);
-		while (!operatorStack.empty())
+		// an array, a parse allocates nothing per operator but the node
+		ASTNode* operands[] = { left, right };
+
+		// recorded groups must stay in the tree, so nothing is folded while they are
+		Rational value;
+		if (mSettings.mFoldConstants && !context.mGroups &&
+			left->mType == ASTNode::NodeType::Rational && right->mType == ASTNode::NodeType::Rational &&
+			FoldConstants(op, static_cast<RationalNode*>(left)->mValue, static_cast<RationalNode*>(right)->mValue, value))
 		{
-			ASTNode* top = operatorStack.back();
-			if (top->mType == ASTNode::NodeType::Parenthesis)
+			const SourceSpan span = context.mSpans ? context.GetOperatorSpan(op, pos, operands, 2) : SourceSpan();
+
+			// arena nodes may be shared by ParseProgram bindings, only heap literals are reused
+			ASTNode* literal = left;
+			if (left->mOwnership == ASTNode::NodeOwnership::Heap)
 			{
-				break;
+				static_cast<RationalNode*>(left)->mValue = value;
+				context.ReleaseNode(right);
 			}
-			else if (top->mType == ASTNode::NodeType::Operator)
+			else
 			{
-				OperatorNode* operatorNode = dynamic_cast<OperatorNode*>(top);
-				if (operatorNode->mOperator->mPrecedence >= op->mPrecedence)
-				{
-					ReduceOperator(operandStack, operatorStack, operatorNode);
-				}
-				else
-				{
-					break;
-				}
+				literal = context.NewNode<RationalNode>(value);
 			}
+			context.RecordSpan(literal, span);
+			return literal;
+		}
+		return NewOperatorNode(context, op, operands, 2, pos);
+	}
+
+	ASTNode* ASTParser::NewOperatorNode(ParseContext& context, const Operator* op, ASTNode* const* operands, const size_t operandCount, const size_t pos) const
+	{
+		OperatorNode* node = context.NewNode<OperatorNode>(op, operands, operandCount);
+		if (context.mSpans)
+		{
+			context.RecordSpan(node, context.GetOperatorSpan(op, pos, operands, operandCount));
+		}
+		if (!context.mSimplifier)
+		{
+			return node;
 		}
 
-		operatorStack.push_back(new OperatorNode(op));
+		// the rules build their result from copies, the reduced operands are released with the node
+		SimplifyResult result;
+		if (!context.mSimplifier->SimplifyOperation(op->mOperationId, std::vector<ASTNode*>(operands, operands + operandCount), context.mSimplifySteps, result))
+		{
+			context.ReleaseNode(node);
+			context.Fail(pos, ResultType::ResourceLimitExceeded);
+			return nullptr;
+		}
+		if (!result.mSuccess)
+		{
+			return node;
+		}
+		if (context.mSpans)
+		{
+			context.mSpans->Propagate(node, result.mResult);
+		}
+		context.ReleaseNode(node);
+		return result.mResult;
 	}
 
-	void ASTParser::ImplicitOperatorInsertion(std::deque<ASTNode*>& operandStack, std::deque<ASTNode*>& operatorStack, const ASTNode* lastNode)
+	bool ASTParser::FoldConstants(const Operator* op, const Rational& left, const Rational& right, Rational& outValue)
 	{
-		if (!mSettings.mImplicitOperatorInsertion || GetNodeType(lastNode) == ASTNode::NodeType::Operator || GetNodeType(lastNode) == ASTNode::NodeType::Unknown)
+		if (op->mType != OperatorType::Binary)
 		{
-			return;
+			return false;
 		}
 
-		if (operatorStack.size() != 0)
+		switch (op->mOperationId)
 		{
-			ASTNode* top = operatorStack.back();
-			if (top->mType == ASTNode::NodeType::Parenthesis)
+		case OperationId::Addition:
+			return left.TryAdd(right, outValue);
+		case OperationId::Subtraction:
+			return left.TrySubtract(right, outValue);
+		case OperationId::Multiplication:
+			return left.TryMultiply(right, outValue);
+		case OperationId::Division:
+			return left.TryDivide(right, outValue);
+		default:
+			return false;
+		}
+	}
+
+	bool ASTParser::HandleOperatorExtraction(ParseContext& context, const Operator* op, const size_t pos)
+	{
+		while (!context.mOperatorStack.empty())
+		{
+			const PendingOperator& top = context.mOperatorStack.back();
+			// a right associative binary operator stays on the stack to take the next one as its right operand
+			if (!top.mOperator || top.mOperator->mPrecedence < op->mPrecedence ||
+				(top.mOperator->mPrecedence == op->mPrecedence && op->mType == OperatorType::Binary && op->mAssociativity == Associativity::RightToLeft))
 			{
-				ParenthesisNode* topParenthesisNode = dynamic_cast<ParenthesisNode*>(top);
-				if (topParenthesisNode->mParenthesis->mIsOpen)
-				{
-					return;
-				}
+				break;
 			}
+			if (!ReduceOperator(context))
+			{
+				return false;
+			}
+		}
+
+		// prefix operators only take the operands that follow them
+		bool isPrefix = op->mType != OperatorType::Binary &&
+			(op->mType != OperatorType::Unary || context.mLastType == ASTNode::NodeType::Operator || context.mLastType == ASTNode::NodeType::Unknown || context.mLastIsOpenParenthesis);
+		size_t operandBase = isPrefix ? context.mOperandStack.size() : context.mGroupBase;
+
+		context.mOperatorStack.push_back({ op, nullptr, pos, operandBase });
+		context.mLastType = ASTNode::NodeType::Operator;
+		context.mLastIsOpenParenthesis = false;
+		return true;
+	}
+
+	bool ASTParser::ImplicitOperatorInsertion(ParseContext& context, const size_t pos)
+	{
+		if (!mSettings.mImplicitOperatorInsertion || context.mLastType == ASTNode::NodeType::Operator || context.mLastType == ASTNode::NodeType::Unknown)
+		{
+			return true;
+		}
+
+		if (context.mLastIsOpenParenthesis)
+		{
+			return true;
+		}
+
+		return HandleOperatorExtraction(context, mSettings.mImplicitOperator.get(), pos);
+	}
+
+	bool ASTParser::ShouldParseRational(const ASTNode::NodeType lastType, const bool lastIsOpenParenthesis)
+	{
+		if (lastType == ASTNode::NodeType::Parenthesis)
+		{
+			return lastIsOpenParenthesis;
 		}
 
-		HandleOperatorExtraction(operandStack, operatorStack, mSettings.mImplicitOperator.get());
+		return lastType != ASTNode::NodeType::Rational;
+	}
+
+	ASTNode* ASTParser::Parse(std::string_view expression)
+	{
+		ParseContext context;
+		return ParseInternal(expression, context);
+	}
+
+	ASTParser::ParsedExpression ASTParser::TryParse(std::string_view expression) noexcept
+	{
+		ParseContext context;
+
+		ParsedExpression parsed;
+		parsed.mRoot = ParseInternal(expression, context);
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		return parsed;
+	}
+
+	ASTParser::ParsedExpression ASTParser::ParseToPostfix(std::string_view expression, ASTPostfix& outPostfix) noexcept
+	{
+		outPostfix.Clear();
+
+		ParseContext context;
+		context.mPostfix = &outPostfix;
+		ParseInternal(expression, context);
+
+		ParsedExpression parsed;
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		if (!parsed)
+		{
+			outPostfix.Clear();
+		}
+		return parsed;
+	}
+
+	ASTParser::ParsedExpression ASTParser::ParseAndSimplify(std::string_view expression, const ASTSimplifier& simplifier)
+	{
+		ParseContext context;
+		context.mSimplifier = &simplifier;
+
+		ParsedExpression parsed;
+		parsed.mRoot = ParseInternal(expression, context);
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		return parsed;
+	}
+
+	ASTParser::ParsedExpression ASTParser::ParseWithSpans(std::string_view expression, ASTSourceSpans& outSpans)
+	{
+		ParseContext context;
+		context.mSpans = &outSpans;
+
+		ParsedExpression parsed;
+		parsed.mRoot = ParseInternal(expression, context);
+		parsed.mErrorPos = context.mErrorPos;
+		parsed.mErrorType = context.mErrorType;
+		return parsed;
 	}
 
-	bool ShouldParseRational(const ASTNode* lastNode)
+	ASTArenaTree ASTParser::ParseToArena(std::string_view expression, const size_t blockSize)
 	{
-		const ASTNode::NodeType lastNodeType = GetNodeType(lastNode);
-		if (lastNodeType == ASTNode::NodeType::Parenthesis)
+		std::unique_ptr<ASTNodeArena> arena = std::make_unique<ASTNodeArena>(blockSize);
+
+		ParseContext context;
+		context.mArena = arena.get();
+		ASTNode* root = ParseInternal(expression, context);
+		if (!root)
 		{
-			const ParenthesisNode* lastParenthesisNode = dynamic_cast<const ParenthesisNode*>(lastNode);
-			return lastParenthesisNode->mParenthesis->mIsOpen;
+			return {};
 		}
+		return ASTArenaTree(std::move(arena), root);
+	}
 
-		return lastNodeType != ASTNode::NodeType::Rational;
+	bool ASTParser::PreValidate(std::string_view expression, ParseContext& context)
+	{
+		if (!mSettings.mPreValidateInput)
+		{
+			return true;
+		}
+
+		// one per thread, so parallel terms and batches do not share the bitmaps
+		thread_local ASTInputScan inputScan;
+		if (!inputScan.Scan(expression, GetRegistries(), mSettings.mMatchExactParenthesis))
+		{
+			ResultType type = inputScan.GetError() == ASTInputScan::ScanError::InvalidCharacter ? ResultType::InvalidCharacter : ResultType::InvalidParenthesis;
+			return context.Fail(inputScan.GetErrorPos(), type);
+		}
+		context.mInputScan = &inputScan;
+		return true;
+	}
+
+	bool ASTParser::CheckLimits(ParseContext& context, const size_t depth, const size_t pos) const
+	{
+		if ((mSettings.mMaxNodeCount && context.mNodeCount > mSettings.mMaxNodeCount) ||
+			(mSettings.mMaxDepth && (depth > mSettings.mMaxDepth || context.mParenthesisDepth > mSettings.mMaxDepth)))
+		{
+			return context.Fail(pos, ResultType::ResourceLimitExceeded);
+		}
+		return true;
 	}
 
-	ASTNode* ASTParser::Parse(const std::string& expression)
+	bool ASTParser::ParseTokens(std::string_view expression, ParseContext& context)
 	{
-		std::deque<ASTNode*> operandStack;
-		std::deque<ASTNode*> operatorStack;
-		ASTNode* lastNode = nullptr;
+		std::vector<PendingOperator>& operatorStack = context.mOperatorStack;
+		const ASTLexer& lexer = GetLexer();
+
+		if (!PreValidate(expression, context))
+		{
+			return false;
+		}
 
 		size_t offset = 0;
 		while (offset < expression.size())
 		{
 			if (expression[offset] == ' ')
 			{
-				++offset;
+				offset = context.mInputScan ? context.mInputScan->SkipWhitespace(offset) : offset + 1;
 				continue;
 			}
 
-			ParseResult result = ExtractParenthesis(expression, offset);
-			if (!result.HasError())
+			if (!CheckLimits(context, 0, offset))
 			{
-				ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+				return false;
+			}
 
-				ParenthesisNode* parenthesisNode = new ParenthesisNode(result.mSymbol);
-				offset += result.mExtractedLength;
-				lastNode = parenthesisNode;
+			// one scan classifies the token for every registry
+			const ASTLexer::Match match = lexer.Scan(expression, offset);
+
+			ParseResult result = ResolveSymbol(match, TokenCategory::Parenthesis);
+			if (!result.HasError())
+			{
+				const Parenthesis* parenthesis = static_cast<const Parenthesis*>(result.mSymbol);
 
-				if (parenthesisNode->mParenthesis->mIsOpen)
+				if (parenthesis->mIsOpen)
 				{
-					operatorStack.push_back(parenthesisNode);
+					if (!ImplicitOperatorInsertion(context, offset))
+					{
+						return false;
+					}
+					context.mGroupBase = context.mOperandStack.size();
+					operatorStack.push_back({ nullptr, parenthesis, offset, context.mGroupBase });
+					++context.mParenthesisDepth;
 				}
 				else // closing parenthesis
 				{
-					while (!operatorStack.empty())
+					while (true)
 					{
-						ASTNode* top = operatorStack.back();
-						if (top->mType == ASTNode::NodeType::Parenthesis)
+						if (operatorStack.empty())
 						{
-							ParenthesisNode* topParenthesisNode = dynamic_cast<ParenthesisNode*>(top);
+							return context.Fail(offset, ResultType::InvalidParenthesis);
+						}
 
-							if ((!mSettings.mMatchExactParenthesis &&
-								!topParenthesisNode->mParenthesis->mIsOpen) ||
-								(mSettings.mMatchExactParenthesis &&
-									topParenthesisNode->mParenthesis->IsOpposite(parenthesisNode->mParenthesis)))
+						const PendingOperator& top = operatorStack.back();
+						if (top.mParenthesis)
+						{
+							if (mSettings.mMatchExactParenthesis && !top.mParenthesis->IsOpposite(parenthesis))
+							{
+								return context.Fail(offset, ResultType::InvalidParenthesis);
+							}
+							if (context.mOperandStack.size() != top.mOperandBase + 1)
 							{
-								operatorStack.pop_back();
-								break;
+								return context.Fail(offset, ResultType::InvalidExpression);
 							}
-							else
+							context.RecordSpan(context.mOperandStack.back(), { top.mPos, offset + result.mExtractedLength });
+							if (context.mGroups)
+							{
+								size_t contentBegin = top.mPos + top.mParenthesis->mSymbol.size();
+								context.mGroups->push_back({ top.mPos, contentBegin, offset, offset + result.mExtractedLength, context.mOperandStack.back() });
+							}
+							operatorStack.pop_back();
+							--context.mParenthesisDepth;
+
+							// back to the group of the next enclosing parenthesis
+							context.mGroupBase = 0;
+							for (size_t i = operatorStack.size(); i-- > 0;)
 							{
-								// TODO: Handle mismatched parenthesis, report error
-								return nullptr;
+								if (operatorStack[i].mParenthesis)
+								{
+									context.mGroupBase = operatorStack[i].mOperandBase;
+									break;
+								}
 							}
+							break;
 						}
-						else if (top->mType == ASTNode::NodeType::Operator)
+
+						if (!ReduceOperator(context))
 						{
-							ReduceOperator(operandStack, operatorStack, dynamic_cast<OperatorNode*>(top));
+							return false;
 						}
 					}
 				}
+
+				offset += result.mExtractedLength;
+				context.mLastType = ASTNode::NodeType::Parenthesis;
+				context.mLastIsOpenParenthesis = parenthesis->mIsOpen;
 				continue;
 			}
 
-			if (ShouldParseRational(lastNode))
+			if (ShouldParseRational(context.mLastType, context.mLastIsOpenParenthesis))
 			{
-				result = ExtractRational(expression, offset);
+				result = ExtractRational(expression, offset, context.mInputScan);
 				if (!result.HasError())
 				{
-					ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+					Rational value;
+					if (!ParseRational(expression, offset, result.mExtractedLength, value))
+					{
+						return context.Fail(offset, ResultType::InvalidNumberFormat);
+					}
+					if (!ImplicitOperatorInsertion(context, offset))
+					{
+						return false;
+					}
 
-					operandStack.push_back(new RationalNode(ParseRational(expression, offset, result.mExtractedLength)));
+					context.PushRational(value);
+					context.RecordSpan(context.mOperandStack.back(), { offset, offset + result.mExtractedLength });
 					offset += result.mExtractedLength;
-					lastNode = operandStack.back();
 					continue;
 				}
 			}
 
-			result = ExtractIrrational(expression, offset);
+			result = ResolveSymbol(match, TokenCategory::Irrational);
 			if (!result.HasError())
 			{
-				ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+				if (!ImplicitOperatorInsertion(context, offset))
+				{
+					return false;
+				}
 
-				operandStack.push_back(new IrrationalNode(result.mSymbol));
+				context.PushIrrational(result.mSymbol);
+				context.RecordSpan(context.mOperandStack.back(), { offset, offset + result.mExtractedLength });
 				offset += result.mExtractedLength;
-				lastNode = operandStack.back();
 				continue;
 			}
 
-			result = ExtractOperator(expression, GetNodeType(lastNode), offset);
+			// an opening parenthesis starts a new operand, like the start of the expression
+			result = ResolveOperator(match, context.mLastIsOpenParenthesis ? ASTNode::NodeType::Unknown : context.mLastType);
 			if (!result.HasError())
 			{
-				const Operator* op = dynamic_cast<const Operator*>(result.mSymbol);
+				const Operator* op = static_cast<const Operator*>(result.mSymbol);
 				if (op->mType == OperatorType::FunctionDual || op->mType == OperatorType::FunctionMultiple || op->mType == OperatorType::FunctionSingular)
 				{
-					ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+					if (!ImplicitOperatorInsertion(context, offset))
+					{
+						return false;
+					}
 				}
 
-				HandleOperatorExtraction(operandStack, operatorStack, result.mSymbol);
+				if (!HandleOperatorExtraction(context, op, offset))
+				{
+					return false;
+				}
 				offset += result.mExtractedLength;
-				lastNode = operatorStack.back();
-
 				continue;
 			}
 
-			result = ExtractCustomSymbol(expression, offset);
-			if (!result.HasError())
+			InternedSymbol variable = lexer.GetVariable(match);
+			size_t variableLength = match.GetLength(TokenCategory::CustomSymbol);
+			if (!variable.mSymbol)
+			{
+				// Unknown character fallback
+				variable = GetUnknownVariable(expression[offset]);
+				variableLength = 1;
+			}
+
+			if (!ImplicitOperatorInsertion(context, offset))
 			{
-				ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+				return false;
+			}
 
-				operandStack.push_back(new VariableNode(result.mSymbol));
-				offset += result.mExtractedLength;
-				lastNode = operandStack.back();
-				continue;
+			context.PushVariable(variable);
+			context.RecordSpan(context.mOperandStack.back(), { offset, offset + variableLength });
+			offset += variableLength;
+		}
+
+		while (!operatorStack.empty())
+		{
+			const PendingOperator& top = operatorStack.back();
+			if (top.mParenthesis)
+			{
+				return context.Fail(top.mPos, ResultType::InvalidParenthesis);
 			}
+			if (!ReduceOperator(context))
+			{
+				return false;
+			}
+		}
 
-			// Unknown character fallback
-			result = ExtractUnknownVariable(expression, offset);
-			if (!result.HasError())
+		if (context.mOperandStack.empty())
+		{
+			return context.Fail(0, ResultType::EmptyExpression);
+		}
+		if (context.mOperandStack.size() != 1)
+		{
+			// dangling operands, only possible without implicit operator insertion
+			return context.Fail(expression.size(), ResultType::InvalidExpression);
+		}
+		return true;
+	}
+
+	ASTNode* ASTParser::ParseInternal(std::string_view expression, ParseContext& context)
+	{
+		if (mSettings.mMaxInputLength && expression.size() > mSettings.mMaxInputLength)
+		{
+			context.Fail(mSettings.mMaxInputLength, ResultType::ResourceLimitExceeded);
+			return nullptr;
+		}
+
+		if (mSettings.mEngine == ParserEngine::PrecedenceClimbing && !context.mPostfix && !context.mGroups)
+		{
+			return ParseClimbing(expression, context);
+		}
+
+		if (!ParseTokens(expression, context))
+		{
+			context.ReleaseOperands();
+			return nullptr;
+		}
+
+		ASTNode* root = context.mOperandStack.back();
+		context.mOperandStack.clear();
+		context.mNodeDepth = context.mOperandDepths.empty() ? context.GetLeafDepth(root) : context.mOperandDepths.back();
+		return root;
+	}
+
+	std::vector<ASTParser::ParsedExpression> ASTParser::ParseBatch(const std::vector<std::string_view>& expressions, ASTWorkerPool& pool)
+	{
+		std::vector<ParsedExpression> results(expressions.size());
+
+		// build the lexer once so every worker copy shares it
+		GetLexer();
+		std::vector<ASTParser> workers(pool.GetWorkerCount(), *this);
+
+		pool.ParallelFor(expressions.size(), [&](size_t workerIndex, size_t begin, size_t end)
 			{
-				ImplicitOperatorInsertion(operandStack, operatorStack, lastNode);
+				ASTParser& parser = workers[workerIndex];
+				for (size_t i = begin; i < end; ++i)
+				{
+					results[i] = parser.TryParse(expressions[i]);
+				}
+			});
 
-				operandStack.push_back(new VariableNode(result.mSymbol));
-				offset += result.mExtractedLength;
-				lastNode = operandStack.back();
+		return results;
+	}
+
+	bool ASTParser::GetSplitBytes(std::array<bool, 256>& outSplitBytes, std::array<int8_t, 256>& outDepthDelta) const
+	{
+		outSplitBytes.fill(false);
+		outDepthDelta.fill(0);
+
+		for (const std::shared_ptr<Symbol>& symbol : mSettings.mParenthesisRegistry->GetSymbols())
+		{
+			const Parenthesis* parenthesis = static_cast<const Parenthesis*>(symbol.get());
+			if (parenthesis->mSymbol.size() != 1)
+			{
+				return false;
+			}
+			outDepthDelta[static_cast<unsigned char>(parenthesis->mSymbol[0])] = parenthesis->mIsOpen ? 1 : -1;
+		}
+
+		std::vector<std::shared_ptr<Symbol>> operators = mSettings.mOperatorRegistry->GetSymbols();
+		uint16_t minPrecedence = UINT16_MAX;
+		for (const std::shared_ptr<Symbol>& symbol : operators)
+		{
+			minPrecedence = std::min(minPrecedence, static_cast<const Operator*>(symbol.get())->mPrecedence);
+		}
+
+		// the sequential parse reduces everything on the stack before these operators, left to right
+		for (const std::shared_ptr<Symbol>& symbol : operators)
+		{
+			const Operator* op = static_cast<const Operator*>(symbol.get());
+			if (op->mType == OperatorType::Binary && op->mAssociativity == Associativity::LeftToRight && op->mPrecedence == minPrecedence && op->mSymbol.size() == 1)
+			{
+				unsigned char c = static_cast<unsigned char>(op->mSymbol[0]);
+				outSplitBytes[c] = outDepthDelta[c] == 0 && c != ' ' && c != '.' && !(c >= '0' && c <= '9');
+			}
+		}
+
+		// a split byte must always start a token
+		const SymbolRegistry* registries[] = {
+			mSettings.mParenthesisRegistry,
+			mSettings.mIrrationalRegistry,
+			mSettings.mOperatorRegistry,
+			mSettings.mCustomSymbolRegistry,
+		};
+		for (const SymbolRegistry* registry : registries)
+		{
+			if (!registry)
+			{
 				continue;
 			}
+			for (const std::shared_ptr<Symbol>& symbol : registry->GetSymbols())
+			{
+				for (size_t i = 1; i < symbol->mSymbol.size(); ++i)
+				{
+					unsigned char c = static_cast<unsigned char>(symbol->mSymbol[i]);
+					if (outDepthDelta[c] != 0)
+					{
+						return false;
+					}
+					outSplitBytes[c] = false;
+				}
+			}
 		}
 
-		while (!operatorStack.empty())
+		for (const bool isSplitByte : outSplitBytes)
 		{
-			OperatorNode* operatorNode = dynamic_cast<OperatorNode*>(operatorStack.back());
-			ReduceOperator(operandStack, operatorStack, operatorNode);
+			if (isSplitByte)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ASTParser::ParseTerm(std::string_view expression, ParallelTerm& term)
+	{
+		ParseContext context;
+		term.mRoot = ParseInternal(expression.substr(term.mBegin, term.mEnd - term.mBegin), context);
+		term.mLastType = context.mLastType;
+		term.mLastIsOpenParenthesis = context.mLastIsOpenParenthesis;
+	}
+
+	const Operator* ASTParser::GetSplitOperator(std::string_view expression, const ParallelTerm& term, const std::array<bool, 256>& splitBytes)
+	{
+		const size_t pos = term.mEnd;
+		if (!term.mRoot || pos >= expression.size() || !splitBytes[static_cast<unsigned char>(expression[pos])])
+		{
+			return nullptr;
 		}
 
-		if (operandStack.size() != 1)
+		// same decisions as ParseTokens after the term's last token
+		if (ShouldParseRational(term.mLastType, term.mLastIsOpenParenthesis) && !ExtractRational(expression, pos).HasError())
 		{
-			// TODO: Handle dangling operands, report error
 			return nullptr;
 		}
 
-		return operandStack.back();
+		const ASTLexer::Match match = mLexer->Scan(expression, pos);
+		if (match.Has(TokenCategory::Parenthesis) || match.Has(TokenCategory::Irrational) || match.GetLength(TokenCategory::Operator) != 1)
+		{
+			return nullptr;
+		}
+
+		const Operator* op = mLexer->GetOperator(match, !term.mLastIsOpenParenthesis && term.mLastType != ASTNode::NodeType::Operator && term.mLastType != ASTNode::NodeType::Unknown);
+		return op && op->mType == OperatorType::Binary ? op : nullptr;
+	}
+
+	ASTParser::ParsedExpression ASTParser::ParseParallel(std::string_view expression, ASTWorkerPool& pool, const size_t minParallelLength)
+	{
+		std::array<bool, 256> splitBytes;
+		std::array<int8_t, 256> depthDelta;
+		GetLexer();
+		// the limits are enforced by the sequential parse
+		if (expression.size() < minParallelLength || pool.GetWorkerCount() == 1 || HasResourceLimits() || !GetSplitBytes(splitBytes, depthDelta))
+		{
+			return TryParse(expression);
+		}
+
+		// depth of every block start from the net depth change of the blocks before it
+		const size_t blockCount = pool.GetWorkerCount() * 4;
+		std::vector<int64_t> blockDepth(blockCount + 1, 0);
+		std::vector<std::vector<size_t>> blockSplits(blockCount);
+		std::vector<uint8_t> blockUnbalanced(blockCount, 0);
+		auto blockBegin = [&](size_t block) { return expression.size() * block / blockCount; };
+
+		pool.ParallelFor(blockCount, [&](size_t, size_t begin, size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					int64_t depth = 0;
+					for (size_t i = blockBegin(block); i < blockBegin(block + 1); ++i)
+					{
+						depth += depthDelta[static_cast<unsigned char>(expression[i])];
+					}
+					blockDepth[block + 1] = depth;
+				}
+			}, 1);
+
+		for (size_t block = 0; block < blockCount; ++block)
+		{
+			blockDepth[block + 1] += blockDepth[block];
+		}
+		if (blockDepth[blockCount] != 0)
+		{
+			return TryParse(expression);
+		}
+
+		pool.ParallelFor(blockCount, [&](size_t, size_t begin, size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					int64_t depth = blockDepth[block];
+					for (size_t i = blockBegin(block); i < blockBegin(block + 1); ++i)
+					{
+						const unsigned char c = static_cast<unsigned char>(expression[i]);
+						depth += depthDelta[c];
+						blockUnbalanced[block] |= depth < 0;
+						if (depth == 0 && splitBytes[c])
+						{
+							blockSplits[block].push_back(i);
+						}
+					}
+				}
+			}, 1);
+
+		std::vector<ParallelTerm> terms;
+		size_t termBegin = 0;
+		for (size_t block = 0; block < blockCount; ++block)
+		{
+			if (blockUnbalanced[block])
+			{
+				return TryParse(expression);
+			}
+			for (const size_t split : blockSplits[block])
+			{
+				terms.push_back({ termBegin, split });
+				termBegin = split + 1;
+			}
+		}
+		terms.push_back({ termBegin, expression.size() });
+
+		std::vector<ASTParser> workers(pool.GetWorkerCount(), *this);
+		std::vector<size_t> pending(terms.size());
+		for (size_t i = 0; i < pending.size(); ++i)
+		{
+			pending[i] = i;
+		}
+
+		// Candidates that turn out to be a sign or a unary operator join the next term, and so
+		// does a term that failed, once. Merged terms are parsed again until every split is confirmed.
+		while (!pending.empty())
+		{
+			pool.ParallelFor(pending.size(), [&](size_t workerIndex, size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; ++i)
+					{
+						ParallelTerm& term = terms[pending[i]];
+						workers[workerIndex].ParseTerm(expression, term);
+						term.mDirty = false;
+					}
+				}, 64);
+			pending.clear();
+
+			std::vector<ParallelTerm> merged;
+			merged.reserve(terms.size());
+			for (ParallelTerm& term : terms)
+			{
+				if (!merged.empty() && !merged.back().mDirty)
+				{
+					ParallelTerm& previous = merged.back();
+					previous.mNextOperator = GetSplitOperator(expression, previous, splitBytes);
+					if (!previous.mNextOperator && (previous.mRoot || !previous.mRetried))
+					{
+						previous.mRetried = !previous.mRoot;
+						delete previous.mRoot;
+						delete term.mRoot;
+						previous.mRoot = nullptr;
+						previous.mEnd = term.mEnd;
+						previous.mDirty = true;
+						pending.push_back(merged.size() - 1);
+						continue;
+					}
+				}
+				merged.push_back(term);
+			}
+			terms.swap(merged);
+		}
+
+		ParsedExpression parsed;
+		for (const ParallelTerm& term : terms)
+		{
+			if (!term.mRoot)
+			{
+				for (const ParallelTerm& other : terms)
+				{
+					delete other.mRoot;
+				}
+				return TryParse(expression);
+			}
+		}
+
+		ParseContext context;
+		parsed.mRoot = terms[0].mRoot;
+		for (size_t i = 1; i < terms.size(); ++i)
+		{
+			parsed.mRoot = NewBinaryNode(context, terms[i - 1].mNextOperator, parsed.mRoot, terms[i].mRoot, terms[i - 1].mEnd);
+		}
+		return parsed;
+	}
+
+	uint64_t ASTParser::GetSettingsFingerprint() const
+	{
+		uint64_t fingerprint = 14695981039346656037ull;
+		auto combine = [&fingerprint](const uint64_t value)
+			{
+				fingerprint = (fingerprint ^ value) * 1099511628211ull;
+			};
+
+		const SymbolRegistry* registries[] = {
+			mSettings.mParenthesisRegistry,
+			mSettings.mIrrationalRegistry,
+			mSettings.mOperatorRegistry,
+			mSettings.mCustomSymbolRegistry,
+		};
+		for (const SymbolRegistry* registry : registries)
+		{
+			combine(registry ? registry->GetInstanceId() : 0);
+			combine(registry ? registry->GetVersion() : 0);
+		}
+		// by value, the address of a freed operator can be reused by a different one
+		if (const Operator* implicitOperator = mSettings.mImplicitOperator.get())
+		{
+			combine(static_cast<uint64_t>(implicitOperator->mOperationId));
+			combine(static_cast<uint64_t>(implicitOperator->mType));
+			combine(implicitOperator->mPrecedence);
+			combine(std::hash<std::string>{}(implicitOperator->mSymbol));
+		}
+		combine(mSettings.mMatchExactParenthesis);
+		combine(mSettings.mImplicitOperatorInsertion);
+		combine(mSettings.mPreValidateInput);
+		combine(mSettings.mFoldConstants);
+		combine(static_cast<uint64_t>(mSettings.mEngine));
+		combine(static_cast<uint64_t>(static_cast<unsigned char>(mSettings.mArgumentSeparator)));
+		combine(mSettings.mMaxInputLength);
+		combine(mSettings.mMaxNodeCount);
+		combine(mSettings.mMaxDepth);
+		return fingerprint;
 	}
 
 	void ASTParser::RegisterCustomSymbol(const std::string& symbol)
 	{
+		if (!mSettings.mCustomSymbolRegistry)
+		{
+			mOwnedCustomSymbolRegistry = std::make_shared<SymbolRegistry>();
+			mSettings.mCustomSymbolRegistry = mOwnedCustomSymbolRegistry.get();
+		}
 		mSettings.mCustomSymbolRegistry->RegisterSymbol(std::make_shared<Symbol>(symbol));
 	}
 
 	void ASTParser::UnregisterCustomSymbol(const std::string& symbol)
 	{
-		mSettings.mCustomSymbolRegistry->UnregisterSymbol(symbol);
+		if (mSettings.mCustomSymbolRegistry)
+		{
+			mSettings.mCustomSymbolRegistry->UnregisterSymbol(symbol);
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,525 @@
+#include "ASTParser.h"
+
+namespace AST
+{
+	bool ASTParser::PeekClimbToken(ClimbState& state, ParseContext& context)
+	{
+		if (state.mHasToken)
+		{
+			return true;
+		}
+
+		std::string_view expression = state.mExpression;
+		size_t offset = state.mOffset;
+		while (offset < expression.size() && expression[offset] == ' ')
+		{
+			offset = context.mInputScan ? context.mInputScan->SkipWhitespace(offset) : offset + 1;
+		}
+
+		if (!CheckLimits(context, 0, offset))
+		{
+			return false;
+		}
+
+		ClimbToken& token = state.mToken;
+		token = ClimbToken();
+		token.mPos = offset;
+		state.mOffset = offset;
+		state.mHasToken = true;
+		if (offset >= expression.size())
+		{
+			return true;
+		}
+
+		// same order of categories as ParseTokens
+		const ASTLexer::Match match = mLexer->Scan(expression, offset);
+
+		ParseResult result = ResolveSymbol(match, TokenCategory::Parenthesis);
+		if (!result.HasError())
+		{
+			token.mType = ClimbToken::Type::Parenthesis;
+			token.mLength = result.mExtractedLength;
+			token.mSymbol = result.mSymbol;
+			return true;
+		}
+
+		if (ShouldParseRational(context.mLastType, context.mLastIsOpenParenthesis))
+		{
+			result = ExtractRational(expression, offset, context.mInputScan);
+			if (!result.HasError())
+			{
+				if (!ParseRational(expression, offset, result.mExtractedLength, token.mValue))
+				{
+					state.mHasToken = false;
+					return context.Fail(offset, ResultType::InvalidNumberFormat);
+				}
+				token.mType = ClimbToken::Type::Rational;
+				token.mLength = result.mExtractedLength;
+				return true;
+			}
+		}
+
+		result = ResolveSymbol(match, TokenCategory::Irrational);
+		if (!result.HasError())
+		{
+			token.mType = ClimbToken::Type::Irrational;
+			token.mLength = result.mExtractedLength;
+			token.mSymbol = result.mSymbol;
+			return true;
+		}
+
+		result = ResolveOperator(match, context.mLastIsOpenParenthesis ? ASTNode::NodeType::Unknown : context.mLastType);
+		if (!result.HasError())
+		{
+			token.mType = ClimbToken::Type::Operator;
+			token.mLength = result.mExtractedLength;
+			token.mSymbol = result.mSymbol;
+			return true;
+		}
+
+		token.mVariable = mLexer->GetVariable(match);
+		token.mLength = match.GetLength(TokenCategory::CustomSymbol);
+		if (token.mVariable.mSymbol)
+		{
+			token.mType = ClimbToken::Type::Variable;
+			return true;
+		}
+
+		if (expression[offset] == mSettings.mArgumentSeparator)
+		{
+			token.mType = ClimbToken::Type::Separator;
+			token.mLength = 1;
+			return true;
+		}
+
+		// Unknown character fallback
+		token.mType = ClimbToken::Type::Variable;
+		token.mVariable = GetUnknownVariable(expression[offset]);
+		token.mLength = 1;
+		return true;
+	}
+
+	void ASTParser::ConsumeClimbToken(ClimbState& state, ParseContext& context)
+	{
+		const ClimbToken& token = state.mToken;
+		context.mLastIsOpenParenthesis = false;
+		switch (token.mType)
+		{
+		case ClimbToken::Type::Rational:
+			context.mLastType = ASTNode::NodeType::Rational;
+			break;
+		case ClimbToken::Type::Irrational:
+			context.mLastType = ASTNode::NodeType::Irrational;
+			break;
+		case ClimbToken::Type::Variable:
+			context.mLastType = ASTNode::NodeType::Variable;
+			break;
+		case ClimbToken::Type::Operator:
+			context.mLastType = ASTNode::NodeType::Operator;
+			state.mLastOperatorPos = token.mPos;
+			break;
+		case ClimbToken::Type::Parenthesis:
+			context.mLastType = ASTNode::NodeType::Parenthesis;
+			context.mLastIsOpenParenthesis = static_cast<const Parenthesis*>(token.mSymbol)->mIsOpen;
+			break;
+		case ClimbToken::Type::Separator:
+			// the next argument starts like the inside of a parenthesis
+			context.mLastType = ASTNode::NodeType::Parenthesis;
+			context.mLastIsOpenParenthesis = true;
+			break;
+		default:
+			break;
+		}
+
+		state.mOffset = token.mPos + token.mLength;
+		state.mHasToken = false;
+	}
+
+	ASTNode* ASTParser::ParseClimbingExpression(ClimbState& state, ParseContext& context, const uint32_t minPrecedence)
+	{
+		// every level of operator or parenthesis nesting recurses at most twice,
+		// input nested deeper than this exceeds mMaxDepth in the tree or in parentheses,
+		// the hard cap keeps the native stack bounded whatever the settings
+		const size_t maxRecursion = mSettings.mMaxDepth ? std::min(2 * mSettings.mMaxDepth, kMaxClimbingRecursion) : kMaxClimbingRecursion;
+		if (state.mRecursionDepth >= maxRecursion)
+		{
+			context.Fail(state.mOffset, ResultType::ResourceLimitExceeded);
+			return nullptr;
+		}
+
+		++state.mRecursionDepth;
+		ASTNode* node = ParseClimbingOperators(state, context, minPrecedence);
+		--state.mRecursionDepth;
+		return node;
+	}
+
+	ASTNode* ASTParser::ParseClimbingOperators(ClimbState& state, ParseContext& context, const uint32_t minPrecedence)
+	{
+		ASTNode* left = ParseClimbingOperand(state, context);
+		if (!left)
+		{
+			return nullptr;
+		}
+		uint32_t leftDepth = context.mNodeDepth;
+
+		while (true)
+		{
+			if (!PeekClimbToken(state, context))
+			{
+				context.ReleaseNode(left);
+				return nullptr;
+			}
+
+			const ClimbToken& token = state.mToken;
+			const Operator* op = nullptr;
+			bool isImplicit = false;
+			if (token.mType == ClimbToken::Type::Operator)
+			{
+				op = static_cast<const Operator*>(token.mSymbol);
+				isImplicit = op->mType != OperatorType::Binary && op->mType != OperatorType::Unary;
+			}
+			else if (token.mType == ClimbToken::Type::Rational || token.mType == ClimbToken::Type::Irrational || token.mType == ClimbToken::Type::Variable)
+			{
+				isImplicit = true;
+			}
+			else if (token.mType == ClimbToken::Type::Parenthesis)
+			{
+				isImplicit = static_cast<const Parenthesis*>(token.mSymbol)->mIsOpen;
+				if (!isImplicit)
+				{
+					break;
+				}
+			}
+			else
+			{
+				// end of the expression or of an argument
+				break;
+			}
+
+			if (isImplicit)
+			{
+				if (!mSettings.mImplicitOperatorInsertion)
+				{
+					break;
+				}
+				op = mSettings.mImplicitOperator.get();
+			}
+			if (op->mPrecedence < minPrecedence)
+			{
+				break;
+			}
+
+			const size_t pos = token.mPos;
+			if (!isImplicit)
+			{
+				ConsumeClimbToken(state, context);
+			}
+
+			if (op->mType == OperatorType::Unary)
+			{
+				// a postfix operator completes its operand like a closing parenthesis
+				left = NewOperatorNode(context, op, &left, 1, pos);
+				if (!left)
+				{
+					return nullptr;
+				}
+				context.mLastType = ASTNode::NodeType::Parenthesis;
+				context.mLastIsOpenParenthesis = false;
+				++leftDepth;
+			}
+			else
+			{
+				// a right associative operator takes the following operators of its own precedence into its right operand
+				const uint32_t rightPrecedence = op->mAssociativity == Associativity::RightToLeft ? op->mPrecedence : op->mPrecedence + 1u;
+				ASTNode* right = ParseClimbingExpression(state, context, rightPrecedence);
+				if (!right)
+				{
+					context.ReleaseNode(left);
+					return nullptr;
+				}
+				left = NewBinaryNode(context, op, left, right, pos);
+				if (!left)
+				{
+					return nullptr;
+				}
+				leftDepth = std::max(leftDepth, context.mNodeDepth) + 1;
+			}
+
+			if (!CheckLimits(context, leftDepth, pos))
+			{
+				context.ReleaseNode(left);
+				return nullptr;
+			}
+		}
+		context.mNodeDepth = leftDepth;
+		return left;
+	}
+
+	ASTNode* ASTParser::ParseClimbingOperand(ClimbState& state, ParseContext& context)
+	{
+		if (!PeekClimbToken(state, context))
+		{
+			return nullptr;
+		}
+
+		const ClimbToken& token = state.mToken;
+		const size_t pos = token.mPos;
+		switch (token.mType)
+		{
+		case ClimbToken::Type::Rational:
+		{
+			ASTNode* node = context.NewNode<RationalNode>(token.mValue);
+			context.RecordSpan(node, { pos, pos + token.mLength });
+			context.mNodeDepth = 1;
+			ConsumeClimbToken(state, context);
+			return node;
+		}
+		case ClimbToken::Type::Irrational:
+		{
+			ASTNode* node = context.NewNode<IrrationalNode>(token.mSymbol);
+			context.RecordSpan(node, { pos, pos + token.mLength });
+			context.mNodeDepth = 1;
+			ConsumeClimbToken(state, context);
+			return node;
+		}
+		case ClimbToken::Type::Variable:
+		{
+			ASTNode* node = context.GetBinding(token.mVariable.mId);
+			if (!node)
+			{
+				node = context.NewNode<VariableNode>(token.mVariable);
+				context.RecordSpan(node, { pos, pos + token.mLength });
+			}
+			context.mNodeDepth = context.GetLeafDepth(node);
+			ConsumeClimbToken(state, context);
+			return node;
+		}
+		case ClimbToken::Type::Operator:
+		{
+			// prefix position: unary operators and functions
+			const Operator* op = static_cast<const Operator*>(token.mSymbol);
+			ConsumeClimbToken(state, context);
+			if (op->mType == OperatorType::FunctionDual || op->mType == OperatorType::FunctionMultiple)
+			{
+				return ParseArgumentList(state, context, op, pos);
+			}
+
+			ASTNode* operand = ParseClimbingExpression(state, context, op->mPrecedence + 1u);
+			if (!operand)
+			{
+				return nullptr;
+			}
+			ASTNode* node = NewOperatorNode(context, op, &operand, 1, pos);
+			if (!node)
+			{
+				return nullptr;
+			}
+			if (!CheckLimits(context, ++context.mNodeDepth, pos))
+			{
+				context.ReleaseNode(node);
+				return nullptr;
+			}
+			return node;
+		}
+		case ClimbToken::Type::Parenthesis:
+		{
+			const Parenthesis* open = static_cast<const Parenthesis*>(token.mSymbol);
+			if (!open->mIsOpen)
+			{
+				break;
+			}
+			ConsumeClimbToken(state, context);
+
+			const size_t enclosingGroupPos = state.mGroupPos;
+			state.mGroupPos = pos;
+			++context.mParenthesisDepth;
+			ASTNode* inner = ParseClimbingExpression(state, context, 0);
+			if (!inner)
+			{
+				return nullptr;
+			}
+			if (!ParseClosingParenthesis(state, context, open, pos))
+			{
+				context.ReleaseNode(inner);
+				return nullptr;
+			}
+			state.mGroupPos = enclosingGroupPos;
+			--context.mParenthesisDepth;
+			context.RecordSpan(inner, { pos, state.mOffset });
+			return inner;
+		}
+		default:
+			break;
+		}
+
+		// an operand is missing: report the operator waiting for it, then the open parenthesis
+		if (context.mLastType == ASTNode::NodeType::Operator)
+		{
+			context.Fail(state.mLastOperatorPos, ResultType::InvalidExpression);
+		}
+		else if (token.mType == ClimbToken::Type::End && state.mGroupPos != static_cast<size_t>(-1))
+		{
+			context.Fail(state.mGroupPos, ResultType::InvalidParenthesis);
+		}
+		else if (token.mType == ClimbToken::Type::End && context.mLastType == ASTNode::NodeType::Unknown)
+		{
+			context.Fail(0, ResultType::EmptyExpression);
+		}
+		else
+		{
+			context.Fail(pos, ResultType::InvalidExpression);
+		}
+		return nullptr;
+	}
+
+	bool ASTParser::ParseClosingParenthesis(ClimbState& state, ParseContext& context, const Parenthesis* open, const size_t openPos)
+	{
+		if (!PeekClimbToken(state, context))
+		{
+			return false;
+		}
+
+		const ClimbToken& token = state.mToken;
+		if (token.mType == ClimbToken::Type::End)
+		{
+			return context.Fail(openPos, ResultType::InvalidParenthesis);
+		}
+		if (token.mType != ClimbToken::Type::Parenthesis || static_cast<const Parenthesis*>(token.mSymbol)->mIsOpen)
+		{
+			return context.Fail(token.mPos, ResultType::InvalidExpression);
+		}
+		if (mSettings.mMatchExactParenthesis && !open->IsOpposite(static_cast<const Parenthesis*>(token.mSymbol)))
+		{
+			return context.Fail(token.mPos, ResultType::InvalidParenthesis);
+		}
+		ConsumeClimbToken(state, context);
+		return true;
+	}
+
+	ASTNode* ASTParser::ParseArgumentList(ClimbState& state, ParseContext& context, const Operator* function, const size_t pos)
+	{
+		if (!PeekClimbToken(state, context))
+		{
+			return nullptr;
+		}
+
+		const ClimbToken& token = state.mToken;
+		if (token.mType != ClimbToken::Type::Parenthesis || !static_cast<const Parenthesis*>(token.mSymbol)->mIsOpen)
+		{
+			// arguments are only taken from a parenthesized list
+			context.Fail(pos, ResultType::InvalidExpression);
+			return nullptr;
+		}
+
+		const Parenthesis* open = static_cast<const Parenthesis*>(token.mSymbol);
+		const size_t openPos = token.mPos;
+		ConsumeClimbToken(state, context);
+
+		const size_t enclosingGroupPos = state.mGroupPos;
+		state.mGroupPos = openPos;
+		++context.mParenthesisDepth;
+
+		std::vector<ASTNode*> arguments;
+		uint32_t depth = 0;
+		auto release = [&]()
+			{
+				for (ASTNode* argument : arguments)
+				{
+					context.ReleaseNode(argument);
+				}
+				return nullptr;
+			};
+
+		while (true)
+		{
+			ASTNode* argument = ParseClimbingExpression(state, context, 0);
+			if (!argument)
+			{
+				return release();
+			}
+			arguments.push_back(argument);
+			depth = std::max(depth, context.mNodeDepth);
+
+			if (!PeekClimbToken(state, context))
+			{
+				return release();
+			}
+			if (state.mToken.mType != ClimbToken::Type::Separator)
+			{
+				break;
+			}
+			ConsumeClimbToken(state, context);
+		}
+
+		if (!ParseClosingParenthesis(state, context, open, openPos))
+		{
+			return release();
+		}
+		state.mGroupPos = enclosingGroupPos;
+		--context.mParenthesisDepth;
+
+		if (function->mType == OperatorType::FunctionDual && arguments.size() != 2)
+		{
+			context.Fail(pos, ResultType::InvalidExpression);
+			return release();
+		}
+		ASTNode* node = NewOperatorNode(context, function, arguments.data(), arguments.size(), pos);
+		if (!node)
+		{
+			return nullptr;
+		}
+		context.RecordSpan(node, { pos, state.mOffset });
+		context.mNodeDepth = depth + 1;
+		if (!CheckLimits(context, context.mNodeDepth, pos))
+		{
+			context.ReleaseNode(node);
+			return nullptr;
+		}
+		return node;
+	}
+
+	ASTNode* ASTParser::ParseClimbing(std::string_view expression, ParseContext& context)
+	{
+		GetLexer();
+		if (!PreValidate(expression, context))
+		{
+			return nullptr;
+		}
+
+		ClimbState state;
+		state.mExpression = expression;
+
+		ASTNode* root = ParseClimbingExpression(state, context, 0);
+		if (!root)
+		{
+			return nullptr;
+		}
+		if (!PeekClimbToken(state, context))
+		{
+			context.ReleaseNode(root);
+			return nullptr;
+		}
+
+		const ClimbToken& token = state.mToken;
+		if (token.mType == ClimbToken::Type::End)
+		{
+			return root;
+		}
+
+		context.ReleaseNode(root);
+		if (token.mType == ClimbToken::Type::Parenthesis)
+		{
+			context.Fail(token.mPos, ResultType::InvalidParenthesis);
+		}
+		else if (token.mType == ClimbToken::Type::Separator)
+		{
+			context.Fail(token.mPos, ResultType::InvalidExpression);
+		}
+		else
+		{
+			// dangling operands, only possible without implicit operator insertion
+			context.Fail(expression.size(), ResultType::InvalidExpression);
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,142 @@
+#include "ASTParser.h"
+#include <algorithm>
+
+namespace AST
+{
+	static bool IsBlank(std::string_view text)
+	{
+		return text.find_first_not_of(' ') == std::string_view::npos;
+	}
+
+	bool ASTParser::ParseBindingName(std::string_view name, InternedSymbol& outVariable)
+	{
+		size_t begin = name.find_first_not_of(' ');
+		if (begin == std::string_view::npos)
+		{
+			return false;
+		}
+		name = name.substr(begin, name.find_last_not_of(' ') + 1 - begin);
+
+		// anything ParseTokens reads before variables would shadow the binding
+		const ASTLexer::Match match = GetLexer().Scan(name, 0);
+		if (!ResolveSymbol(match, TokenCategory::Parenthesis).HasError() ||
+			!ResolveSymbol(match, TokenCategory::Irrational).HasError() ||
+			!ResolveOperator(match, ASTNode::NodeType::Variable).HasError() ||
+			!ExtractRational(name).HasError())
+		{
+			return false;
+		}
+
+		outVariable = mLexer->GetVariable(match);
+		if (outVariable.mSymbol)
+		{
+			return match.GetLength(TokenCategory::CustomSymbol) == name.size();
+		}
+		if (name.size() != 1)
+		{
+			return false;
+		}
+		outVariable = GetUnknownVariable(name[0]);
+		return true;
+	}
+
+	ASTParser::ParsedProgram ASTParser::ParseProgram(std::string_view program, const size_t blockSize)
+	{
+		ParsedProgram parsed;
+		auto fail = [&parsed](const size_t pos, const ResultType type)
+			{
+				parsed.mErrorPos = pos;
+				parsed.mErrorType = type;
+			};
+
+		if (mSettings.mMaxInputLength && program.size() > mSettings.mMaxInputLength)
+		{
+			fail(mSettings.mMaxInputLength, ResultType::ResourceLimitExceeded);
+			return parsed;
+		}
+
+		std::unique_ptr<ASTNodeArena> arena = std::make_unique<ASTNodeArena>(blockSize);
+		std::vector<std::pair<uint32_t, ASTNode*>> bindings;
+		std::unordered_map<const ASTNode*, uint32_t> bindingDepths;
+		ASTNode* root = nullptr;
+		size_t rootEnd = 0;
+
+		for (size_t begin = 0; begin <= program.size();)
+		{
+			size_t end = std::min(program.find(';', begin), program.size());
+			std::string_view statement = program.substr(begin, end - begin);
+			if (IsBlank(statement))
+			{
+				begin = end + 1;
+				continue;
+			}
+			if (root)
+			{
+				// only the last statement may be a plain expression
+				fail(rootEnd, ResultType::InvalidExpression);
+				return parsed;
+			}
+
+			size_t expressionBegin = begin;
+			InternedSymbol name;
+			size_t assignment = statement.find('=');
+			if (assignment != std::string_view::npos)
+			{
+				if (!ParseBindingName(statement.substr(0, assignment), name))
+				{
+					fail(begin + statement.find_first_not_of(' '), ResultType::InvalidExpression);
+					return parsed;
+				}
+				expressionBegin = begin + assignment + 1;
+			}
+
+			// the limits apply to the whole program, bound subtrees keep their depth where they are used
+			ParseContext context;
+			context.mArena = arena.get();
+			context.mBindings = &bindings;
+			context.mBindingDepths = &bindingDepths;
+			context.mNodeCount = arena->GetNodeCount();
+			ASTNode* node = ParseInternal(program.substr(expressionBegin, end - expressionBegin), context);
+			if (!node)
+			{
+				fail(expressionBegin + context.mErrorPos, context.mErrorType);
+				return parsed;
+			}
+
+			if (assignment != std::string_view::npos)
+			{
+				// a name bound again refers to the new subtree from here on
+				auto it = std::find_if(bindings.begin(), bindings.end(), [&name](const std::pair<uint32_t, ASTNode*>& binding)
+					{
+						return binding.first == name.mId;
+					});
+				if (it != bindings.end())
+				{
+					it->second = node;
+				}
+				else
+				{
+					bindings.emplace_back(name.mId, node);
+				}
+				if (mSettings.mMaxDepth)
+				{
+					bindingDepths[node] = context.mNodeDepth;
+				}
+			}
+			else
+			{
+				root = node;
+				rootEnd = end;
+			}
+			begin = end + 1;
+		}
+
+		if (!root)
+		{
+			fail(program.size(), ResultType::EmptyExpression);
+			return parsed;
+		}
+		parsed.mTree = ASTArenaTree(std::move(arena), root);
+		return parsed;
+	}
+}
@@ -0,0 +1,116 @@
+#include "ASTPostfix.h"
+#include "ASTNode.h"
+
+namespace AST
+{
+	void ASTPostfix::PushRational(const Rational& value)
+	{
+		mInstructions.push_back({ PostfixOpcode::Rational, 0, static_cast<uint32_t>(mLiterals.size()) });
+		mLiterals.push_back(value);
+	}
+
+	uint32_t ASTPostfix::AddSymbol(const Symbol* symbol)
+	{
+		auto it = mSymbolIndices.find(symbol);
+		if (it != mSymbolIndices.end())
+		{
+			return it->second;
+		}
+		uint32_t index = static_cast<uint32_t>(mSymbols.size());
+		mSymbols.push_back(symbol);
+		mSymbolIndices.emplace(symbol, index);
+		return index;
+	}
+
+	void ASTPostfix::PushIrrational(const Symbol* irrational)
+	{
+		mInstructions.push_back({ PostfixOpcode::Irrational, AddSymbol(irrational), 0 });
+	}
+
+	void ASTPostfix::PushVariable(const InternedSymbol& variable)
+	{
+		mInstructions.push_back({ PostfixOpcode::Variable, variable.mId, 0 });
+	}
+
+	void ASTPostfix::PushOperator(const Operator* op)
+	{
+		mInstructions.push_back({ PostfixOpcode::Operator, AddSymbol(op), 0 });
+	}
+
+	void ASTPostfix::Clear()
+	{
+		mInstructions.clear();
+		mLiterals.clear();
+		mSymbols.clear();
+		mSymbolIndices.clear();
+	}
+
+	bool ASTPostfix::operator==(const ASTPostfix& other) const
+	{
+		return mInstructions == other.mInstructions && mLiterals == other.mLiterals && mSymbols == other.mSymbols;
+	}
+
+	size_t ASTPostfix::GetOperandCount(const OperatorType type)
+	{
+		switch (type)
+		{
+		case OperatorType::Unary:
+		case OperatorType::FunctionSingular:
+			return 1;
+		case OperatorType::Binary:
+		case OperatorType::FunctionDual:
+			return 2;
+		default:
+			return 0;
+		}
+	}
+
+	ASTNode* ASTPostfix::ToTree() const
+	{
+		std::vector<ASTNode*> stack;
+		auto release = [&stack]()
+			{
+				for (ASTNode* node : stack)
+				{
+					delete node;
+				}
+				return nullptr;
+			};
+
+		for (const PostfixInstruction& instruction : mInstructions)
+		{
+			switch (instruction.mOpcode)
+			{
+			case PostfixOpcode::Rational:
+				stack.push_back(new RationalNode(mLiterals[instruction.mLiteralIndex]));
+				break;
+			case PostfixOpcode::Irrational:
+				stack.push_back(new IrrationalNode(mSymbols[instruction.mSymbolId]));
+				break;
+			case PostfixOpcode::Variable:
+				stack.push_back(new VariableNode(InternedSymbol{ SymbolInterner::GetDefault().GetSymbol(instruction.mSymbolId), instruction.mSymbolId }));
+				break;
+			case PostfixOpcode::Operator:
+			{
+				const Operator* op = static_cast<const Operator*>(mSymbols[instruction.mSymbolId]);
+				size_t operandCount = GetOperandCount(op->mType);
+				if (operandCount == 0 || stack.size() < operandCount)
+				{
+					return release();
+				}
+
+				std::vector<ASTNode*> operands(stack.end() - operandCount, stack.end());
+				stack.resize(stack.size() - operandCount);
+				stack.push_back(new OperatorNode(op, operands));
+				break;
+			}
+			}
+		}
+
+		if (stack.size() != 1)
+		{
+			return release();
+		}
+		return stack.back();
+	}
+}
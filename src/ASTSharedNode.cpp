@@ -0,0 +1,141 @@
+#include "ASTSharedNode.h"
+
+namespace AST
+{
+	static void MakeShared(ASTNode* node)
+	{
+		if (node->mOwnership != ASTNode::NodeOwnership::Heap)
+		{
+			return;
+		}
+		node->mOwnership = ASTNode::NodeOwnership::Shared;
+		node->AddReference();
+		if (OperatorNode* opNode = NodeCast<OperatorNode>(node))
+		{
+			for (ASTNode* operand : opNode->mOperands)
+			{
+				MakeShared(operand);
+			}
+		}
+	}
+
+	ASTSharedNode ASTSharedNode::Adopt(ASTNode* tree)
+	{
+		if (!tree)
+		{
+			return {};
+		}
+		MakeShared(tree);
+		return ASTSharedNode(tree);
+	}
+
+	ASTSharedNode ASTSharedNode::Share(const ASTNode* node)
+	{
+		return ASTSharedNode(node->AddReference());
+	}
+
+	const ASTNode* ASTSharedNode::Detach()
+	{
+		const ASTNode* node = mNode;
+		mNode = nullptr;
+		return node;
+	}
+
+	void ASTSharedNode::Reset()
+	{
+		if (mNode)
+		{
+			mNode->RemoveReference();
+			mNode = nullptr;
+		}
+	}
+
+	// a new shared operator like source, taking the references of operands
+	static ASTSharedNode CopyWithOperands(const OperatorNode* source, std::vector<ASTSharedNode>& operands)
+	{
+		std::vector<ASTNode*> nodes;
+		nodes.reserve(operands.size());
+		for (ASTSharedNode& operand : operands)
+		{
+			nodes.push_back(const_cast<ASTNode*>(operand.Detach()));
+		}
+		OperatorNode* copy = new OperatorNode(source->mOperator, nodes);
+		copy->mNodeId = source->mNodeId;
+		return ASTSharedNode::Adopt(copy);
+	}
+
+	static std::vector<ASTSharedNode> ShareOperands(const OperatorNode* opNode)
+	{
+		std::vector<ASTSharedNode> operands;
+		operands.reserve(opNode->mOperands.size());
+		for (const ASTNode* operand : opNode->mOperands)
+		{
+			operands.push_back(ASTSharedNode::Share(operand));
+		}
+		return operands;
+	}
+
+	ASTSharedNode ReplaceSubtree(const ASTSharedNode& root, const std::vector<size_t>& operandPath, const ASTSharedNode& replacement)
+	{
+		if (!replacement)
+		{
+			return {};
+		}
+
+		// the nodes on the path, root first
+		std::vector<const OperatorNode*> path;
+		path.reserve(operandPath.size());
+		const ASTNode* node = root.Get();
+		for (const size_t index : operandPath)
+		{
+			const OperatorNode* opNode = NodeCast<OperatorNode>(node);
+			if (!opNode || index >= opNode->mOperands.size())
+			{
+				return {};
+			}
+			path.push_back(opNode);
+			node = opNode->mOperands[index];
+		}
+		if (!node)
+		{
+			return {};
+		}
+
+		ASTSharedNode result = replacement;
+		for (size_t i = path.size(); i > 0; --i)
+		{
+			std::vector<ASTSharedNode> operands = ShareOperands(path[i - 1]);
+			operands[operandPath[i - 1]] = std::move(result);
+			result = CopyWithOperands(path[i - 1], operands);
+		}
+		return result;
+	}
+
+	ASTSharedNode SubstituteVariable(const ASTSharedNode& root, const uint32_t variableId, const ASTSharedNode& replacement)
+	{
+		if (!root)
+		{
+			return {};
+		}
+		if (const VariableNode* variableNode = NodeCast<VariableNode>(root.Get()))
+		{
+			return variableNode->mId == variableId ? replacement : root;
+		}
+
+		const OperatorNode* opNode = NodeCast<OperatorNode>(root.Get());
+		if (!opNode)
+		{
+			return root;
+		}
+
+		std::vector<ASTSharedNode> operands = ShareOperands(opNode);
+		bool changed = false;
+		for (ASTSharedNode& operand : operands)
+		{
+			ASTSharedNode substituted = SubstituteVariable(operand, variableId, replacement);
+			changed |= substituted.Get() != operand.Get();
+			operand = std::move(substituted);
+		}
+		return changed ? CopyWithOperands(opNode, operands) : root;
+	}
+}
@@ -1,13 +1,68 @@
 #include "ASTSimplifier.h"
 #include "ASTSimplifierSimplifyRules.h"
 #include "ASTNode.h"
+#include "ASTNodeArena.h"
+#include "ASTSourceSpans.h"
+#include "ASTBuffer.h"
+#include "ASTSharedNode.h"
+#include <algorithm>
 
 namespace AST
 {
-	void OrderedSimplifyRuleList::AddRule(ISimplifyRule* rule)
+	namespace
+	{
+		// steps of the rule application running on this thread, the operations a rule simplifies count against them
+		thread_local size_t* activeSteps = nullptr;
+
+		// nodes the running rule moved into its result, null when it copies them
+		thread_local std::vector<ASTNode*>* keptNodes = nullptr;
+
+		// frees a subtree the rule result replaced, but the nodes moved into the result
+		void DiscardExcept(ASTNode* node, const std::vector<ASTNode*>& kept)
+		{
+			// a kept node may be freed already, so it is only compared
+			if (std::find(kept.begin(), kept.end(), node) != kept.end())
+			{
+				return;
+			}
+			// like the destructor of OperatorNode
+			if (node->mOwnership == ASTNode::NodeOwnership::Shared)
+			{
+				node->RemoveReference();
+				return;
+			}
+			if (node->mOwnership != ASTNode::NodeOwnership::Heap)
+			{
+				return;
+			}
+			OperatorNode* opNode = NodeCast<OperatorNode>(node);
+			if (opNode && !kept.empty())
+			{
+				for (ASTNode* operand : opNode->mOperands)
+				{
+					DiscardExcept(operand, kept);
+				}
+				opNode->mOperands.clear();
+			}
+			delete node;
+		}
+	}
+
+	ASTNode* ISimplifyRule::Keep(ASTNode* node)
+	{
+		// a node kept twice is moved once
+		if (keptNodes && std::find(keptNodes->begin(), keptNodes->end(), node) == keptNodes->end())
+		{
+			keptNodes->push_back(node);
+			return node;
+		}
+		return node->Clone();
+	}
+
+	void OrderedSimplifyRuleList::AddRule(std::unique_ptr<ISimplifyRule> rule)
 	{
 		auto it = std::lower_bound(mRules.begin(), mRules.end(), rule,
-			[](const ISimplifyRule* a, const ISimplifyRule* b) {
+			[](const std::unique_ptr<ISimplifyRule>& a, const std::unique_ptr<ISimplifyRule>& b) {
 				// First, compare by priority
 				if (a->mPriority != b->mPriority) {
 					return a->mPriority < b->mPriority; // Lower priority comes first
@@ -15,7 +70,7 @@ namespace AST
 				// If priorities are equal, compare by memory address to preserve insertion order
 				return a < b;
 			});
-		mRules.insert(it, rule);
+		mRules.insert(it, std::move(rule));
 	}
 
 	RationalNode* OperationSimplifyRule::NewRationalNode(const Rational& value) const
@@ -30,63 +85,504 @@ namespace AST
 
 	void ASTSimplifier::BindSimplifyRule(const OperationId operation, const OperationSimplifyRule* rule)
 	{
-		mSimplifyRules[operation] = rule;
+		mSimplifyRules[static_cast<uint8_t>(operation)] = rule;
 	}
 
 	ASTNode* ASTSimplifier::Simplify(ASTNode* node) const
 	{
-		if (node->mType == ASTNode::NodeType::Operator)
+		SimplifyState state;
+		return SimplifyNode(node, state);
+	}
+
+	ASTNode* ASTSimplifier::Simplify(ASTNode* node, ASTSourceSpans& spans) const
+	{
+		SimplifyState state;
+		state.mSpans = &spans;
+		return SimplifyNode(node, state);
+	}
+
+	ASTNode* ASTSimplifier::SimplifyNode(ASTNode* node, SimplifyState& state) const
+	{
+		if (mSettings.mMaxDepth && state.mDepth > mSettings.mMaxDepth)
+		{
+			return nullptr;
+		}
+
+		if (OperatorNode* opNode = NodeCast<OperatorNode>(node))
 		{
-			OperatorNode* opNode = dynamic_cast<OperatorNode*>(node);
 			std::vector<ASTNode*> newOperands;
+			std::vector<ASTNode*> kept;
+			auto release = [&newOperands, &kept]()
+				{
+					for (ASTNode* operand : newOperands)
+					{
+						DiscardExcept(operand, kept);
+					}
+					return nullptr;
+				};
+
+			++state.mDepth;
 			for (ASTNode* operand : opNode->mOperands)
 			{
-				newOperands.push_back(Simplify(operand));
+				ASTNode* newOperand = SimplifyNode(operand, state);
+				if (!newOperand)
+				{
+					return release();
+				}
+				newOperands.push_back(newOperand);
 			}
-			auto ruleIt = mSimplifyRules.find(opNode->mOperator->mOperationId);
-			if (ruleIt != mSimplifyRules.end())
+			--state.mDepth;
+
+			const OperationSimplifyRule* rule = mSimplifyRules[static_cast<uint8_t>(opNode->mOperator->mOperationId)];
+			if (rule)
 			{
-				SimplifyResult result = ruleIt->second->Simplify(newOperands);
+				// the new operands are fresh, so the rule moves what it keeps of them
+				SimplifyResult result;
+				if (!ApplyRule(rule, newOperands, state.mSteps, result, &kept))
+				{
+					return release();
+				}
 				if (result.mSuccess)
 				{
+					if (state.mSpans)
+					{
+						state.mSpans->Propagate(node, result.mResult);
+					}
+					release();
 					return result.mResult;
 				}
-				else
+			}
+
+			// the new operands are fresh already, they move into the copy
+			OperatorNode* copy = new OperatorNode(opNode->mOperator, newOperands);
+			copy->mNodeId = opNode->mNodeId;
+			return copy;
+		}
+		else
+		{
+			return node->Clone();
+		}
+
+		return nullptr; // temp
+	}
+
+	std::unique_ptr<ASTNode> ASTSimplifier::Simplify(std::unique_ptr<ASTNode> node) const
+	{
+		if (!node)
+		{
+			return nullptr;
+		}
+		SimplifyState state;
+		bool modified = false;
+		return std::unique_ptr<ASTNode>(SimplifyInPlace(node.release(), state, modified));
+	}
+
+	ASTNode* ASTSimplifier::SimplifyInPlace(ASTNode* node, SimplifyState& state, bool& outModified) const
+	{
+		outModified = false;
+		if (mSettings.mMaxDepth && state.mDepth > mSettings.mMaxDepth)
+		{
+			delete node;
+			return nullptr;
+		}
+
+		if (node->mOwnership == ASTNode::NodeOwnership::Shared)
+		{
+			// shared nodes are immutable, a copy replaces our reference
+			ASTNode* copy = SimplifyNode(node, state);
+			node->RemoveReference();
+			outModified = true;
+			return copy;
+		}
+
+		OperatorNode* opNode = NodeCast<OperatorNode>(node);
+		if (!opNode)
+		{
+			return node;
+		}
+
+		// an operand rewritten in place keeps its pointer, so its flag decides and not the pointer
+		bool changed = false;
+		++state.mDepth;
+		for (size_t i = 0; i < opNode->mOperands.size(); ++i)
+		{
+			bool operandModified = false;
+			ASTNode* newOperand = SimplifyInPlace(opNode->mOperands[i], state, operandModified);
+			if (!newOperand)
+			{
+				// the operand is freed already
+				opNode->mOperands.erase(opNode->mOperands.begin() + i);
+				delete opNode;
+				return nullptr;
+			}
+			changed |= operandModified;
+			opNode->mOperands[i] = newOperand;
+		}
+		--state.mDepth;
+
+		if (changed)
+		{
+			opNode->InvalidateHash();
+			outModified = true;
+		}
+
+		const OperationSimplifyRule* rule = mSimplifyRules[static_cast<uint8_t>(opNode->mOperator->mOperationId)];
+		if (!rule)
+		{
+			return opNode;
+		}
+		// what the rule keeps is moved out of the replaced subtree, the rest of it is freed
+		std::vector<ASTNode*> kept;
+		SimplifyResult result;
+		if (!ApplyRule(rule, std::vector<ASTNode*>(opNode->mOperands.begin(), opNode->mOperands.end()), state.mSteps, result, &kept))
+		{
+			DiscardExcept(opNode, kept);
+			return nullptr;
+		}
+		if (!result.mSuccess)
+		{
+			return opNode;
+		}
+		if (state.mSpans)
+		{
+			state.mSpans->Propagate(opNode, result.mResult);
+		}
+		DiscardExcept(opNode, kept);
+		outModified = true;
+		return result.mResult;
+	}
+
+	ASTSharedNode ASTSimplifier::Simplify(const ASTSharedNode& tree) const
+	{
+		if (!tree)
+		{
+			return {};
+		}
+		SimplifyState state;
+		return SimplifySharedNode(tree, state);
+	}
+
+	ASTSharedNode ASTSimplifier::SimplifySharedNode(const ASTSharedNode& node, SimplifyState& state) const
+	{
+		if (mSettings.mMaxDepth && state.mDepth > mSettings.mMaxDepth)
+		{
+			return {};
+		}
+
+		const OperatorNode* opNode = NodeCast<OperatorNode>(node.Get());
+		if (!opNode)
+		{
+			return node;
+		}
+
+		std::vector<ASTSharedNode> newOperands;
+		newOperands.reserve(opNode->mOperands.size());
+		bool changed = false;
+		++state.mDepth;
+		for (const ASTNode* operand : opNode->mOperands)
+		{
+			newOperands.push_back(SimplifySharedNode(ASTSharedNode::Share(operand), state));
+			if (!newOperands.back())
+			{
+				return {};
+			}
+			changed |= newOperands.back().Get() != operand;
+		}
+		--state.mDepth;
+
+		std::vector<ASTNode*> operands;
+		operands.reserve(newOperands.size());
+		for (const ASTSharedNode& operand : newOperands)
+		{
+			operands.push_back(const_cast<ASTNode*>(operand.Get()));
+		}
+
+		const OperationSimplifyRule* rule = mSimplifyRules[static_cast<uint8_t>(opNode->mOperator->mOperationId)];
+		if (rule)
+		{
+			// the result clones or shares what it keeps of the operands
+			SimplifyResult result;
+			if (!ApplyRule(rule, operands, state.mSteps, result))
+			{
+				return {};
+			}
+			if (result.mSuccess)
+			{
+				return ASTSharedNode::Adopt(result.mResult);
+			}
+		}
+		if (!changed)
+		{
+			return node;
+		}
+
+		// the new parent takes references of its own, newOperands releases ours
+		for (ASTNode*& operand : operands)
+		{
+			operand = operand->AddReference();
+		}
+		OperatorNode* copy = new OperatorNode(opNode->mOperator, operands);
+		copy->mNodeId = opNode->mNodeId;
+		return ASTSharedNode::Adopt(copy);
+	}
+
+	ASTNode* ASTSimplifier::Simplify(const ASTArenaTree& tree) const
+	{
+		if (!tree)
+		{
+			return nullptr;
+		}
+		return Simplify(tree.GetRoot());
+	}
+
+	// copies a heap tree into the arena, node ids included
+	static ASTNode* CopyToArena(const ASTNode* node, ASTNodeArena& arena)
+	{
+		ASTNode* copy = nullptr;
+		switch (node->mType)
+		{
+		case ASTNode::NodeType::Rational:
+			copy = arena.New<RationalNode>(static_cast<const RationalNode*>(node)->mValue);
+			break;
+		case ASTNode::NodeType::Irrational:
+			copy = arena.New<IrrationalNode>(static_cast<const IrrationalNode*>(node)->mIrrational);
+			break;
+		case ASTNode::NodeType::Variable:
+		{
+			const VariableNode* variableNode = static_cast<const VariableNode*>(node);
+			copy = arena.New<VariableNode>(InternedSymbol{ variableNode->mVariable, variableNode->mId });
+			break;
+		}
+		case ASTNode::NodeType::Parenthesis:
+			copy = arena.New<ParenthesisNode>(static_cast<const ParenthesisNode*>(node)->mParenthesis);
+			break;
+		case ASTNode::NodeType::Operator:
+		{
+			// the operand list is filled in place, in the arena
+			const OperatorNode* opNode = static_cast<const OperatorNode*>(node);
+			OperatorNode* opCopy = arena.New<OperatorNode>(opNode->mOperator, nullptr, 0);
+			opCopy->mOperands.reserve(opNode->mOperands.size());
+			for (const ASTNode* operand : opNode->mOperands)
+			{
+				opCopy->mOperands.push_back(CopyToArena(operand, arena));
+			}
+			copy = opCopy;
+			break;
+		}
+		default:
+			return nullptr;
+		}
+		copy->mNodeId = node->mNodeId;
+		return copy;
+	}
+
+	ASTArenaTree ASTSimplifier::SimplifyShared(const ASTArenaTree& tree) const
+	{
+		if (!tree)
+		{
+			return {};
+		}
+
+		std::unique_ptr<ASTNodeArena> arena = std::make_unique<ASTNodeArena>();
+		std::unordered_map<const ASTNode*, ASTNode*> simplified;
+		SimplifyState state;
+		ASTNode* root = SimplifyShared(tree.GetRoot(), *arena, simplified, state);
+		if (!root)
+		{
+			return {};
+		}
+		return ASTArenaTree(std::move(arena), root);
+	}
+
+	ASTNode* ASTSimplifier::SimplifyShared(const ASTNode* node, ASTNodeArena& arena, std::unordered_map<const ASTNode*, ASTNode*>& simplified, SimplifyState& state) const
+	{
+		auto it = simplified.find(node);
+		if (it != simplified.end())
+		{
+			return it->second;
+		}
+		if (mSettings.mMaxDepth && state.mDepth > mSettings.mMaxDepth)
+		{
+			return nullptr;
+		}
+
+		ASTNode* result = nullptr;
+		if (node->mType == ASTNode::NodeType::Operator)
+		{
+			const OperatorNode* opNode = static_cast<const OperatorNode*>(node);
+			std::vector<ASTNode*> operands;
+			operands.reserve(opNode->mOperands.size());
+			++state.mDepth;
+			for (const ASTNode* operand : opNode->mOperands)
+			{
+				ASTNode* newOperand = SimplifyShared(operand, arena, simplified, state);
+				if (!newOperand)
 				{
-					return opNode->CloneWithNewOperands(newOperands);
+					return nullptr;
 				}
+				operands.push_back(newOperand);
+			}
+			--state.mDepth;
+
+			// rules answer with heap trees, which are moved into the arena
+			SimplifyResult simplifyResult;
+			if (!SimplifyOperation(opNode->mOperator->mOperationId, operands, state.mSteps, simplifyResult))
+			{
+				return nullptr;
+			}
+			if (simplifyResult.mSuccess)
+			{
+				result = CopyToArena(simplifyResult.mResult, arena);
+				delete simplifyResult.mResult;
 			}
 			else
 			{
-				return opNode->CloneWithNewOperands(newOperands);
+				result = arena.New<OperatorNode>(opNode->mOperator, operands);
 			}
 		}
 		else
 		{
-			return node->Clone();
+			result = CopyToArena(node, arena);
 		}
 
-		return nullptr; // temp
+		simplified.emplace(node, result);
+		return result;
+	}
+
+	ASTBuffer ASTSimplifier::Simplify(const ASTBuffer& buffer) const
+	{
+		if (buffer.IsEmpty())
+		{
+			return {};
+		}
+
+		// operands come first, so each operator finds them simplified already
+		ASTBuffer simplifiedBuffer;
+		simplifiedBuffer.Reserve(buffer.GetSize());
+		std::vector<ASTBuffer::NodeIndex> simplified(buffer.GetSize());
+		std::vector<size_t> heights(buffer.GetSize(), 1);
+		std::vector<ASTBuffer::NodeIndex> operands;
+		std::vector<ASTNode*> operandNodes;
+		SimplifyState state;
+
+		for (ASTBuffer::NodeIndex index = 0; index < buffer.GetSize(); ++index)
+		{
+			if (buffer.GetType(index) != ASTNode::NodeType::Operator)
+			{
+				simplified[index] = simplifiedBuffer.AddSubtree(buffer, index);
+				continue;
+			}
+
+			operands.clear();
+			for (size_t i = 0; i < buffer.GetOperandCount(index); ++i)
+			{
+				ASTBuffer::NodeIndex operand = buffer.GetOperand(index, i);
+				operands.push_back(simplified[operand]);
+				heights[index] = std::max(heights[index], heights[operand] + 1);
+			}
+			if (mSettings.mMaxDepth && heights[index] > mSettings.mMaxDepth)
+			{
+				return {};
+			}
+
+			const Operator* op = buffer.GetOperator(index);
+			const OperationSimplifyRule* rule = mSimplifyRules[static_cast<uint8_t>(op->mOperationId)];
+			if (rule)
+			{
+				operandNodes.clear();
+				for (ASTBuffer::NodeIndex operand : operands)
+				{
+					operandNodes.push_back(simplifiedBuffer.ToTree(operand));
+				}
+				// the operand trees are temporary, the rule moves what it keeps of them
+				std::vector<ASTNode*> kept;
+				SimplifyResult result;
+				const bool withinLimit = ApplyRule(rule, operandNodes, state.mSteps, result, &kept);
+				for (ASTNode* operandNode : operandNodes)
+				{
+					DiscardExcept(operandNode, kept);
+				}
+				if (!withinLimit)
+				{
+					return {};
+				}
+				if (result.mSuccess)
+				{
+					simplified[index] = simplifiedBuffer.AddTree(result.mResult);
+					delete result.mResult;
+					continue;
+				}
+			}
+			simplified[index] = simplifiedBuffer.AddOperator(op, operands);
+		}
+
+		// drop the operands that rules replaced
+		ASTBuffer compacted;
+		compacted.Reserve(simplifiedBuffer.GetSize());
+		compacted.AddSubtree(simplifiedBuffer, simplifiedBuffer.GetRoot());
+		return compacted;
+	}
+
+	bool ASTSimplifier::ApplyRule(const OperationSimplifyRule* rule, const std::vector<ASTNode*>& operands, size_t& steps, SimplifyResult& outResult,
+		std::vector<ASTNode*>* outKept) const
+	{
+		outResult = {};
+		if (mSettings.mMaxSteps && ++steps > mSettings.mMaxSteps)
+		{
+			return false;
+		}
+
+		size_t* enclosingSteps = activeSteps;
+		std::vector<ASTNode*>* enclosingKept = keptNodes;
+		activeSteps = &steps;
+		keptNodes = outKept;
+		outResult = rule->Simplify(operands);
+		activeSteps = enclosingSteps;
+		keptNodes = enclosingKept;
+
+		// a nested operation ran out of steps, the rule built its result without it
+		if (mSettings.mMaxSteps && steps > mSettings.mMaxSteps)
+		{
+			delete outResult.mResult;
+			outResult = {};
+			return false;
+		}
+		return true;
 	}
 
 	SimplifyResult ASTSimplifier::SimplifyOperation(const OperationId operation, const std::vector<ASTNode*>& operands) const
 	{
-		auto ruleIt = mSimplifyRules.find(operation);
-		if (ruleIt != mSimplifyRules.end())
+		size_t steps = 0;
+		SimplifyResult result;
+		SimplifyOperation(operation, operands, activeSteps ? *activeSteps : steps, result);
+		return result;
+	}
+
+	bool ASTSimplifier::SimplifyOperation(const OperationId operation, const std::vector<ASTNode*>& operands, size_t& steps, SimplifyResult& outResult) const
+	{
+		outResult = {};
+		const OperationSimplifyRule* rule = mSimplifyRules[static_cast<uint8_t>(operation)];
+		if (!rule)
 		{
-			return ruleIt->second->Simplify(operands);
+			return true;
 		}
-		return { false, nullptr };
+		return ApplyRule(rule, operands, steps, outResult);
+	}
+
+	ASTSimplifier::ASTSimplifier(const ASTSimplifierSettings& settings)
+		: mSettings(settings)
+	{
+		mDefaultRules.push_back(std::make_unique<AdditionSimplifyRule>(this));
+		BindSimplifyRule(OperationId::Addition, mDefaultRules.back().get());
+		mDefaultRules.push_back(std::make_unique<SubtractionSimplifyRule>(this));
+		BindSimplifyRule(OperationId::Subtraction, mDefaultRules.back().get());
+		mDefaultRules.push_back(std::make_unique<MultiplicationSimplifyRule>(this));
+		BindSimplifyRule(OperationId::Multiplication, mDefaultRules.back().get());
 	}
 
 	const ASTSimplifier& ASTSimplifier::GetDefault()
 	{
 		static ASTSimplifier instance;
-
-		instance.BindSimplifyRule(OperationId::Addition, new AdditionSimplifyRule(&instance));
-		instance.BindSimplifyRule(OperationId::Subtraction, new SubtractionSimplifyRule(&instance));
-		instance.BindSimplifyRule(OperationId::Multiplication, new MultiplicationSimplifyRule(&instance));
-
 		return instance;
 	}
 
@@ -97,7 +593,7 @@ namespace AST
 
 	SimplifyResult OperationSimplifyRule::Simplify(const std::vector<ASTNode*> operands) const
 	{
-		for (auto rule : mRules)
+		for (const auto& rule : mRules)
 		{
 			std::unique_ptr<SimplifyCheckResult> checkResult = rule->Check(operands);
 			if (checkResult && checkResult->mSuccess)
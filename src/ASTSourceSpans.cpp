@@ -0,0 +1,54 @@
+#include "ASTSourceSpans.h"
+
+namespace AST
+{
+	void ASTSourceSpans::Record(ASTNode* node, const SourceSpan& span)
+	{
+		if (node->mNodeId == 0 || node->mNodeId > mSpans.size())
+		{
+			mSpans.push_back(span);
+			node->mNodeId = static_cast<uint32_t>(mSpans.size());
+			return;
+		}
+		mSpans[node->mNodeId - 1] = span;
+	}
+
+	const SourceSpan* ASTSourceSpans::Find(const ASTNode* node) const
+	{
+		if (node->mNodeId == 0 || node->mNodeId > mSpans.size())
+		{
+			return nullptr;
+		}
+		return &mSpans[node->mNodeId - 1];
+	}
+
+	void ASTSourceSpans::Propagate(const ASTNode* source, ASTNode* result)
+	{
+		if (!Find(source))
+		{
+			return;
+		}
+
+		// the new nodes share the id, they were made from the same tokens
+		const uint32_t id = source->mNodeId;
+		std::vector<ASTNode*> pending = { result };
+		while (!pending.empty())
+		{
+			ASTNode* node = pending.back();
+			pending.pop_back();
+			if (Find(node))
+			{
+				continue;
+			}
+
+			node->mNodeId = id;
+			if (node->mType == ASTNode::NodeType::Operator)
+			{
+				for (ASTNode* operand : static_cast<OperatorNode*>(node)->mOperands)
+				{
+					pending.push_back(operand);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,185 @@
+#include "ASTWorkerPool.h"
+#include <algorithm>
+
+namespace AST
+{
+	ASTWorkerPool::ASTWorkerPool(size_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+		}
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			mRanges.push_back(std::make_unique<WorkerRange>());
+		}
+
+		for (size_t i = 1; i < threadCount; ++i)
+		{
+			mThreads.emplace_back(&ASTWorkerPool::WorkerLoop, this, i);
+		}
+	}
+
+	ASTWorkerPool::~ASTWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mJobMutex);
+			mStopping = true;
+		}
+		mJobStarted.notify_all();
+
+		for (std::thread& thread : mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void ASTWorkerPool::ParallelFor(const size_t count, const RangeTask& task, const size_t grainSize)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> runLock(mRunMutex);
+
+		const size_t workerCount = GetWorkerCount();
+		if (workerCount == 1 || count <= grainSize)
+		{
+			task(0, 0, count);
+			return;
+		}
+
+		for (size_t i = 0; i < workerCount; ++i)
+		{
+			std::lock_guard<std::mutex> rangeLock(mRanges[i]->mMutex);
+			mRanges[i]->mBegin = count * i / workerCount;
+			mRanges[i]->mEnd = count * (i + 1) / workerCount;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mJobMutex);
+			mTask = &task;
+			mGrainSize = std::max<size_t>(1, grainSize);
+			mException = nullptr;
+			mActiveWorkers = mThreads.size();
+			++mGeneration;
+		}
+		mJobStarted.notify_all();
+
+		RunWorker(0);
+
+		std::unique_lock<std::mutex> lock(mJobMutex);
+		mJobFinished.wait(lock, [this]() { return mActiveWorkers == 0; });
+		mTask = nullptr;
+
+		if (mException)
+		{
+			std::exception_ptr exception = mException;
+			mException = nullptr;
+			std::rethrow_exception(exception);
+		}
+	}
+
+	ASTWorkerPool& ASTWorkerPool::GetDefault()
+	{
+		static ASTWorkerPool pool;
+		return pool;
+	}
+
+	void ASTWorkerPool::WorkerLoop(const size_t workerIndex)
+	{
+		uint64_t seenGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mJobMutex);
+				mJobStarted.wait(lock, [&]() { return mStopping || mGeneration != seenGeneration; });
+				if (mStopping)
+				{
+					return;
+				}
+				seenGeneration = mGeneration;
+			}
+
+			RunWorker(workerIndex);
+
+			std::lock_guard<std::mutex> lock(mJobMutex);
+			if (--mActiveWorkers == 0)
+			{
+				mJobFinished.notify_all();
+			}
+		}
+	}
+
+	void ASTWorkerPool::RunWorker(const size_t workerIndex)
+	{
+		size_t begin = 0;
+		size_t end = 0;
+		while (TakeChunk(workerIndex, begin, end) || StealChunk(workerIndex, begin, end))
+		{
+			try
+			{
+				(*mTask)(workerIndex, begin, end);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mJobMutex);
+				if (!mException)
+				{
+					mException = std::current_exception();
+				}
+			}
+		}
+	}
+
+	bool ASTWorkerPool::TakeChunk(const size_t workerIndex, size_t& outBegin, size_t& outEnd)
+	{
+		WorkerRange& range = *mRanges[workerIndex];
+		std::lock_guard<std::mutex> lock(range.mMutex);
+		if (range.mBegin >= range.mEnd)
+		{
+			return false;
+		}
+
+		outBegin = range.mBegin;
+		outEnd = std::min(range.mEnd, range.mBegin + mGrainSize);
+		range.mBegin = outEnd;
+		return true;
+	}
+
+	bool ASTWorkerPool::StealChunk(const size_t workerIndex, size_t& outBegin, size_t& outEnd)
+	{
+		const size_t workerCount = mRanges.size();
+		for (size_t i = 1; i < workerCount; ++i)
+		{
+			WorkerRange& victim = *mRanges[(workerIndex + i) % workerCount];
+
+			size_t stolenBegin = 0;
+			size_t stolenEnd = 0;
+			{
+				std::lock_guard<std::mutex> lock(victim.mMutex);
+				if (victim.mBegin >= victim.mEnd)
+				{
+					continue;
+				}
+				size_t remaining = victim.mEnd - victim.mBegin;
+
+				// small slices are taken whole, larger ones lose their back half
+				stolenEnd = victim.mEnd;
+				stolenBegin = remaining <= mGrainSize ? victim.mBegin : victim.mEnd - remaining / 2;
+				victim.mEnd = stolenBegin;
+			}
+
+			{
+				WorkerRange& own = *mRanges[workerIndex];
+				std::lock_guard<std::mutex> lock(own.mMutex);
+				own.mBegin = stolenBegin;
+				own.mEnd = stolenEnd;
+			}
+			return TakeChunk(workerIndex, outBegin, outEnd);
+		}
+		return false;
+	}
+}
@@ -2,21 +2,35 @@
 
 namespace AST
 {
-	IrrationalRegistry* IrrationalRegistry::GetDefaultRegistry()
+	namespace
 	{
-		static IrrationalRegistry* defaultRegistry = new IrrationalRegistry();
-		static bool initialized = false;
-
-		if (initialized)
+		struct DefaultIrrational
 		{
-			return defaultRegistry;
-		}
+			const char* mSymbol;
+			double mValue;
+			IrrationalId mId;
+		};
+
+		constexpr DefaultIrrational kDefaultIrrationals[] = {
+			{ "pi", 3.14159265358979323846, IrrationalId::Pi },
+			{ "e", 2.71828182845904523536, IrrationalId::E },
+			{ "phi", 1.61803398874989484820, IrrationalId::Phi },
+		};
+	}
+
+	IrrationalRegistry* IrrationalRegistry::GetDefaultRegistry()
+	{
+		// function-local statics are initialized exactly once, even with concurrent callers
+		static IrrationalRegistry* defaultRegistry = []()
+			{
+				IrrationalRegistry* registry = new IrrationalRegistry();
+				for (const DefaultIrrational& irrational : kDefaultIrrationals)
+				{
+					registry->RegisterSymbol(std::make_shared<Irrational>(irrational.mSymbol, irrational.mValue, irrational.mId));
+				}
+				return registry;
+			}();
 
-		initialized = true;
-		// Register symbols
-		defaultRegistry->RegisterSymbol(std::make_shared<Irrational>("pi", 3.14159265358979323846, IrrationalId::Pi));
-		defaultRegistry->RegisterSymbol(std::make_shared<Irrational>("e", 2.71828182845904523536, IrrationalId::E));
-		defaultRegistry->RegisterSymbol(std::make_shared<Irrational>("phi", 1.61803398874989484820, IrrationalId::Phi));
 		return defaultRegistry;
 	}
-} // namespace AST
\ No newline at end of file
+} // namespace AST
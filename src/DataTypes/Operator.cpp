@@ -1,7 +1,6 @@
 #include "DataTypes/Operator.h"
 #include <iostream>
 #include <vector>
-#include <map>
 
 namespace AST
 {
@@ -17,55 +16,94 @@ namespace AST
 	void OperatorRegistry::RegisterOperator(const OperatorType& type, const Associativity& associativity, const uint16_t& precedence, const std::string& symbol, const OperationId& operationId)
 	{
 		std::shared_ptr<Operator> op = std::make_shared<Operator>(type, associativity, precedence, symbol, operationId);
-		mOperatorMap[operationId] = op;
+		mOperators[static_cast<uint8_t>(operationId)] = op;
 		RegisterSymbol(op);
 	}
 
-	OperatorRegistry* OperatorRegistry::GetDefaultRegistry()
+	namespace
 	{
-		static OperatorRegistry* defaultRegistry = new OperatorRegistry();
-		static bool initialized = false;
-
-		if (initialized)
+		struct DefaultOperator
 		{
-			return defaultRegistry;
-		}
+			OperatorType mType;
+			Associativity mAssociativity;
+			uint16_t mPrecedence;
+			const char* mSymbol;
+			OperationId mOperationId;
+		};
+
+		// constant-initialized, the default registry is filled from it without parsing or sorting anything
+		constexpr DefaultOperator kDefaultOperators[] = {
+			{ OperatorType::Binary, Associativity::LeftToRight, 1, "+", OperationId::Addition },
+			{ OperatorType::Unary, Associativity::LeftToRight, 4, "+", OperationId::UnaryPlus },
+			{ OperatorType::Binary, Associativity::LeftToRight, 1, "-", OperationId::Subtraction },
+			{ OperatorType::Unary, Associativity::LeftToRight, 4, "-", OperationId::UnaryMinus },
+			{ OperatorType::Binary, Associativity::LeftToRight, 2, "*", OperationId::Multiplication },
+			{ OperatorType::Binary, Associativity::LeftToRight, 2, "/", OperationId::Division },
+			{ OperatorType::Unary, Associativity::RightToLeft, 5, "!", OperationId::Factorial },
+			{ OperatorType::Binary, Associativity::RightToLeft, 3, "^", OperationId::Exponentiation },
+			{ OperatorType::FunctionDual, Associativity::RightToLeft, 6, "root", OperationId::Root },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sin", OperationId::Sine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "cos", OperationId::Cosine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "tan", OperationId::Tangent },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "asin", OperationId::ArcSine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "acos", OperationId::ArcCosine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "atan", OperationId::ArcTangent },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sinh", OperationId::HyperbolicSine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "cosh", OperationId::HyperbolicCosine },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "tanh", OperationId::HyperbolicTangent },
+			{ OperatorType::FunctionDual, Associativity::RightToLeft, 6, "log", OperationId::Logarithm },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "ln", OperationId::NaturalLogarithm },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sqrt", OperationId::SquareRoot },
+			{ OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "abs", OperationId::AbsoluteValue },
+		};
 
-		initialized = true;
-		// Register operators
-		defaultRegistry->RegisterOperator(OperatorType::Binary, Associativity::LeftToRight, 1, "+", OperationId::Addition);
-		defaultRegistry->RegisterOperator(OperatorType::Unary, Associativity::LeftToRight, 4, "+", OperationId::UnaryPlus);
-		defaultRegistry->RegisterOperator(OperatorType::Binary, Associativity::LeftToRight, 1, "-", OperationId::Subtraction);
-		defaultRegistry->RegisterOperator(OperatorType::Unary, Associativity::LeftToRight, 4, "-", OperationId::UnaryMinus);
-		defaultRegistry->RegisterOperator(OperatorType::Binary, Associativity::LeftToRight, 2, "*", OperationId::Multiplication);
-		defaultRegistry->RegisterOperator(OperatorType::Binary, Associativity::LeftToRight, 2, "/", OperationId::Division);
-		defaultRegistry->RegisterOperator(OperatorType::Unary, Associativity::RightToLeft, 5, "!", OperationId::Factorial);
-		defaultRegistry->RegisterOperator(OperatorType::Binary, Associativity::RightToLeft, 3, "^", OperationId::Exponentiation);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionDual, Associativity::RightToLeft, 6, "root", OperationId::Root);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sin", OperationId::Sine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "cos", OperationId::Cosine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "tan", OperationId::Tangent);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "asin", OperationId::ArcSine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "acos", OperationId::ArcCosine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "atan", OperationId::ArcTangent);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sinh", OperationId::HyperbolicSine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "cosh", OperationId::HyperbolicCosine);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "tanh", OperationId::HyperbolicTangent);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionDual, Associativity::RightToLeft, 6, "log", OperationId::Logarithm);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "ln", OperationId::NaturalLogarithm);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "sqrt", OperationId::SquareRoot);
-		defaultRegistry->RegisterOperator(OperatorType::FunctionSingular, Associativity::RightToLeft, 6, "abs", OperationId::AbsoluteValue);
+		// Only the precedence climbing engine parses their argument lists. In the default registry they would
+		// turn names like "min" or "max", implicit products of variables for the shunting-yard engine, into errors.
+		constexpr DefaultOperator kArgumentListOperators[] = {
+			{ OperatorType::FunctionMultiple, Associativity::RightToLeft, 6, "sum", OperationId::Sum },
+			{ OperatorType::FunctionMultiple, Associativity::RightToLeft, 6, "product", OperationId::Product },
+			{ OperatorType::FunctionMultiple, Associativity::RightToLeft, 6, "min", OperationId::Minimum },
+			{ OperatorType::FunctionMultiple, Associativity::RightToLeft, 6, "max", OperationId::Maximum },
+		};
+	}
+
+	OperatorRegistry* OperatorRegistry::GetDefaultRegistry()
+	{
+		// function-local statics are initialized exactly once, even with concurrent callers
+		static OperatorRegistry* defaultRegistry = []()
+			{
+				OperatorRegistry* registry = new OperatorRegistry();
+				for (const DefaultOperator& op : kDefaultOperators)
+				{
+					registry->RegisterOperator(op.mType, op.mAssociativity, op.mPrecedence, op.mSymbol, op.mOperationId);
+				}
+				return registry;
+			}();
 
 		return defaultRegistry;
 	}
 
-	std::shared_ptr<Operator> OperatorRegistry::GetOperator(const OperationId& operationId) const
+	OperatorRegistry* OperatorRegistry::GetArgumentListRegistry()
 	{
-		auto it = mOperatorMap.find(operationId);
-		if (it == mOperatorMap.end())
-		{
-			return nullptr;
-		}
-		return it->second;
+		static OperatorRegistry* argumentListRegistry = []()
+			{
+				OperatorRegistry* registry = new OperatorRegistry();
+				for (const DefaultOperator& op : kDefaultOperators)
+				{
+					registry->RegisterOperator(op.mType, op.mAssociativity, op.mPrecedence, op.mSymbol, op.mOperationId);
+				}
+				for (const DefaultOperator& op : kArgumentListOperators)
+				{
+					registry->RegisterOperator(op.mType, op.mAssociativity, op.mPrecedence, op.mSymbol, op.mOperationId);
+				}
+				return registry;
+			}();
+
+		return argumentListRegistry;
+	}
+
+	const std::shared_ptr<Operator>& OperatorRegistry::GetOperator(const OperationId& operationId) const
+	{
+		return mOperators[static_cast<uint8_t>(operationId)];
 	}
 }
\ No newline at end of file
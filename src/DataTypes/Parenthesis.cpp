@@ -7,27 +7,36 @@ namespace AST
 		return mOpposite && mOpposite->mSymbol == other->mSymbol;
 	}
 
-	static void RegisterParenthesisPairs(ParenthesisRegistry* registry, const Parenthesis* left, const Parenthesis* right)
+	namespace
 	{
-		registry->RegisterSymbol(std::make_shared<Parenthesis>(left->mSymbol, true, const_cast<Parenthesis*>(right)));
-		registry->RegisterSymbol(std::make_shared<Parenthesis>(right->mSymbol, false, const_cast<Parenthesis*>(left)));
+		constexpr const char* kDefaultParenthesisPairs[][2] = {
+			{ "(", ")" },
+			{ "[", "]" },
+			{ "{", "}" },
+		};
 	}
 
-	ParenthesisRegistry* ParenthesisRegistry::GetDefaultRegistry()
+	static void RegisterParenthesisPair(ParenthesisRegistry* registry, const char* open, const char* close)
 	{
-		static ParenthesisRegistry* defaultRegistry = new ParenthesisRegistry();
-		static bool initialized = false;
-
-		if (initialized)
-		{
-			return defaultRegistry;
-		}
+		std::shared_ptr<Parenthesis> left = std::make_shared<Parenthesis>(open, true);
+		std::shared_ptr<Parenthesis> right = std::make_shared<Parenthesis>(close, false, left.get());
+		left->mOpposite = right.get();
+		registry->RegisterSymbol(left);
+		registry->RegisterSymbol(right);
+	}
 
-		initialized = true;
-		// Register symbols
-		RegisterParenthesisPairs(defaultRegistry, new Parenthesis("(", true), new Parenthesis(")", false));
-		RegisterParenthesisPairs(defaultRegistry, new Parenthesis("[", true), new Parenthesis("]", false));
-		RegisterParenthesisPairs(defaultRegistry, new Parenthesis("{", true), new Parenthesis("}", false));
+	ParenthesisRegistry* ParenthesisRegistry::GetDefaultRegistry()
+	{
+		// function-local statics are initialized exactly once, even with concurrent callers
+		static ParenthesisRegistry* defaultRegistry = []()
+			{
+				ParenthesisRegistry* registry = new ParenthesisRegistry();
+				for (const auto& pair : kDefaultParenthesisPairs)
+				{
+					RegisterParenthesisPair(registry, pair[0], pair[1]);
+				}
+				return registry;
+			}();
 
 		return defaultRegistry;
 	}
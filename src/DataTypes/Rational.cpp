@@ -1,6 +1,9 @@
 #include "DataTypes/Rational.h"
 #include <numeric> // For std::gcd
 #include <sstream>
+#include <limits>
+#include <cmath>
+#include <cstdint>
 
 namespace AST
 {
@@ -101,6 +104,59 @@ namespace AST
 		return *this;
 	}
 
+	// reduces the fraction and checks that it fits the int range again
+	static bool TryMakeRational(int64_t numerator, int64_t denominator, Rational& outValue)
+	{
+		if (denominator == 0)
+		{
+			return false;
+		}
+
+		int64_t gcd = std::gcd(numerator, denominator);
+		numerator /= gcd;
+		denominator /= gcd;
+		if (denominator < 0)
+		{
+			numerator = -numerator;
+			denominator = -denominator;
+		}
+
+		const int64_t maxValue = std::numeric_limits<int>::max();
+		if (numerator > maxValue || numerator < -maxValue || denominator > maxValue)
+		{
+			return false;
+		}
+		outValue = Rational(static_cast<int>(numerator), static_cast<int>(denominator));
+		return true;
+	}
+
+	bool Rational::TryFromFraction(const int64_t numerator, const int64_t denominator, Rational& outValue)
+	{
+		return TryMakeRational(numerator, denominator, outValue);
+	}
+
+	bool Rational::TryAdd(const Rational& other, Rational& outValue) const
+	{
+		return TryMakeRational(static_cast<int64_t>(mNumerator) * other.mDenominator + static_cast<int64_t>(other.mNumerator) * mDenominator,
+			static_cast<int64_t>(mDenominator) * other.mDenominator, outValue);
+	}
+
+	bool Rational::TrySubtract(const Rational& other, Rational& outValue) const
+	{
+		return TryMakeRational(static_cast<int64_t>(mNumerator) * other.mDenominator - static_cast<int64_t>(other.mNumerator) * mDenominator,
+			static_cast<int64_t>(mDenominator) * other.mDenominator, outValue);
+	}
+
+	bool Rational::TryMultiply(const Rational& other, Rational& outValue) const
+	{
+		return TryMakeRational(static_cast<int64_t>(mNumerator) * other.mNumerator, static_cast<int64_t>(mDenominator) * other.mDenominator, outValue);
+	}
+
+	bool Rational::TryDivide(const Rational& other, Rational& outValue) const
+	{
+		return TryMakeRational(static_cast<int64_t>(mNumerator) * other.mDenominator, static_cast<int64_t>(mDenominator) * other.mNumerator, outValue);
+	}
+
 	Rational Rational::operator-() const
 	{
 		return Rational(-mNumerator, mDenominator);
@@ -332,6 +388,76 @@ namespace AST
 		return Rational(num, denom);
 	}
 
+	bool Rational::TryFromDecimalString(std::string_view str, Rational& outValue)
+	{
+		size_t index = 0;
+		bool negative = false;
+		if (index < str.size() && (str[index] == '+' || str[index] == '-'))
+		{
+			negative = str[index] == '-';
+			++index;
+		}
+
+		const int64_t maxValue = std::numeric_limits<int>::max();
+		int64_t mantissa = 0;
+		int32_t fractionalLength = 0;
+		int32_t pendingZeros = 0; // fractional zeros only matter if a non-zero digit follows
+		bool inFraction = false;
+
+		for (; index < str.size(); ++index)
+		{
+			char c = str[index];
+			if (c == '.')
+			{
+				if (inFraction)
+				{
+					return false;
+				}
+				inFraction = true;
+				continue;
+			}
+			if (c < '0' || c > '9')
+			{
+				return false;
+			}
+
+			if (inFraction && c == '0')
+			{
+				++pendingZeros;
+				continue;
+			}
+
+			for (; pendingZeros > 0; --pendingZeros)
+			{
+				mantissa *= 10;
+				++fractionalLength;
+				if (mantissa > maxValue)
+				{
+					return false;
+				}
+			}
+
+			mantissa = mantissa * 10 + (c - '0');
+			if (inFraction)
+			{
+				++fractionalLength;
+			}
+			if (mantissa > maxValue || fractionalLength > 9)
+			{
+				return false;
+			}
+		}
+
+		int denominator = 1;
+		for (int32_t i = 0; i < fractionalLength; ++i)
+		{
+			denominator *= 10;
+		}
+
+		outValue = Rational(static_cast<int>(negative ? -mantissa : mantissa), denominator);
+		return true;
+	}
+
 	std::string Rational::ToString() const
 	{
 		std::ostringstream oss;
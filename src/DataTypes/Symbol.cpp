@@ -1,4 +1,5 @@
 #include "DataTypes/Symbol.h"
+#include <atomic>
 
 namespace AST
 {
@@ -43,14 +44,64 @@ namespace AST
 		mChildren[symbol[index]]->Remove(symbol, index + 1);
 	}
 
+	uint64_t SymbolRegistry::NextInstanceId()
+	{
+		static std::atomic<uint64_t> nextInstanceId{ 1 };
+		return nextInstanceId.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// symbols are immutable and stay shared, only the search nodes are copied
+	static std::shared_ptr<SymbolSearchNode> CopySearchNode(const SymbolSearchNode& node)
+	{
+		std::shared_ptr<SymbolSearchNode> copy = std::make_shared<SymbolSearchNode>();
+		copy->mSymbols = node.mSymbols;
+		for (const auto& child : node.mChildren)
+		{
+			copy->mChildren.emplace(child.first, CopySearchNode(*child.second));
+		}
+		return copy;
+	}
+
+	SymbolRegistry::SymbolRegistry(const SymbolRegistry& other)
+		: mRoot(CopySearchNode(*other.mRoot)), mVersion(other.mVersion)
+	{
+	}
+
+	SymbolRegistry& SymbolRegistry::operator=(const SymbolRegistry& other)
+	{
+		// other contents under the same id could match keys of the old ones
+		mRoot = CopySearchNode(*other.mRoot);
+		mVersion = other.mVersion;
+		mInstanceId = NextInstanceId();
+		return *this;
+	}
+
 	void SymbolRegistry::RegisterSymbol(std::shared_ptr<Symbol> symbol)
 	{
 		mRoot->Add(symbol);
+		++mVersion;
 	}
 
 	void SymbolRegistry::UnregisterSymbol(const std::string& symbol)
 	{
 		mRoot->Remove(symbol);
+		++mVersion;
+	}
+
+	static void CollectSymbols(const SymbolSearchNode* node, std::vector<std::shared_ptr<Symbol>>& outSymbols)
+	{
+		outSymbols.insert(outSymbols.end(), node->mSymbols.begin(), node->mSymbols.end());
+		for (const auto& child : node->mChildren)
+		{
+			CollectSymbols(child.second.get(), outSymbols);
+		}
+	}
+
+	std::vector<std::shared_ptr<Symbol>> SymbolRegistry::GetSymbols() const
+	{
+		std::vector<std::shared_ptr<Symbol>> symbols;
+		CollectSymbols(mRoot.get(), symbols);
+		return symbols;
 	}
 
 	std::shared_ptr<Symbol> SymbolRegistry::GetSymbol(const std::string& symbol, const std::function<bool(const std::shared_ptr<Symbol>&)>& findFirstMatch) const
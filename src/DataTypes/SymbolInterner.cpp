@@ -0,0 +1,47 @@
+#include "DataTypes/SymbolInterner.h"
+#include <mutex>
+
+namespace AST
+{
+	InternedSymbol SymbolInterner::Intern(std::string_view name)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(mMutex);
+			auto it = mIds.find(name);
+			if (it != mIds.end())
+			{
+				return { mSymbols[it->second].get(), it->second };
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		auto it = mIds.find(name);
+		if (it != mIds.end())
+		{
+			return { mSymbols[it->second].get(), it->second };
+		}
+
+		uint32_t id = static_cast<uint32_t>(mSymbols.size());
+		mSymbols.push_back(std::make_unique<Symbol>(std::string(name)));
+		mIds.emplace(mSymbols.back()->mSymbol, id);
+		return { mSymbols.back().get(), id };
+	}
+
+	const Symbol* SymbolInterner::GetSymbol(const uint32_t id) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		return id < mSymbols.size() ? mSymbols[id].get() : nullptr;
+	}
+
+	size_t SymbolInterner::GetSize() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		return mSymbols.size();
+	}
+
+	SymbolInterner& SymbolInterner::GetDefault()
+	{
+		static SymbolInterner interner;
+		return interner;
+	}
+}
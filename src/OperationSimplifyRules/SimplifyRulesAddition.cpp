@@ -3,167 +3,193 @@
 
 namespace AST
 {
-	struct RationalSimplify : public ISimplifyRule
+	// rule names repeat across operations, keep them local to this file
+	namespace
 	{
-		RationalSimplify() : ISimplifyRule(0) {}
-
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const
+		struct RationalSimplify : public ISimplifyRule
 		{
-			for (auto& operand : operands)
+			RationalSimplify() : ISimplifyRule(0) {}
+
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
+				for (auto& operand : operands)
 				{
-					return std::make_unique<SimplifyCheckResult>(false);
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						return std::make_unique<SimplifyCheckResult>(false);
+					}
 				}
+				return std::make_unique<SimplifyCheckResult>(true);
 			}
-			return std::make_unique<SimplifyCheckResult>(true);
-		}
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const
-		{
-			Rational result = 0;
-			for (auto& operand : operands)
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const
 			{
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				result += rationalNode->mValue;
+				Rational result = 0;
+				for (auto& operand : operands)
+				{
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					result += rationalNode->mValue;
+				}
+				return { true, new RationalNode(result) };
 			}
-			return { true, new RationalNode(result) };
-		}
-	};
-
-	struct IdentitySimplify : public ISimplifyRule
-	{
-		IdentitySimplify() : ISimplifyRule(0) {}
+		};
 
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
+		struct IdentitySimplify : public ISimplifyRule
 		{
-			int32_t nonZeroOperands = 0;
-			for (auto& operand : operands)
+			IdentitySimplify() : ISimplifyRule(0) {}
+
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
-				{
-					++nonZeroOperands;
-					continue;
-				}
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				if (rationalNode->mValue != 0)
+				int32_t nonZeroOperands = 0;
+				for (auto& operand : operands)
 				{
-					++nonZeroOperands;
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						++nonZeroOperands;
+						continue;
+					}
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					if (rationalNode->mValue != 0)
+					{
+						++nonZeroOperands;
+					}
 				}
-			}
 
-			return std::make_unique<SimplifyCheckResult>(nonZeroOperands == 1);
+				return std::make_unique<SimplifyCheckResult>(nonZeroOperands == 1);
 
-		};
+			};
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			for (auto& operand : operands)
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
+				for (auto& operand : operands)
 				{
-					return { true, operand->Clone() };
-				}
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						return { true, Keep(operand) };
+					}
 
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				if (rationalNode->mValue != 0)
-				{
-					return { true, operand->Clone() };
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					if (rationalNode->mValue != 0)
+					{
+						return { true, Keep(operand) };
+					}
 				}
+				return { true, new RationalNode(0) };
 			}
-			return { true, new RationalNode(0) };
-		}
-	};
+		};
+	}
 
 	// left * common + right * common = (left + right) * common
-	ASTNode* AdditionSimplifyRule::CombineCommonTerms(const ASTNode* left, const ASTNode* right, const ASTNode* common)
+	ASTNode* AdditionSimplifyRule::CombineCommonTerms(ASTNode* left, ASTNode* right, ASTNode* common)
 	{
-		if (!left || !right || !common)
-			return nullptr; // Ensure valid input
-
-		std::vector<ASTNode*> operands = { left->Clone(), right->Clone() };
-		SimplifyResult additionSimplifiedResult = mSimplifier->SimplifyOperation(OperationId::Addition, operands);
-		ASTNode* additionSimplifiedNode = additionSimplifiedResult.mSuccess ? additionSimplifiedResult.mResult : NewOperatorNode(OperationId::Addition, operands);
-
-		operands = { additionSimplifiedNode, common->Clone() };
-		SimplifyResult multiplicationSimplifiedResult = mSimplifier->SimplifyOperation(OperationId::Multiplication, operands);
-		ASTNode* multiplicationSimplifiedNode = multiplicationSimplifiedResult.mSuccess ? multiplicationSimplifiedResult.mResult : NewOperatorNode(OperationId::Multiplication, operands);
+		// a rule result is built from copies, the operands are kept only when no rule applies;
+		// the nested operations count against the steps of the Simplify call running this rule
+		auto combine = [this](const OperationId operation, const std::vector<ASTNode*>& operands)
+			{
+				SimplifyResult result = mSimplifier->SimplifyOperation(operation, operands);
+				if (!result.mSuccess)
+				{
+					return static_cast<ASTNode*>(NewOperatorNode(operation, operands));
+				}
+				for (ASTNode* operand : operands)
+				{
+					delete operand;
+				}
+				return result.mResult;
+			};
 
-		return multiplicationSimplifiedNode;
+		ASTNode* additionSimplifiedNode = combine(OperationId::Addition, { left, right });
+		return combine(OperationId::Multiplication, { additionSimplifiedNode, common });
 	}
 
-	struct LikeTermSimplify : public ISimplifyRule
+	namespace
 	{
-		AdditionSimplifyRule* mSimplifyRule = nullptr;
+		struct LikeTermSimplify : public ISimplifyRule
+		{
+			AdditionSimplifyRule* mSimplifyRule = nullptr;
 
-		LikeTermSimplify(AdditionSimplifyRule* simplifyRule) : ISimplifyRule(2), mSimplifyRule(simplifyRule) {}
+			LikeTermSimplify(AdditionSimplifyRule* simplifyRule) : ISimplifyRule(2), mSimplifyRule(simplifyRule) {}
 
-		struct LikeTermSimplifyCheckResult : public SimplifyCheckResult
-		{
-			bool mIsOperand0Multiplication = false;
-			bool mOperand0MatchedIndex = false;  // false = 0, true = 1
-			bool mIsOperand1Multiplication = false;
-			bool mOperand1MatchedIndex = false;  // false = 0, true = 1
-
-			LikeTermSimplifyCheckResult() = default;
-			LikeTermSimplifyCheckResult(const bool success, const bool isOperand0Multiplication, const bool operand0MatchedIndex,
-				const bool isOperand1Multiplication, const bool operand1MatchedIndex)
-				: SimplifyCheckResult(success),
-				mIsOperand0Multiplication(isOperand0Multiplication), mOperand0MatchedIndex(operand0MatchedIndex),
-				mIsOperand1Multiplication(isOperand1Multiplication), mOperand1MatchedIndex(operand1MatchedIndex)
+			struct LikeTermSimplifyCheckResult : public SimplifyCheckResult
 			{
+				bool mIsOperand0Multiplication = false;
+				bool mOperand0MatchedIndex = false;  // false = 0, true = 1
+				bool mIsOperand1Multiplication = false;
+				bool mOperand1MatchedIndex = false;  // false = 0, true = 1
+
+				LikeTermSimplifyCheckResult() = default;
+				LikeTermSimplifyCheckResult(const bool success, const bool isOperand0Multiplication, const bool operand0MatchedIndex,
+					const bool isOperand1Multiplication, const bool operand1MatchedIndex)
+					: SimplifyCheckResult(success),
+					mIsOperand0Multiplication(isOperand0Multiplication), mOperand0MatchedIndex(operand0MatchedIndex),
+					mIsOperand1Multiplication(isOperand1Multiplication), mOperand1MatchedIndex(operand1MatchedIndex)
+				{
+				};
 			};
-		};
 
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
-		{
-			if (operands.size() != 2)
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				return std::make_unique<LikeTermSimplifyCheckResult>(false, false, false, false, false);
-			}
+				if (operands.size() != 2)
+				{
+					return std::make_unique<LikeTermSimplifyCheckResult>(false, false, false, false, false);
+				}
 
-			bool isOperand0Multiplication = false;
-			bool operand0MatchedIndex = false;
-			bool isOperand1Multiplication = false;
-			bool operand1MatchedIndex = false;
-			bool success = false;
+				bool isOperand0Multiplication = false;
+				bool operand0MatchedIndex = false;
+				bool isOperand1Multiplication = false;
+				bool operand1MatchedIndex = false;
+				bool success = false;
 
-			if (operands[0]->mType == ASTNode::NodeType::Operator)
-			{
-				const OperatorNode* operatorNode = dynamic_cast<const OperatorNode*>(operands[0]);
-				if (operatorNode->mOperator->mOperationId == OperationId::Multiplication)
+				if (operands[0]->mType == ASTNode::NodeType::Operator)
 				{
-					isOperand0Multiplication = true;
-					if (operands[1]->mType == ASTNode::NodeType::Operator)
+					const OperatorNode* operatorNode = NodeCast<OperatorNode>(operands[0]);
+					if (operatorNode->mOperator->mOperationId == OperationId::Multiplication)
 					{
-						const OperatorNode* operatorNode2 = dynamic_cast<const OperatorNode*>(operands[1]);
-						if (operatorNode2->mOperator->mOperationId == OperationId::Multiplication)
+						isOperand0Multiplication = true;
+						if (operands[1]->mType == ASTNode::NodeType::Operator)
 						{
-							isOperand1Multiplication = true;
-
-							if (*operatorNode->mOperands[0] == *operatorNode2->mOperands[0])
+							const OperatorNode* operatorNode2 = NodeCast<OperatorNode>(operands[1]);
+							if (operatorNode2->mOperator->mOperationId == OperationId::Multiplication)
 							{
-								operand0MatchedIndex = false;
-								operand1MatchedIndex = false;
-								success = true;
+								isOperand1Multiplication = true;
+
+								if (*operatorNode->mOperands[0] == *operatorNode2->mOperands[0])
+								{
+									operand0MatchedIndex = false;
+									operand1MatchedIndex = false;
+									success = true;
+								}
+								else if (*operatorNode->mOperands[0] == *operatorNode2->mOperands[1])
+								{
+									operand0MatchedIndex = false;
+									operand1MatchedIndex = true;
+									success = true;
+								}
+								else if (*operatorNode->mOperands[1] == *operatorNode2->mOperands[0])
+								{
+									operand0MatchedIndex = true;
+									operand1MatchedIndex = false;
+									success = true;
+								}
+								else if (*operatorNode->mOperands[1] == *operatorNode2->mOperands[1])
+								{
+									operand0MatchedIndex = true;
+									operand1MatchedIndex = true;
+									success = true;
+								}
 							}
-							else if (*operatorNode->mOperands[0] == *operatorNode2->mOperands[1])
+							else
 							{
-								operand0MatchedIndex = false;
-								operand1MatchedIndex = true;
-								success = true;
-							}
-							else if (*operatorNode->mOperands[1] == *operatorNode2->mOperands[0])
-							{
-								operand0MatchedIndex = true;
-								operand1MatchedIndex = false;
-								success = true;
-							}
-							else if (*operatorNode->mOperands[1] == *operatorNode2->mOperands[1])
-							{
-								operand0MatchedIndex = true;
-								operand1MatchedIndex = true;
-								success = true;
+								if (*operatorNode->mOperands[0] == *operands[1])
+								{
+									operand0MatchedIndex = false;
+									success = true;
+								}
+								else if (*operatorNode->mOperands[1] == *operands[1])
+								{
+									operand0MatchedIndex = true;
+									success = true;
+								}
 							}
 						}
 						else
@@ -179,203 +205,184 @@ namespace AST
 								success = true;
 							}
 						}
+
+						return std::make_unique<LikeTermSimplifyCheckResult>(
+							success, isOperand0Multiplication, operand0MatchedIndex,
+							isOperand1Multiplication, operand1MatchedIndex);
 					}
-					else
+				}
+
+				if (operands[1]->mType == ASTNode::NodeType::Operator)
+				{
+					const OperatorNode* operatorNode2 = NodeCast<OperatorNode>(operands[1]);
+					if (operatorNode2->mOperator->mOperationId == OperationId::Multiplication)
 					{
-						if (*operatorNode->mOperands[0] == *operands[1])
+						isOperand1Multiplication = true;
+
+						if (*operands[0] == *operatorNode2->mOperands[0])
 						{
-							operand0MatchedIndex = false;
+							operand1MatchedIndex = false;
 							success = true;
 						}
-						else if (*operatorNode->mOperands[1] == *operands[1])
+						else if (*operands[0] == *operatorNode2->mOperands[1])
 						{
-							operand0MatchedIndex = true;
+							operand1MatchedIndex = true;
 							success = true;
 						}
 					}
-
-					return std::make_unique<LikeTermSimplifyCheckResult>(
-						success, isOperand0Multiplication, operand0MatchedIndex,
-						isOperand1Multiplication, operand1MatchedIndex);
-				}
-			}
-
-			if (operands[1]->mType == ASTNode::NodeType::Operator)
-			{
-				const OperatorNode* operatorNode2 = dynamic_cast<const OperatorNode*>(operands[1]);
-				if (operatorNode2->mOperator->mOperationId == OperationId::Multiplication)
-				{
-					isOperand1Multiplication = true;
-
-					if (*operands[0] == *operatorNode2->mOperands[0])
-					{
-						operand1MatchedIndex = false;
-						success = true;
-					}
-					else if (*operands[0] == *operatorNode2->mOperands[1])
+					else
 					{
-						operand1MatchedIndex = true;
-						success = true;
+						if (*operands[0] == *operatorNode2->mOperands[0])
+						{
+							success = true;
+						}
 					}
 				}
 				else
 				{
-					if (*operands[0] == *operatorNode2->mOperands[0])
+					if (*operands[0] == *operands[1])
 					{
 						success = true;
 					}
 				}
+
+				return std::make_unique<LikeTermSimplifyCheckResult>(
+					success, isOperand0Multiplication, operand0MatchedIndex,
+					isOperand1Multiplication, operand1MatchedIndex);
 			}
-			else
+
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
 			{
-				if (*operands[0] == *operands[1])
+				// Check of this rule made the result
+				const LikeTermSimplifyCheckResult* likeTermResult = static_cast<const LikeTermSimplifyCheckResult*>(checkResult.get());
+				if (!likeTermResult || !likeTermResult->mSuccess)
 				{
-					success = true;
+					return SimplifyResult(false, nullptr); // If the check failed, return failure
 				}
-			}
 
-			return std::make_unique<LikeTermSimplifyCheckResult>(
-				success, isOperand0Multiplication, operand0MatchedIndex,
-				isOperand1Multiplication, operand1MatchedIndex);
-		}
+				// Extract the operands
+				ASTNode* operand0 = operands[0];
+				ASTNode* operand1 = operands[1];
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			const LikeTermSimplifyCheckResult* likeTermResult = dynamic_cast<const LikeTermSimplifyCheckResult*>(checkResult.get());
-			if (!likeTermResult || !likeTermResult->mSuccess)
-			{
-				return SimplifyResult(false, nullptr); // If the check failed, return failure
-			}
-
-			// Extract the operands
-			ASTNode* operand0 = operands[0];
-			ASTNode* operand1 = operands[1];
-
-			// Determine the common term and the remaining terms
-			ASTNode* commonTerm = nullptr;
-			ASTNode* leftTerm = nullptr;
-			ASTNode* rightTerm = nullptr;
+				// Determine the common term and the remaining terms
+				ASTNode* commonTerm = nullptr;
+				ASTNode* leftTerm = nullptr;
+				ASTNode* rightTerm = nullptr;
 
-			if (likeTermResult->mIsOperand0Multiplication && likeTermResult->mIsOperand1Multiplication)
-			{
-				// Both operands are multiplications
-				const OperatorNode* operatorNode0 = dynamic_cast<const OperatorNode*>(operand0);
-				const OperatorNode* operatorNode1 = dynamic_cast<const OperatorNode*>(operand1);
+				if (likeTermResult->mIsOperand0Multiplication && likeTermResult->mIsOperand1Multiplication)
+				{
+					// Both operands are multiplications
+					const OperatorNode* operatorNode0 = NodeCast<OperatorNode>(operand0);
+					const OperatorNode* operatorNode1 = NodeCast<OperatorNode>(operand1);
 
-				// Determine which operand of the first multiplication matches which operand of the second multiplication
-				if (likeTermResult->mOperand0MatchedIndex == likeTermResult->mOperand1MatchedIndex)
+					// Determine which operand of the first multiplication matches which operand of the second multiplication
+					if (likeTermResult->mOperand0MatchedIndex == likeTermResult->mOperand1MatchedIndex)
+					{
+						// Both matched operands are at the same index (e.g., left * common and left * common)
+						commonTerm = Keep(operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]);
+						leftTerm = Keep(operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]);
+						rightTerm = Keep(operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]);
+					}
+					else
+					{
+						// Matched operands are at different indices (e.g., left * common and common * right)
+						commonTerm = Keep(operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]);
+						leftTerm = Keep(operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]);
+						rightTerm = Keep(operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]);
+					}
+				}
+				else if (likeTermResult->mIsOperand0Multiplication)
 				{
-					// Both matched operands are at the same index (e.g., left * common and left * common)
-					commonTerm = operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]->Clone();
-					leftTerm = operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]->Clone();
-					rightTerm = operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]->Clone();
+					// Only operand0 is a multiplication
+					const OperatorNode* operatorNode0 = NodeCast<OperatorNode>(operand0);
+					commonTerm = Keep(operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]);
+					leftTerm = Keep(operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]);
+					rightTerm = mSimplifyRule->NewRationalNode(1);
+				}
+				else if (likeTermResult->mIsOperand1Multiplication)
+				{
+					// Only operand1 is a multiplication
+					const OperatorNode* operatorNode1 = NodeCast<OperatorNode>(operand1);
+					commonTerm = Keep(operatorNode1->mOperands[likeTermResult->mOperand1MatchedIndex]);
+					leftTerm = mSimplifyRule->NewRationalNode(1);
+					rightTerm = Keep(operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]);
 				}
 				else
 				{
-					// Matched operands are at different indices (e.g., left * common and common * right)
-					commonTerm = operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]->Clone();
-					leftTerm = operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]->Clone();
-					rightTerm = operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]->Clone();
+					// Neither operand is a multiplication (e.g., x + x)
+					commonTerm = Keep(operand0);
+					leftTerm = mSimplifyRule->NewRationalNode(1); // 1 * x + 1 * x = (1 + 1) * x
+					rightTerm = mSimplifyRule->NewRationalNode(1);
 				}
-			}
-			else if (likeTermResult->mIsOperand0Multiplication)
-			{
-				// Only operand0 is a multiplication
-				const OperatorNode* operatorNode0 = dynamic_cast<const OperatorNode*>(operand0);
-				commonTerm = operatorNode0->mOperands[likeTermResult->mOperand0MatchedIndex]->Clone();
-				leftTerm = operatorNode0->mOperands[!likeTermResult->mOperand0MatchedIndex]->Clone();
-				rightTerm = mSimplifyRule->NewRationalNode(1);
-			}
-			else if (likeTermResult->mIsOperand1Multiplication)
-			{
-				// Only operand1 is a multiplication
-				const OperatorNode* operatorNode1 = dynamic_cast<const OperatorNode*>(operand1);
-				commonTerm = operatorNode1->mOperands[likeTermResult->mOperand1MatchedIndex]->Clone();
-				leftTerm = mSimplifyRule->NewRationalNode(1);
-				rightTerm = operatorNode1->mOperands[!likeTermResult->mOperand1MatchedIndex]->Clone();
-			}
-			else
-			{
-				// Neither operand is a multiplication (e.g., x + x)
-				commonTerm = operand0->Clone();
-				leftTerm = mSimplifyRule->NewRationalNode(1); // 1 * x + 1 * x = (1 + 1) * x
-				rightTerm = mSimplifyRule->NewRationalNode(1);
-			}
 
-			// Combine the terms using the CombineCommonTerms function
-
-			ASTNode* simplifiedNode = mSimplifyRule->CombineCommonTerms(leftTerm, rightTerm, commonTerm);
-			if (!simplifiedNode)
-			{
-				return SimplifyResult(false, nullptr); // If combining failed, return failure
+				// Combine the terms using the CombineCommonTerms function, which takes them
+				return SimplifyResult(true, mSimplifyRule->CombineCommonTerms(leftTerm, rightTerm, commonTerm));
 			}
+		};
 
-			return SimplifyResult(true, simplifiedNode);
-		}
-	};
-
-	struct OppositeSimplify : public ISimplifyRule
-	{
-	private:
-		bool IsUnaryMinus(const ASTNode* node) const
+		struct OppositeSimplify : public ISimplifyRule
 		{
-			if (node->mType != ASTNode::NodeType::Operator)
-			{
-				return false;
-			}
-			const OperatorNode* operatorNode = dynamic_cast<const OperatorNode*>(node);
-			if (operatorNode->mOperator->mOperationId != OperationId::UnaryMinus)
+		private:
+			bool IsUnaryMinus(const ASTNode* node) const
 			{
-				return false;
+				if (node->mType != ASTNode::NodeType::Operator)
+				{
+					return false;
+				}
+				const OperatorNode* operatorNode = NodeCast<OperatorNode>(node);
+				if (operatorNode->mOperator->mOperationId != OperationId::UnaryMinus)
+				{
+					return false;
+				}
+				return true;
 			}
-			return true;
-		}
 
-		const ASTNode* GetUnaryMinusOperand(const ASTNode* node) const
-		{
-			const OperatorNode* operatorNode = dynamic_cast<const OperatorNode*>(node);
-			return operatorNode->mOperands[0];
-		}
-
-	public:
-		OppositeSimplify() : ISimplifyRule(1) {}
-
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
-		{
-			if (operands.size() != 2)
+			const ASTNode* GetUnaryMinusOperand(const ASTNode* node) const
 			{
-				return std::make_unique<SimplifyCheckResult>(false);
+				const OperatorNode* operatorNode = NodeCast<OperatorNode>(node);
+				return operatorNode->mOperands[0];
 			}
 
-			return std::make_unique<SimplifyCheckResult>(IsUnaryMinus(operands[0]) || IsUnaryMinus(operands[1]));
-		}
+		public:
+			OppositeSimplify() : ISimplifyRule(1) {}
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			if (IsUnaryMinus(operands[0]))
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				if (*GetUnaryMinusOperand(operands[0]) == *operands[1])
+				if (operands.size() != 2)
 				{
-					return { true, new RationalNode(0) };
+					return std::make_unique<SimplifyCheckResult>(false);
 				}
+
+				return std::make_unique<SimplifyCheckResult>(IsUnaryMinus(operands[0]) || IsUnaryMinus(operands[1]));
 			}
-			else
+
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
 			{
-				if (*GetUnaryMinusOperand(operands[1]) == *operands[0])
+				if (IsUnaryMinus(operands[0]))
+				{
+					if (*GetUnaryMinusOperand(operands[0]) == *operands[1])
+					{
+						return { true, new RationalNode(0) };
+					}
+				}
+				else
 				{
-					return { true, new RationalNode(0) };
+					if (*GetUnaryMinusOperand(operands[1]) == *operands[0])
+					{
+						return { true, new RationalNode(0) };
+					}
 				}
+				return { false, nullptr };
 			}
-			return { false, nullptr };
-		}
-	};
+		};
+	}
 
 	AdditionSimplifyRule::AdditionSimplifyRule(ASTSimplifier* simplifier)
 		:OperationSimplifyRule(simplifier)
 	{
-		mRules.AddRule(new IdentitySimplify());
-		mRules.AddRule(new RationalSimplify());
-		mRules.AddRule(new OppositeSimplify());
-		mRules.AddRule(new LikeTermSimplify(this));
+		mRules.AddRule(std::make_unique<IdentitySimplify>());
+		mRules.AddRule(std::make_unique<RationalSimplify>());
+		mRules.AddRule(std::make_unique<OppositeSimplify>());
+		mRules.AddRule(std::make_unique<LikeTermSimplify>(this));
 	}
 }
\ No newline at end of file
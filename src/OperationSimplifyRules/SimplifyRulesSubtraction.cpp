@@ -3,82 +3,86 @@
 
 namespace AST
 {
-	struct RationalSimplify : public ISimplifyRule
+	// rule names repeat across operations, keep them local to this file
+	namespace
 	{
-		RationalSimplify() : ISimplifyRule(0) {}
-
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
+		struct RationalSimplify : public ISimplifyRule
 		{
-			for (auto& operand : operands)
+			RationalSimplify() : ISimplifyRule(0) {}
+
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
+				for (auto& operand : operands)
 				{
-					return std::make_unique<SimplifyCheckResult>(false);
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						return std::make_unique<SimplifyCheckResult>(false);
+					}
 				}
+				return std::make_unique<SimplifyCheckResult>(true);
 			}
-			return std::make_unique<SimplifyCheckResult>(true);
-		}
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			Rational result = 0;
-			for (auto& operand : operands)
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
 			{
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				result -= rationalNode->mValue;
+				Rational result = 0;
+				for (auto& operand : operands)
+				{
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					result -= rationalNode->mValue;
+				}
+				return { true, new RationalNode(result) };
 			}
-			return { true, new RationalNode(result) };
-		}
-	};
-
-	struct IdentitySimplify : public ISimplifyRule
-	{
-		IdentitySimplify() : ISimplifyRule(0) {}
+		};
 
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
+		struct IdentitySimplify : public ISimplifyRule
 		{
-			int32_t nonZeroOperands = 0;
-			for (auto& operand : operands)
+			IdentitySimplify() : ISimplifyRule(0) {}
+
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
+				int32_t nonZeroOperands = 0;
+				for (auto& operand : operands)
 				{
-					++nonZeroOperands;
-					continue;
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						++nonZeroOperands;
+						continue;
+					}
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					if (rationalNode->mValue != 0)
+					{
+						++nonZeroOperands;
+					}
 				}
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				if (rationalNode->mValue != 0)
-				{
-					++nonZeroOperands;
-				}
-			}
 
-			return std::make_unique<SimplifyCheckResult>(nonZeroOperands == 1);
+				return std::make_unique<SimplifyCheckResult>(nonZeroOperands == 1);
 
-		};
+			};
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			for (auto& operand : operands)
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
 			{
-				if (operand->mType != ASTNode::NodeType::Rational)
+				for (auto& operand : operands)
 				{
-					return { true, operand->Clone() };
-				}
+					if (operand->mType != ASTNode::NodeType::Rational)
+					{
+						return { true, Keep(operand) };
+					}
 
-				RationalNode* rationalNode = dynamic_cast<RationalNode*>(operand);
-				if (rationalNode->mValue != 0)
-				{
-					return { true, operand->Clone() };
+					RationalNode* rationalNode = NodeCast<RationalNode>(operand);
+					if (rationalNode->mValue != 0)
+					{
+						return { true, Keep(operand) };
+					}
 				}
+				return { true, new RationalNode(0) };
 			}
-			return { true, new RationalNode(0) };
-		}
-	};
+		};
+	}
 
 	SubtractionSimplifyRule::SubtractionSimplifyRule(ASTSimplifier* simplifier)
 		:OperationSimplifyRule(simplifier)
 	{
-		mRules.AddRule(new IdentitySimplify());
-		mRules.AddRule(new RationalSimplify());
+		mRules.AddRule(std::make_unique<IdentitySimplify>());
+		mRules.AddRule(std::make_unique<RationalSimplify>());
 	}
 }
\ No newline at end of file
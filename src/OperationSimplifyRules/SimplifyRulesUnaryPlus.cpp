@@ -3,30 +3,34 @@
 
 namespace AST
 {
-	struct GeneralSimplify : public ISimplifyRule
+	// rule names repeat across operations, keep them local to this file
+	namespace
 	{
-		GeneralSimplify() : ISimplifyRule(0) {}
-
-		virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
+		struct GeneralSimplify : public ISimplifyRule
 		{
-			if (operands.size() != 1)
+			GeneralSimplify() : ISimplifyRule(0) {}
+
+			virtual std::unique_ptr<SimplifyCheckResult> Check(const std::vector<ASTNode*> operands) const override
 			{
-				return std::make_unique<SimplifyCheckResult>(false);
-			}
+				if (operands.size() != 1)
+				{
+					return std::make_unique<SimplifyCheckResult>(false);
+				}
 
-			return std::make_unique<SimplifyCheckResult>(true);
+				return std::make_unique<SimplifyCheckResult>(true);
 
-		};
+			};
 
-		virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
-		{
-			return { true, operands[0]->Clone() };
-		}
-	};
+			virtual SimplifyResult Simplify(const std::vector<ASTNode*> operands, const std::unique_ptr<SimplifyCheckResult>& checkResult) const override
+			{
+				return { true, Keep(operands[0]) };
+			}
+		};
+	}
 
 	UnaryPlusSimplifyRule::UnaryPlusSimplifyRule(ASTSimplifier* simplifier)
 		:OperationSimplifyRule(simplifier)
 	{
-		mRules.AddRule(new GeneralSimplify());
+		mRules.AddRule(std::make_unique<GeneralSimplify>());
 	}
 } // namespace AST
\ No newline at end of file
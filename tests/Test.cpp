@@ -2,12 +2,20 @@
 #include "ASTParser.h"
 #include "ASTNodeTreeViewer.h"
 #include "ASTSimplifier.h"
+#include "ASTExpressionReader.h"
+#include "ASTParseCache.h"
+#include "ASTIncrementalParser.h"
+#include "ASTBuffer.h"
+#include "ASTSharedNode.h"
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <chrono>
+#include <fstream>
+#include <filesystem>
 #ifdef UNIT_TEST
 namespace AST
 {
@@ -28,6 +36,15 @@ namespace AST
 		Rational r6 = Rational::FromString("0.5");
 		REQUIRE(r6.GetNumerator() == 1);
 		REQUIRE(r6.GetDenominator() == 2);
+
+		Rational r7;
+		REQUIRE(Rational::TryFromDecimalString("-1.250", r7));
+		REQUIRE(r7 == Rational(-5, 4));
+		REQUIRE(Rational::TryFromDecimalString(".5", r7));
+		REQUIRE(r7 == Rational(1, 2));
+		REQUIRE(Rational::TryFromDecimalString("12.", r7));
+		REQUIRE(r7 == Rational(12));
+		REQUIRE(!Rational::TryFromDecimalString("99999999999", r7));
 	}
 
 	TEST_CASE("RationalOperatorsTest", "[RationalOperatorsTest]")
@@ -165,11 +182,10 @@ namespace AST
 
 		static OperatorNode* CreateOperatorNode(const std::string& symbol, std::vector<ASTNode*> operands)
 		{
-			Symbol* symbolPtr = new Symbol(symbol);
-			OperatorNode* node = new OperatorNode(symbolPtr);
-			node->mOperator = new Operator(OperatorType::FunctionMultiple, Associativity::LeftToRight, 0, symbol, OperationId::Invalid);
-			node->mOperands = operands;
-			return node;
+			// nodes only point to their operator, these live until the tests end
+			static std::vector<std::unique_ptr<Operator>> operators;
+			operators.push_back(std::make_unique<Operator>(OperatorType::FunctionMultiple, Associativity::LeftToRight, 0, symbol, OperationId::Invalid));
+			return new OperatorNode(operators.back().get(), operands);
 		}
 	};
 
@@ -255,22 +271,69 @@ namespace AST
 		SECTION("Parse")
 		{
 			ASTNode* node = parserTest.mParser.Parse("3--sinpi");
-			std::string out = ASTNodeTreeViewer::PrintTree(node);
-			std::cout << out << std::endl;
+			OperatorNode* subtraction = NodeCast<OperatorNode>(node);
+			REQUIRE(subtraction);
+			REQUIRE(subtraction->mOperator->mOperationId == OperationId::Subtraction);
+			REQUIRE(NodeCast<RationalNode>(subtraction->mOperands[0])->mValue == Rational(3));
+			OperatorNode* minus = NodeCast<OperatorNode>(subtraction->mOperands[1]);
+			REQUIRE(minus);
+			REQUIRE(minus->mOperator->mOperationId == OperationId::UnaryMinus);
+			OperatorNode* sine = NodeCast<OperatorNode>(minus->mOperands[0]);
+			REQUIRE(sine);
+			REQUIRE(sine->mOperator->mOperationId == OperationId::Sine);
+			REQUIRE(NodeCast<IrrationalNode>(sine->mOperands[0]));
+			delete node;
 		}
 
 		SECTION("Parse2")
 		{
 			ASTNode* node = parserTest.mParser.Parse("0+sin(x)");
-			std::string out = ASTNodeTreeViewer::PrintTree(node);
-			std::cout << out << std::endl;
+			OperatorNode* addition = NodeCast<OperatorNode>(node);
+			REQUIRE(addition);
+			REQUIRE(addition->mOperator->mOperationId == OperationId::Addition);
+			REQUIRE(NodeCast<RationalNode>(addition->mOperands[0])->mValue == Rational(0));
+			OperatorNode* sine = NodeCast<OperatorNode>(addition->mOperands[1]);
+			REQUIRE(sine);
+			REQUIRE(sine->mOperator->mOperationId == OperationId::Sine);
+			REQUIRE(NodeCast<VariableNode>(sine->mOperands[0]));
+			delete node;
 		}
 
 		SECTION("Parse3")
 		{
 			ASTNode* node = parserTest.mParser.Parse("5x");
-			std::string out = ASTNodeTreeViewer::PrintTree(node);
-			std::cout << out << std::endl;
+			OperatorNode* multiplication = NodeCast<OperatorNode>(node);
+			REQUIRE(multiplication);
+			REQUIRE(multiplication->mOperator->mOperationId == OperationId::Multiplication);
+			REQUIRE(NodeCast<RationalNode>(multiplication->mOperands[0])->mValue == Rational(5));
+			REQUIRE(NodeCast<VariableNode>(multiplication->mOperands[1]));
+			delete node;
+		}
+
+		SECTION("CustomSymbols")
+		{
+			for (int i = 0; i < 2000; ++i)
+			{
+				parserTest.mParser.RegisterCustomSymbol("v" + std::to_string(i));
+			}
+			ASTNode* node = parserTest.mParser.Parse("v1999+v12");
+			REQUIRE(node->mType == ASTNode::NodeType::Operator);
+			const OperatorNode* operatorNode = dynamic_cast<const OperatorNode*>(node);
+			REQUIRE(dynamic_cast<const VariableNode*>(operatorNode->mOperands[0])->mVariable->mSymbol == "v1999");
+			REQUIRE(dynamic_cast<const VariableNode*>(operatorNode->mOperands[1])->mVariable->mSymbol == "v12");
+			REQUIRE(parserTest.mParser.ExtractCustomSymbol("v123x").mExtractedLength == 4);
+			delete node;
+		}
+
+		SECTION("ParseStringView")
+		{
+			std::string buffer = "5x;0+sin(x);ignored";
+			std::string_view view(buffer.data() + 3, 8);
+			ASTNode* fromView = parserTest.mParser.Parse(view);
+			ASTNode* fromString = parserTest.mParser.Parse(std::string("0+sin(x)"));
+			REQUIRE(*fromView == *fromString);
+			delete fromView;
+			delete fromString;
 		}
 
 		SECTION("ASTNodeTreeViewer")
@@ -340,7 +403,1568 @@ namespace AST
 				"1   1   1   1                               1  1  1  1  1"
 			);
 
-			std::cout << treeStr << std::endl;
+			delete testOp1;
+		}
+	}
+
+	TEST_CASE("ArenaParseTest", "[ArenaParseTest]")
+	{
+		ParserTest parserTest;
+		SECTION("MatchesHeapParse")
+		{
+			ASTNode* heapNode = parserTest.mParser.Parse("1.5cos(x)+cos(x)*sin(pi)");
+			ASTArenaTree arenaTree = parserTest.mParser.ParseToArena("1.5cos(x)+cos(x)*sin(pi)");
+			REQUIRE(arenaTree);
+			REQUIRE(arenaTree->mOwnership == ASTNode::NodeOwnership::Arena);
+			REQUIRE(arenaTree.GetArena()->GetNodeCount() > 0);
+			REQUIRE(*arenaTree == *heapNode);
+			REQUIRE(ASTNodeTreeViewer::PrintTree(arenaTree) == ASTNodeTreeViewer::PrintTree(heapNode));
+			delete heapNode;
+
+			// the operand lists are allocated from the arena as well
+			const std::pmr::memory_resource* arena = arenaTree.GetArena();
+			const OperatorNode* root = NodeCast<OperatorNode>(arenaTree.GetRoot());
+			REQUIRE(root->mOperands.get_allocator().resource() == arena);
+			REQUIRE(NodeCast<OperatorNode>(root->mOperands[1])->mOperands.get_allocator().resource() == arena);
+		}
+
+		SECTION("SimplifyFromArena")
+		{
+			ASTArenaTree arenaTree = parserTest.mParser.ParseToArena("cos(x)+1.5cos(x)");
+			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+			ASTNode* simplifiedNode = simplifier.Simplify(arenaTree);
+			REQUIRE(simplifiedNode->mOwnership == ASTNode::NodeOwnership::Heap);
+			std::unique_ptr<ASTNode> heapSimplified = simplifier.Simplify(std::unique_ptr<ASTNode>(parserTest.mParser.Parse("cos(x)+1.5cos(x)")));
+			REQUIRE(ASTNodeTreeViewer::PrintTree(simplifiedNode) == ASTNodeTreeViewer::PrintTree(heapSimplified.get()));
+			delete simplifiedNode;
+		}
+
+		SECTION("InvalidExpression")
+		{
+			ASTArenaTree arenaTree = parserTest.mParser.ParseToArena("(x]");
+			REQUIRE(!arenaTree);
+		}
+	}
+
+	TEST_CASE("BatchParseTest", "[BatchParseTest]")
+	{
+		ParserTest parserTest;
+		ASTWorkerPool pool(4);
+
+		std::vector<std::string> expressions;
+		for (int i = 0; i < 500; ++i)
+		{
+			expressions.push_back(i % 7 == 0 ? "(x]" : std::to_string(i) + "x+sin(pi)");
+		}
+		std::vector<std::string_view> views(expressions.begin(), expressions.end());
+
+		std::vector<ASTParser::ParsedExpression> results = parserTest.mParser.ParseBatch(views, pool);
+		REQUIRE(results.size() == expressions.size());
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			if (i % 7 == 0)
+			{
+				REQUIRE(!results[i]);
+				REQUIRE(results[i].mRoot == nullptr);
+				continue;
+			}
+
+			REQUIRE(results[i]);
+			ASTNode* expected = parserTest.mParser.Parse(expressions[i]);
+			REQUIRE(*results[i].mRoot == *expected);
+			delete expected;
+			delete results[i].mRoot;
+		}
+	}
+
+	TEST_CASE("ExpressionReaderTest", "[ExpressionReaderTest]")
+	{
+		ParserTest parserTest;
+		std::string path = (std::filesystem::temp_directory_path() / "ast_expression_reader_test.txt").string();
+
+		SECTION("Newline")
+		{
+			{
+				std::ofstream file(path, std::ios::binary);
+				file << "x+1\r\n\nsin(x)\n(x]\ny*2";
+			}
+
+			ASTExpressionReader reader(path);
+			std::vector<ASTExpressionReader::Record> records;
+			std::vector<bool> valid;
+			size_t count = reader.ParseAll(parserTest.mParser, [&](const ASTExpressionReader::Record& record, ASTParser::ParsedExpression& result)
+				{
+					records.push_back(record);
+					valid.push_back(static_cast<bool>(result));
+					delete result.mRoot;
+				}, 2);
+
+			REQUIRE(count == 4);
+			REQUIRE(records[0].mText == "x+1");
+			REQUIRE(records[0].mOffset == 0);
+			REQUIRE(records[1].mText == "sin(x)");
+			REQUIRE(records[1].mOffset == 6);
+			REQUIRE(records[2].mText == "(x]");
+			REQUIRE(records[2].mOffset == 13);
+			REQUIRE(records[3].mText == "y*2");
+			REQUIRE(records[3].mIndex == 3);
+			REQUIRE(valid == std::vector<bool>{ true, true, false, true });
+		}
+
+		SECTION("Null")
+		{
+			{
+				std::ofstream file(path, std::ios::binary);
+				file << std::string("x+1\0a\nb\0", 8);
+			}
+
+			ASTExpressionReader reader(path, ASTExpressionReader::Delimiter::Null);
+			ASTExpressionReader::Record record;
+			REQUIRE(reader.Next(record));
+			REQUIRE(record.mText == "x+1");
+			REQUIRE(reader.Next(record));
+			REQUIRE(record.mText == "a\nb");
+			REQUIRE(record.mOffset == 4);
+			REQUIRE(!reader.Next(record));
+		}
+
+		SECTION("Empty")
+		{
+			{
+				std::ofstream file(path, std::ios::binary);
+			}
+
+			ASTExpressionReader reader(path);
+			ASTExpressionReader::Record record;
+			REQUIRE(!reader.Next(record));
+		}
+
+		std::filesystem::remove(path);
+	}
+
+	TEST_CASE("TryParseTest", "[TryParseTest]")
+	{
+		ParserTest parserTest;
+		auto requireError = [&](const std::string& expression, const size_t pos, const ASTParser::ResultType type)
+			{
+				ASTParser::ParsedExpression parsed = parserTest.mParser.TryParse(expression);
+				REQUIRE(!parsed);
+				REQUIRE(parsed.mRoot == nullptr);
+				REQUIRE(parsed.mErrorPos == pos);
+				REQUIRE(parsed.mErrorType == type);
+			};
+
+		SECTION("Valid")
+		{
+			ASTParser::ParsedExpression parsed = parserTest.mParser.TryParse("(1+2)");
+			REQUIRE(parsed);
+			ASTNode* expected = parserTest.mParser.Parse("1+2");
+			REQUIRE(*parsed.mRoot == *expected);
+			delete expected;
+			delete parsed.mRoot;
+
+			parsed = parserTest.mParser.TryParse("2(x+1)sin(x)");
+			REQUIRE(parsed);
+			delete parsed.mRoot;
+		}
+
+		SECTION("Errors")
+		{
+			requireError("", 0, ASTParser::ResultType::EmptyExpression);
+			requireError("   ", 0, ASTParser::ResultType::EmptyExpression);
+			requireError("(x", 0, ASTParser::ResultType::InvalidParenthesis);
+			requireError("x)", 1, ASTParser::ResultType::InvalidParenthesis);
+			requireError("(x]", 2, ASTParser::ResultType::InvalidParenthesis);
+			requireError("x+", 1, ASTParser::ResultType::InvalidExpression);
+			requireError("1+sin", 2, ASTParser::ResultType::InvalidExpression);
+			requireError("x*99999999999999999999", 2, ASTParser::ResultType::InvalidNumberFormat);
+			REQUIRE(parserTest.mParser.Parse("x+") == nullptr);
+		}
+	}
+
+	TEST_CASE("SymbolInternerTest", "[SymbolInternerTest]")
+	{
+		ParserTest parserTest;
+		SymbolInterner& interner = SymbolInterner::GetDefault();
+
+		InternedSymbol x = interner.Intern("x");
+		REQUIRE(interner.Intern("x").mId == x.mId);
+		REQUIRE(interner.Intern("x").mSymbol == x.mSymbol);
+		REQUIRE(interner.GetSymbol(x.mId) == x.mSymbol);
+		REQUIRE(interner.Intern("y").mId != x.mId);
+		REQUIRE(interner.GetSize() > x.mId);
+
+		parserTest.mParser.RegisterCustomSymbol("speed");
+		ASTNode* node = parserTest.mParser.Parse("x*speed+x");
+		const OperatorNode* sum = dynamic_cast<const OperatorNode*>(node);
+		const OperatorNode* product = dynamic_cast<const OperatorNode*>(sum->mOperands[0]);
+		const VariableNode* first = dynamic_cast<const VariableNode*>(product->mOperands[0]);
+		const VariableNode* speed = dynamic_cast<const VariableNode*>(product->mOperands[1]);
+		const VariableNode* last = dynamic_cast<const VariableNode*>(sum->mOperands[1]);
+
+		REQUIRE(first->mId == x.mId);
+		REQUIRE(first->mVariable == last->mVariable);
+		REQUIRE(speed->mId == interner.Intern("speed").mId);
+		REQUIRE(*first == *last);
+		REQUIRE(*first != *speed);
+		Symbol xSymbol("x");
+		REQUIRE(*first == VariableNode(&xSymbol));
+		delete node;
+	}
+
+	TEST_CASE("ParseCacheTest", "[ParseCacheTest]")
+	{
+		ParserTest parserTest;
+		ASTParseCache cache(2, 1);
+
+		std::shared_ptr<const ASTNode> first = cache.Parse(parserTest.mParser, "x+1");
+		REQUIRE(first);
+		REQUIRE(cache.Parse(parserTest.mParser, "  x+1 ") == first);
+		REQUIRE(cache.GetStatistics().mHits == 1);
+		REQUIRE(cache.GetStatistics().mMisses == 1);
+
+		// spaces between tokens are significant
+		REQUIRE(cache.Parse(parserTest.mParser, "x +1") != first);
+
+		REQUIRE(cache.Parse(parserTest.mParser, "(x]") == nullptr);
+		REQUIRE(cache.GetSize() == 2);
+
+		cache.Parse(parserTest.mParser, "y");
+		REQUIRE(cache.GetStatistics().mEvictions == 1);
+		REQUIRE(cache.GetSize() == 2);
+
+		// a grammar change must not return trees parsed with the old one
+		std::shared_ptr<const ASTNode> beforeRegister = cache.Parse(parserTest.mParser, "y");
+		parserTest.mParser.RegisterCustomSymbol("y");
+		std::shared_ptr<const ASTNode> afterRegister = cache.Parse(parserTest.mParser, "y");
+		REQUIRE(afterRegister != beforeRegister);
+		REQUIRE(cache.GetStatistics().mMisses == 5);
+
+		// registries are keyed by id, not by an address a later registry can reuse
+		SymbolRegistry registry;
+		SymbolRegistry copy = registry;
+		REQUIRE(copy.GetInstanceId() != registry.GetInstanceId());
+		copy = registry;
+		REQUIRE(copy.GetInstanceId() != registry.GetInstanceId());
+
+		// a change through a copy leaves the original's grammar alone
+		copy.RegisterSymbol(std::make_shared<Symbol>("speed"));
+		auto any = [](const std::shared_ptr<Symbol>&) { return true; };
+		REQUIRE(copy.GetSymbol("speed", any));
+		REQUIRE(!registry.GetSymbol("speed", any));
+
+		cache.Clear();
+		REQUIRE(cache.GetSize() == 0);
+	}
+
+	TEST_CASE("IncrementalParseTest", "[IncrementalParseTest]")
+	{
+		ParserTest parserTest;
+		ASTIncrementalParser incremental(parserTest.mParser);
+
+		auto requireMatchesFullParse = [&]()
+			{
+				ASTNode* expected = parserTest.mParser.Parse(incremental.GetText());
+				REQUIRE(expected);
+				REQUIRE(incremental.GetRoot());
+				REQUIRE(*incremental.GetRoot() == *expected);
+				delete expected;
+			};
+
+		REQUIRE(incremental.Parse("2*(x+(y*3))+sin(z-1)"));
+		requireMatchesFullParse();
+
+		SECTION("InnerGroup")
+		{
+			// "(y*3)" -> "(y*34)"
+			REQUIRE(incremental.Edit(9, 0, "4"));
+			REQUIRE(incremental.GetText() == "2*(x+(y*34))+sin(z-1)");
+			REQUIRE(incremental.GetLastParsedLength() == 4);
+			requireMatchesFullParse();
+
+			// the groups after the edit moved with it: "(z-1)" -> "(z-1+w)"
+			REQUIRE(incremental.Edit(20, 0, "+w"));
+			REQUIRE(incremental.GetText() == "2*(x+(y*34))+sin(z-1+w)");
+			REQUIRE(incremental.GetLastParsedLength() == 5);
+			requireMatchesFullParse();
+
+			// "(x+(y*34))" -> "(x+(y*34)-(a))"
+			REQUIRE(incremental.Edit(11, 0, "-(a)"));
+			REQUIRE(incremental.GetLastParsedLength() == 12);
+			requireMatchesFullParse();
+
+			REQUIRE(incremental.Edit(13, 1, "b+c"));
+			REQUIRE(incremental.GetText() == "2*(x+(y*34)-(b+c))+sin(z-1+w)");
+			requireMatchesFullParse();
+		}
+
+		SECTION("TopLevel")
+		{
+			REQUIRE(incremental.Edit(0, 1, "5"));
+			REQUIRE(incremental.GetLastParsedLength() == incremental.GetText().size());
+			requireMatchesFullParse();
+		}
+
+		SECTION("InvalidEdit")
+		{
+			// removing a closing parenthesis invalidates the expression
+			REQUIRE(!incremental.Edit(10, 1, ""));
+			REQUIRE(incremental.GetRoot() == nullptr);
+			REQUIRE(incremental.GetErrorType() == ASTParser::ResultType::InvalidParenthesis);
+
+			REQUIRE(incremental.Edit(10, 0, ")"));
+			requireMatchesFullParse();
+			REQUIRE(incremental.Edit(6, 1, "q"));
+			REQUIRE(incremental.GetLastParsedLength() == 3);
+			requireMatchesFullParse();
+		}
+
+		SECTION("NestedParentheses")
+		{
+			REQUIRE(incremental.Parse("((x))*2"));
+			REQUIRE(incremental.Edit(2, 1, "y+1"));
+			REQUIRE(incremental.GetLastParsedLength() == 3);
+			requireMatchesFullParse();
+			REQUIRE(incremental.Edit(2, 0, "-"));
+			requireMatchesFullParse();
+		}
+	}
+
+	TEST_CASE("PostfixTest", "[PostfixTest]")
+	{
+		ParserTest parserTest;
+		ASTPostfix postfix;
+
+		SECTION("Order")
+		{
+			REQUIRE(parserTest.mParser.ParseToPostfix("1+2*x", postfix));
+			REQUIRE(postfix.mInstructions.size() == 5);
+			REQUIRE(postfix.mInstructions[0].mOpcode == PostfixOpcode::Rational);
+			REQUIRE(postfix.mInstructions[1].mOpcode == PostfixOpcode::Rational);
+			REQUIRE(postfix.mInstructions[2].mOpcode == PostfixOpcode::Variable);
+			REQUIRE(postfix.mInstructions[2].mSymbolId == SymbolInterner::GetDefault().Intern("x").mId);
+			REQUIRE(postfix.mInstructions[3].mOpcode == PostfixOpcode::Operator);
+			REQUIRE(postfix.mSymbols[postfix.mInstructions[3].mSymbolId]->mSymbol == "*");
+			REQUIRE(postfix.mSymbols[postfix.mInstructions[4].mSymbolId]->mSymbol == "+");
+			REQUIRE(postfix.mLiterals[postfix.mInstructions[1].mLiteralIndex] == Rational(2));
+		}
+
+		SECTION("SymbolTable")
+		{
+			// every symbol is stored once, so equal expressions give equal postfix
+			REQUIRE(parserTest.mParser.ParseToPostfix("pi*x + pi*x*pi", postfix));
+			REQUIRE(postfix.mSymbols.size() == 3);
+			ASTPostfix other;
+			REQUIRE(parserTest.mParser.ParseToPostfix("pi*x + pi*x*pi", other));
+			REQUIRE(other == postfix);
+			REQUIRE(parserTest.mParser.ParseToPostfix("pi*x + pi*x*e", other));
+			REQUIRE(other != postfix);
+		}
+
+		SECTION("ToTree")
+		{
+			for (const std::string expression : { "3--sinpi", "2(x+1)sin(y)", "-(a^2)!", "e*pi/4" })
+			{
+				REQUIRE(parserTest.mParser.ParseToPostfix(expression, postfix));
+				ASTNode* fromPostfix = postfix.ToTree();
+				ASTNode* expected = parserTest.mParser.Parse(expression);
+				REQUIRE(fromPostfix);
+				REQUIRE(*fromPostfix == *expected);
+				delete fromPostfix;
+				delete expected;
+			}
+		}
+
+		SECTION("InvalidExpression")
+		{
+			ASTParser::ParsedExpression parsed = parserTest.mParser.ParseToPostfix("(x]", postfix);
+			REQUIRE(!parsed);
+			REQUIRE(parsed.mErrorType == ASTParser::ResultType::InvalidParenthesis);
+			REQUIRE(postfix.mInstructions.empty());
+			REQUIRE(postfix.ToTree() == nullptr);
+		}
+	}
+
+	TEST_CASE("ParallelParseTest", "[ParallelParseTest]")
+	{
+		ParserTest parserTest;
+		ASTWorkerPool pool(4);
+
+		auto requireSameAsSequential = [&](const std::string& expression)
+			{
+				ASTParser::ParsedExpression parallel = parserTest.mParser.ParseParallel(expression, pool, 0);
+				ASTParser::ParsedExpression sequential = parserTest.mParser.TryParse(expression);
+				REQUIRE(parallel.mErrorType == sequential.mErrorType);
+				REQUIRE(parallel.mErrorPos == sequential.mErrorPos);
+				if (sequential)
+				{
+					REQUIRE(*parallel.mRoot == *sequential.mRoot);
+				}
+				delete parallel.mRoot;
+				delete sequential.mRoot;
+			};
+
+		SECTION("Small")
+		{
+			requireSameAsSequential("1+2");
+			requireSameAsSequential("x-2+y");
+			requireSameAsSequential("2*-x+3");
+			requireSameAsSequential("a+ +b-(c-d)");
+			requireSameAsSequential("-1-sin(x+1)^2");
+			requireSameAsSequential("(x+1]+2");
+			requireSameAsSequential("x+(y");
+			requireSameAsSequential("x+");
+		}
+
+		SECTION("Large")
+		{
+			const char* terms[] = { "3x^2", "sin(y+1)*2", "-(a-b)", "pi/4", "2*-z", "x-1", "(1+2)(3-4)", "e" };
+			std::string expression;
+			for (int i = 0; i < 5000; ++i)
+			{
+				if (i > 0)
+				{
+					expression += i % 3 ? "+" : " - ";
+				}
+				expression += terms[i % 8];
+			}
+			requireSameAsSequential(expression);
+		}
+	}
+
+	TEST_CASE("InputScanTest", "[InputScanTest]")
+	{
+		ParserTest parserTest;
+		ASTParser validating;
+		validating.mSettings.mPreValidateInput = true;
+
+		SECTION("SameAsUnvalidated")
+		{
+			const char* expressions[] = { "1+2", "(1+2)", "  x -  2 ", "sin(x+1)^2", "12345.678*y", "-(a-b)", "x+(y", "(x+1]+2" };
+			for (const char* expression : expressions)
+			{
+				INFO(expression);
+				ASTParser::ParsedExpression expected = parserTest.mParser.TryParse(expression);
+				ASTParser::ParsedExpression actual = validating.TryParse(expression);
+				REQUIRE(actual.mErrorType == expected.mErrorType);
+				REQUIRE(actual.mErrorPos == expected.mErrorPos);
+				if (expected)
+				{
+					REQUIRE(*actual.mRoot == *expected.mRoot);
+				}
+				delete expected.mRoot;
+				delete actual.mRoot;
+			}
+		}
+
+		SECTION("ControlCharacter")
+		{
+			ASTParser::ParsedExpression result = validating.TryParse("x+1\t+y");
+			REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidCharacter);
+			REQUIRE(result.mErrorPos == 3);
+		}
+
+		SECTION("Parentheses")
+		{
+			std::string expression(100, ' ');
+			expression += "((x+1)*2";
+			ASTParser::ParsedExpression result = validating.TryParse(expression);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidParenthesis);
+			REQUIRE(result.mErrorPos == 100);
+
+			result = validating.TryParse("(x+1]");
+			REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidParenthesis);
+			REQUIRE(result.mErrorPos == 4);
+
+			// reported at the stray parenthesis rather than at the operator missing an operand
+			result = validating.TryParse("1+)");
+			REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidParenthesis);
+			REQUIRE(result.mErrorPos == 2);
+		}
+
+		SECTION("LongLiteral")
+		{
+			std::string expression = "x*" + std::string(150, ' ') + "1" + std::string(150, '0') + ".5";
+			ASTParser::ParsedExpression expected = parserTest.mParser.TryParse(expression);
+			ASTParser::ParsedExpression actual = validating.TryParse(expression);
+			REQUIRE(actual.mErrorType == expected.mErrorType);
+			REQUIRE(actual.mErrorPos == expected.mErrorPos);
+			delete expected.mRoot;
+			delete actual.mRoot;
+
+			expression = std::string(70, ' ') + "123456789" + std::string(60, ' ');
+			actual = validating.TryParse(expression);
+			REQUIRE(actual);
+			REQUIRE(static_cast<RationalNode*>(actual.mRoot)->mValue == Rational(123456789));
+			delete actual.mRoot;
+		}
+	}
+
+	TEST_CASE("PrecedenceClimbingTest", "[PrecedenceClimbingTest]")
+	{
+		ParserTest parserTest;
+		ASTParserSettings settings;
+		settings.mEngine = ParserEngine::PrecedenceClimbing;
+		settings.mOperatorRegistry = OperatorRegistry::GetArgumentListRegistry();
+		ASTParser climbing(settings);
+
+		SECTION("SameAsShuntingYard")
+		{
+			const char* expressions[] = {
+				"1+2", "(1+2)", "x-2+y", "2*-x+3", "-1-sin(x+1)^2", "2x^2", "a+ +b-(c-d)", "3x(y+1)", "2^3^2", "-x^2",
+				"sin x + cos y", "(x)2", "pi/4e", "-x!", "2^x!", "[x+1]*{2}", "1/2/3",
+				"2^3^2^x", "x^-y^2", "2^3*4^5^6", "(2^3)^2", "2^x^y!", "-2^3^-x", "2^3 4^5",
+				"", "  ", "x+", "(x+1", "x+(y", "(x+1]+2", "1+)", "()", "(+)", "(", "x*99999999999999999999999999",
+			};
+			for (const char* expression : expressions)
+			{
+				INFO(expression);
+				ASTParser::ParsedExpression expected = parserTest.mParser.TryParse(expression);
+				ASTParser::ParsedExpression actual = climbing.TryParse(expression);
+				REQUIRE(actual.mErrorType == expected.mErrorType);
+				REQUIRE(actual.mErrorPos == expected.mErrorPos);
+				if (expected)
+				{
+					REQUIRE(*actual.mRoot == *expected.mRoot);
+				}
+				delete expected.mRoot;
+				delete actual.mRoot;
+			}
+		}
+
+		SECTION("RightAssociativity")
+		{
+			ASTNode* expected = parserTest.mParser.Parse("2^(3^2)");
+			ASTNode* leftGrouped = parserTest.mParser.Parse("(2^3)^2");
+			for (ASTParser* parser : { &parserTest.mParser, &climbing })
+			{
+				ASTNode* node = parser->Parse("2^3^2");
+				REQUIRE(node != nullptr);
+				REQUIRE(*node == *expected);
+				REQUIRE_FALSE(*node == *leftGrouped);
+				delete node;
+			}
+			delete expected;
+			delete leftGrouped;
+		}
+
+		SECTION("RecursionCap")
+		{
+			// without mMaxDepth deep nesting is refused before it exhausts the native stack
+			std::string expression(100000, '(');
+			expression += "x";
+			expression += std::string(100000, ')');
+			ASTParser::ParsedExpression result = climbing.TryParse(expression);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+
+			std::string powers = "x";
+			for (int i = 0; i < 100000; ++i)
+			{
+				powers += "^x";
+			}
+			result = climbing.TryParse(powers);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+
+			std::string nested = std::string(100, '(') + "x" + std::string(100, ')');
+			result = climbing.TryParse(nested);
+			REQUIRE(result);
+			delete result.mRoot;
+		}
+
+		SECTION("ArgumentLists")
+		{
+			ASTNode* node = climbing.Parse("sum(1, x, 2y) + max(1, min(2, 3))");
+			REQUIRE(node != nullptr);
+			OperatorNode* addition = static_cast<OperatorNode*>(node);
+			OperatorNode* sum = static_cast<OperatorNode*>(addition->mOperands[0]);
+			REQUIRE(sum->mOperator->mOperationId == OperationId::Sum);
+			REQUIRE(sum->mOperands.size() == 3);
+			OperatorNode* max = static_cast<OperatorNode*>(addition->mOperands[1]);
+			REQUIRE(max->mOperator->mOperationId == OperationId::Maximum);
+			REQUIRE(max->mOperands.size() == 2);
+			REQUIRE(static_cast<OperatorNode*>(max->mOperands[1])->mOperator->mOperationId == OperationId::Minimum);
+			delete node;
+
+			node = climbing.Parse("log(2, 8)^2");
+			REQUIRE(node != nullptr);
+			REQUIRE(static_cast<OperatorNode*>(node)->mOperator->mOperationId == OperationId::Exponentiation);
+			REQUIRE(static_cast<OperatorNode*>(static_cast<OperatorNode*>(node)->mOperands[0])->mOperands.size() == 2);
+			delete node;
+
+			// the shunting-yard engine has no argument lists
+			ASTParserSettings shuntingYardSettings;
+			shuntingYardSettings.mOperatorRegistry = OperatorRegistry::GetArgumentListRegistry();
+			ASTParser shuntingYard(shuntingYardSettings);
+			ASTParser::ParsedExpression result = shuntingYard.TryParse("sum(1, 2)");
+			REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidOperator);
+
+			// with the default registry their names are still implicit products of variables
+			const std::pair<const char*, const char*> implicitProducts[] = {
+				{ "min", "m*i*n" }, { "2max", "2*m*a*x" }, { "x*sum", "x*s*u*m" }, { "product", "p*r*o*d*u*c*t" }, { "a+max", "a+m*a*x" },
+			};
+			for (const auto& [expression, product] : implicitProducts)
+			{
+				ASTNode* actual = parserTest.mParser.Parse(expression);
+				ASTNode* expected = parserTest.mParser.Parse(product);
+				REQUIRE(actual);
+				REQUIRE(*actual == *expected);
+				delete actual;
+				delete expected;
+			}
+		}
+
+		SECTION("ArgumentListErrors")
+		{
+			auto requireError = [&](const char* expression, const ASTParser::ResultType type, const size_t pos)
+				{
+					ASTParser::ParsedExpression result = climbing.TryParse(expression);
+					REQUIRE(result.mErrorType == type);
+					REQUIRE(result.mErrorPos == pos);
+				};
+			requireError("log(2)", ASTParser::ResultType::InvalidExpression, 0);
+			requireError("sum 1", ASTParser::ResultType::InvalidExpression, 0);
+			requireError("sum()", ASTParser::ResultType::InvalidExpression, 4);
+			requireError("sum(1,)", ASTParser::ResultType::InvalidExpression, 6);
+			requireError("min(1, 2", ASTParser::ResultType::InvalidParenthesis, 3);
+			requireError("(x, y)", ASTParser::ResultType::InvalidExpression, 2);
+		}
+
+		SECTION("Arena")
+		{
+			ASTArenaTree tree = climbing.ParseToArena("max(x, 2) * -(y + 1)");
+			REQUIRE(tree);
+			ASTNode* expected = climbing.Parse("max(x, 2) * -(y + 1)");
+			REQUIRE(*tree.GetRoot() == *expected);
+			delete expected;
+
+			REQUIRE_FALSE(climbing.ParseToArena("max(x, 2) * -(y + "));
+		}
+	}
+
+	TEST_CASE("ParserEngineBenchmark", "[.benchmark]")
+	{
+		std::string expression;
+		const char* terms[] = { "3x^2", "sin(y+1)*2", "-(a-b)", "pi/4", "2*-z", "x-1", "(1+2)(3-4)", "e" };
+		for (int i = 0; i < 20000; ++i)
+		{
+			expression += i > 0 ? "+" : "";
+			expression += terms[i % 8];
+		}
+
+		ASTParser shuntingYard;
+		ASTParserSettings settings;
+		settings.mEngine = ParserEngine::PrecedenceClimbing;
+		ASTParser climbing(settings);
+
+		BENCHMARK("ShuntingYard")
+		{
+			delete shuntingYard.Parse(expression);
+		}
+		BENCHMARK("PrecedenceClimbing")
+		{
+			delete climbing.Parse(expression);
+		}
+	}
+
+	TEST_CASE("ConstantFoldingTest", "[ConstantFoldingTest]")
+	{
+		ASTParserSettings settings;
+		settings.mFoldConstants = true;
+		ASTParser parser(settings);
+
+		SECTION("CheckedArithmetic")
+		{
+			Rational value;
+			REQUIRE(Rational(1, 3).TryAdd(Rational(1, 6), value));
+			REQUIRE(value == Rational(1, 2));
+			REQUIRE(Rational(1, 3).TrySubtract(Rational(1, 2), value));
+			REQUIRE(value == Rational(-1, 6));
+			REQUIRE(Rational(2, 3).TryDivide(Rational(4, 9), value));
+			REQUIRE(value == Rational(3, 2));
+			REQUIRE_FALSE(Rational(2147483647).TryMultiply(Rational(2), value));
+			REQUIRE_FALSE(Rational(1).TryDivide(Rational(0), value));
+		}
+
+		SECTION("Fold")
+		{
+			ASTNode* node = parser.Parse("3*1024*1024");
+			REQUIRE(node->mType == ASTNode::NodeType::Rational);
+			REQUIRE(static_cast<RationalNode*>(node)->mValue == Rational(3 * 1024 * 1024));
+			delete node;
+
+			node = parser.Parse("(1/3 + 1/6) * 4");
+			REQUIRE(node->mType == ASTNode::NodeType::Rational);
+			REQUIRE(static_cast<RationalNode*>(node)->mValue == Rational(2));
+			delete node;
+
+			node = parser.Parse("x + 2*3");
+			OperatorNode* addition = static_cast<OperatorNode*>(node);
+			REQUIRE(addition->mOperands[1]->mType == ASTNode::NodeType::Rational);
+			REQUIRE(static_cast<RationalNode*>(addition->mOperands[1])->mValue == Rational(6));
+			delete node;
+		}
+
+		SECTION("NotFolded")
+		{
+			const char* expressions[] = { "1/0", "2147483647*2", "2^3", "x*2*3" };
+			ASTParser plain;
+			for (const char* expression : expressions)
+			{
+				ASTNode* folded = parser.Parse(expression);
+				ASTNode* expected = plain.Parse(expression);
+				REQUIRE(*folded == *expected);
+				delete folded;
+				delete expected;
+			}
+		}
+
+		SECTION("AllModes")
+		{
+			ASTParserSettings climbingSettings = settings;
+			climbingSettings.mEngine = ParserEngine::PrecedenceClimbing;
+			ASTParser climbing(climbingSettings);
+			ASTWorkerPool pool(2);
+
+			const char* expressions[] = { "3*1024*1024", "1 + 2 + x + 3 * 4", "2 * (3 - 1/2) + y" };
+			for (const char* expression : expressions)
+			{
+				ASTNode* expected = parser.Parse(expression);
+
+				ASTNode* actual = climbing.Parse(expression);
+				REQUIRE(*actual == *expected);
+				delete actual;
+
+				ASTPostfix postfix;
+				REQUIRE(parser.ParseToPostfix(expression, postfix));
+				actual = postfix.ToTree();
+				REQUIRE(*actual == *expected);
+				delete actual;
+
+				ASTParser::ParsedExpression parallel = parser.ParseParallel(expression, pool, 0);
+				REQUIRE(*parallel.mRoot == *expected);
+				delete parallel.mRoot;
+
+				delete expected;
+			}
+
+			ASTPostfix postfix;
+			parser.ParseToPostfix("3*1024*1024", postfix);
+			REQUIRE(postfix.mInstructions.size() == 1);
+		}
+	}
+
+	TEST_CASE("ParseAndSimplifyTest", "[ParseAndSimplifyTest]")
+	{
+		ParserTest parserTest;
+		const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+
+		const char* expressions[] = {
+			"0+x", "1+2+x", "sin(x)+-sin(x)", "cos(x)+1.5cos(x)", "1.5cos(x)+cos(x)+1.5cos(x)", "(2-1)*x+0", "3*4-2*y",
+		};
+		for (const char* expression : expressions)
+		{
+			ASTNode* parsed = parserTest.mParser.Parse(expression);
+			ASTNode* expected = simplifier.Simplify(parsed);
+
+			ASTParser::ParsedExpression fused = parserTest.mParser.ParseAndSimplify(expression, simplifier);
+			REQUIRE(fused);
+			REQUIRE(*fused.mRoot == *expected);
+
+			delete parsed;
+			delete expected;
+			delete fused.mRoot;
+		}
+
+		ASTParser::ParsedExpression result = parserTest.mParser.ParseAndSimplify("1+(x", simplifier);
+		REQUIRE(result.mErrorType == ASTParser::ResultType::InvalidParenthesis);
+		REQUIRE(result.mErrorPos == 2);
+		REQUIRE(result.mRoot == nullptr);
+	}
+
+	TEST_CASE("ProgramTest", "[ProgramTest]")
+	{
+		ParserTest parserTest;
+
+		SECTION("SharedBindings")
+		{
+			ASTParser::ParsedProgram program = parserTest.mParser.ParseProgram("a = x + 1; b = a*a + a; b");
+			REQUIRE(program);
+
+			ASTNode* expected = parserTest.mParser.Parse("(x + 1)*(x + 1) + (x + 1)");
+			REQUIRE(*program.mTree == *expected);
+			delete expected;
+
+			// x, 1, a, a*a and the root
+			REQUIRE(program.mTree.GetArena()->GetNodeCount() == 5);
+			const OperatorNode* root = static_cast<const OperatorNode*>(program.mTree.GetRoot());
+			const OperatorNode* square = static_cast<const OperatorNode*>(root->mOperands[0]);
+			REQUIRE(square->mOperands[0] == square->mOperands[1]);
+			REQUIRE(square->mOperands[0] == root->mOperands[1]);
+
+			// a name bound again refers to its new subtree
+			ASTParser::ParsedProgram rebound = parserTest.mParser.ParseProgram("a = x; b = a + 1; a = y; a*b");
+			REQUIRE(rebound);
+			expected = parserTest.mParser.Parse("y*(x + 1)");
+			REQUIRE(*rebound.mTree == *expected);
+			delete expected;
+		}
+
+		SECTION("BothEngines")
+		{
+			ASTParserSettings settings;
+			settings.mEngine = ParserEngine::PrecedenceClimbing;
+			settings.mOperatorRegistry = OperatorRegistry::GetArgumentListRegistry();
+			settings.mFoldConstants = true;
+			ASTParser climbing(settings);
+
+			ASTParser::ParsedProgram program = climbing.ParseProgram("a = 2; b = sum(a, 3*a, y); a*3 + b;");
+			REQUIRE(program);
+			ASTNode* expected = climbing.Parse("6 + sum(2, 6, y)");
+			REQUIRE(*program.mTree == *expected);
+			delete expected;
+		}
+
+		SECTION("Errors")
+		{
+			auto requireError = [&](const char* text, const ASTParser::ResultType type, const size_t pos)
+				{
+					ASTParser::ParsedProgram program = parserTest.mParser.ParseProgram(text);
+					REQUIRE(program.mErrorType == type);
+					REQUIRE(program.mErrorPos == pos);
+					REQUIRE_FALSE(program.mTree);
+				};
+			requireError("a = 1; a + (2", ASTParser::ResultType::InvalidParenthesis, 11);
+			requireError("a = 1; b = 2", ASTParser::ResultType::EmptyExpression, 12);
+			requireError("a + 1; a", ASTParser::ResultType::InvalidExpression, 5);
+			requireError(" pi = 3; pi", ASTParser::ResultType::InvalidExpression, 1);
+			requireError("ab = 3; ab", ASTParser::ResultType::InvalidExpression, 0);
+		}
+
+		SECTION("SimplifyShared")
+		{
+			ASTParser::ParsedProgram program = parserTest.mParser.ParseProgram("a = cos(x) + 1.5cos(x); b = a + 2*3; b*b");
+			REQUIRE(program);
+
+			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+			ASTArenaTree simplified = simplifier.SimplifyShared(program.mTree);
+			REQUIRE(simplified);
+
+			ASTNode* tree = parserTest.mParser.Parse("(cos(x) + 1.5cos(x) + 2*3)*(cos(x) + 1.5cos(x) + 2*3)");
+			ASTNode* expected = simplifier.Simplify(tree);
+			REQUIRE(*simplified == *expected);
+			delete tree;
+			delete expected;
+
+			const OperatorNode* root = static_cast<const OperatorNode*>(simplified.GetRoot());
+			REQUIRE(root->mOperands[0] == root->mOperands[1]);
+		}
+	}
+
+	TEST_CASE("IngestTest", "[IngestTest]")
+	{
+		ASTParserSettings settings;
+		settings.mEngine = ParserEngine::PrecedenceClimbing;
+		settings.mOperatorRegistry = OperatorRegistry::GetArgumentListRegistry();
+		ASTParser parser(settings);
+
+		SECTION("RoundTrip")
+		{
+			for (const char* expression : { "x", "-1/2", "pi*(x + y)^2", "sin(x)/root(y, 3) - e", "sum(x, 2, max(y, pi, 1/3))*4!" })
+			{
+				ASTNode* expected = parser.Parse(expression);
+				REQUIRE(expected);
+
+				for (const IngestOrder order : { IngestOrder::Prefix, IngestOrder::Postfix })
+				{
+					std::string text;
+					REQUIRE(WriteIngestText(expected, order, text));
+					ASTParser::ParsedExpression ingested = parser.IngestText(text, order);
+					REQUIRE(ingested);
+					REQUIRE(*ingested.mRoot == *expected);
+					delete ingested.mRoot;
+				}
+
+				std::string data;
+				REQUIRE(WriteIngestBinary(expected, data));
+				ASTParser::ParsedExpression ingested = parser.IngestBinary(data);
+				REQUIRE(ingested);
+				REQUIRE(*ingested.mRoot == *expected);
+				delete ingested.mRoot;
+				delete expected;
+			}
+		}
+
+		SECTION("Text")
+		{
+			ASTNode* expected = parser.Parse("x + 0.5");
+			ASTParser::ParsedExpression ingested = parser.IngestText("  @1  $x\t1/2\n", IngestOrder::Prefix);
+			REQUIRE(ingested);
+			REQUIRE(*ingested.mRoot == *expected);
+			delete ingested.mRoot;
+			delete expected;
+		}
+
+		SECTION("Errors")
+		{
+			auto requireError = [&](std::string_view text, const IngestOrder order, const ASTParser::ResultType type, const size_t pos)
+				{
+					ASTParser::ParsedExpression ingested = parser.IngestText(text, order);
+					REQUIRE(!ingested.mRoot);
+					REQUIRE(ingested.mErrorType == type);
+					REQUIRE(ingested.mErrorPos == pos);
+				};
+
+			requireError("", IngestOrder::Postfix, ASTParser::ResultType::EmptyExpression, 0);
+			requireError("$x @1", IngestOrder::Postfix, ASTParser::ResultType::InvalidExpression, 3);
+			requireError("$x $y", IngestOrder::Postfix, ASTParser::ResultType::InvalidExpression, 5);
+			requireError("$x 1/0 @1", IngestOrder::Postfix, ASTParser::ResultType::InvalidNumberFormat, 3);
+			requireError("$x $y @200", IngestOrder::Postfix, ASTParser::ResultType::InvalidOperator, 6);
+			requireError("$x @23", IngestOrder::Postfix, ASTParser::ResultType::InvalidExpression, 3);
+			requireError("$x $y @1:3", IngestOrder::Postfix, ASTParser::ResultType::InvalidExpression, 6);
+			requireError("@1 $x x", IngestOrder::Prefix, ASTParser::ResultType::InvalidCharacter, 6);
+
+			// fractions are reduced without overflowing, those outside the int range are rejected
+			requireError("-2147483648/-1", IngestOrder::Postfix, ASTParser::ResultType::InvalidNumberFormat, 0);
+			requireError("1/-2147483648", IngestOrder::Postfix, ASTParser::ResultType::InvalidNumberFormat, 0);
+			requireError("-2147483648", IngestOrder::Postfix, ASTParser::ResultType::InvalidNumberFormat, 0);
+			ASTParser::ParsedExpression reduced = parser.IngestText("6/-4", IngestOrder::Postfix);
+			REQUIRE(reduced);
+			REQUIRE(static_cast<RationalNode*>(reduced.mRoot)->mValue == Rational(-3, 2));
+			delete reduced.mRoot;
+
+			const RationalNode rational(Rational(1));
+			for (const auto& fraction : { std::make_pair(0x80000000u, 0xFFFFFFFFu), std::make_pair(1u, 0x80000000u), std::make_pair(1u, 0u) })
+			{
+				std::string record;
+				REQUIRE(WriteIngestBinary(&rational, record));
+				for (size_t i = 0; i < 4; ++i)
+				{
+					record[1 + i] = static_cast<char>((fraction.first >> (8 * i)) & 0xFF);
+					record[5 + i] = static_cast<char>((fraction.second >> (8 * i)) & 0xFF);
+				}
+				ASTParser::ParsedExpression ingested = parser.IngestBinary(record);
+				REQUIRE(!ingested.mRoot);
+				REQUIRE(ingested.mErrorType == ASTParser::ResultType::InvalidNumberFormat);
+			}
+
+			// a record cut short
+			std::string data;
+			ASTNode* node = parser.Parse("x*2");
+			REQUIRE(WriteIngestBinary(node, data));
+			delete node;
+			ASTParser::ParsedExpression ingested = parser.IngestBinary(std::string_view(data).substr(0, data.size() - 1));
+			REQUIRE(!ingested.mRoot);
+			REQUIRE(ingested.mErrorType == ASTParser::ResultType::InvalidExpression);
+		}
+	}
+
+	TEST_CASE("SourceSpanTest", "[SourceSpanTest]")
+	{
+		auto requireSpan = [](const ASTSourceSpans& spans, const ASTNode* node, const size_t begin, const size_t end)
+			{
+				const SourceSpan* span = spans.Find(node);
+				REQUIRE(span);
+				REQUIRE(span->mBegin == begin);
+				REQUIRE(span->mEnd == end);
+			};
+
+		for (const ParserEngine engine : { ParserEngine::ShuntingYard, ParserEngine::PrecedenceClimbing })
+		{
+			ASTParserSettings settings;
+			settings.mEngine = engine;
+			ASTParser parser(settings);
+
+			ASTSourceSpans spans;
+			ASTParser::ParsedExpression parsed = parser.ParseWithSpans("2*( x + y) - pi", spans);
+			REQUIRE(parsed);
+
+			const OperatorNode* root = static_cast<const OperatorNode*>(parsed.mRoot);
+			const OperatorNode* product = static_cast<const OperatorNode*>(root->mOperands[0]);
+			const OperatorNode* sum = static_cast<const OperatorNode*>(product->mOperands[1]);
+			requireSpan(spans, root, 0, 15);
+			requireSpan(spans, product, 0, 10);
+			requireSpan(spans, product->mOperands[0], 0, 1);
+			requireSpan(spans, sum, 2, 10);
+			requireSpan(spans, sum->mOperands[0], 4, 5);
+			requireSpan(spans, sum->mOperands[1], 8, 9);
+			requireSpan(spans, root->mOperands[1], 13, 15);
+			delete parsed.mRoot;
+		}
+
+		SECTION("Simplified")
+		{
+			ParserTest parserTest;
+			ASTSourceSpans spans;
+			ASTParser::ParsedExpression parsed = parserTest.mParser.ParseWithSpans("sin(x + x) + y", spans);
+			REQUIRE(parsed);
+
+			// a rule builds 2*x, the sine is cloned
+			ASTNode* simplified = ASTSimplifier::GetDefault().Simplify(parsed.mRoot, spans);
+			const OperatorNode* root = static_cast<const OperatorNode*>(simplified);
+			const OperatorNode* sine = static_cast<const OperatorNode*>(root->mOperands[0]);
+			REQUIRE(sine->mOperands[0]->mType == ASTNode::NodeType::Operator);
+			const OperatorNode* product = static_cast<const OperatorNode*>(sine->mOperands[0]);
+			requireSpan(spans, root, 0, 14);
+			requireSpan(spans, sine, 0, 10);
+			requireSpan(spans, product, 3, 10);
+			requireSpan(spans, product->mOperands[0], 3, 10);
+			requireSpan(spans, root->mOperands[1], 13, 14);
+			delete simplified;
+			delete parsed.mRoot;
+
+			// nodes of other parses have no span
+			ASTNode* plain = parserTest.mParser.Parse("x");
+			REQUIRE(!spans.Find(plain));
+			delete plain;
+		}
+	}
+
+	TEST_CASE("ResourceLimitTest", "[ResourceLimitTest]")
+	{
+		auto repeat = [](const std::string& text, const size_t count)
+			{
+				std::string result;
+				for (size_t i = 0; i < count; ++i)
+				{
+					result += text;
+				}
+				return result;
+			};
+
+		for (const ParserEngine engine : { ParserEngine::ShuntingYard, ParserEngine::PrecedenceClimbing })
+		{
+			ASTParserSettings settings;
+			settings.mEngine = engine;
+			settings.mMaxInputLength = 4096;
+			settings.mMaxNodeCount = 64;
+			settings.mMaxDepth = 8;
+			ASTParser parser(settings);
+
+			auto requireLimit = [&](const std::string& expression)
+				{
+					ASTParser::ParsedExpression parsed = parser.TryParse(expression);
+					REQUIRE(!parsed.mRoot);
+					REQUIRE(parsed.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+				};
+
+			// within every limit: 8 levels deep
+			ASTParser::ParsedExpression parsed = parser.TryParse("sin(cos(tan(x^2 + y*z)^(2)))*pi");
+			REQUIRE(parsed);
+			delete parsed.mRoot;
+
+			requireLimit(std::string(4097, ' '));
+			requireLimit("x" + repeat(" + x", 8));
+			requireLimit("x" + repeat(" + x", 100000));
+
+			settings.mMaxDepth = 0;
+			ASTParser counting(settings);
+			parsed = counting.TryParse(repeat("x*", 31) + "x");
+			REQUIRE(parsed);
+			delete parsed.mRoot;
+			parsed = counting.TryParse(repeat("x*", 33) + "x");
+			REQUIRE(parsed.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+			requireLimit(repeat("(", 9) + "x" + repeat(")", 9));
+			requireLimit(repeat("(", 100000) + "x");
+			requireLimit(repeat("sin(", 8) + "x" + repeat(")", 8));
+			requireLimit(repeat("x^(", 8) + "x" + repeat(")", 8));
+
+			ASTParser::ParsedProgram program = parser.ParseProgram("a = x*x*x*x; b = a*a*a*a*a; a + b");
+			REQUIRE(program.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+
+			std::ostringstream message;
+			message << ASTParser::ParseResult(program.mErrorPos, program.mErrorType);
+			REQUIRE(message.str() == "Error at position " + std::to_string(program.mErrorPos) + ": Resource limit exceeded");
+		}
+
+		SECTION("Ingest")
+		{
+			ASTParserSettings settings;
+			settings.mMaxDepth = 8;
+			ASTParser parser(settings);
+			ASTParser::ParsedExpression ingested = parser.IngestText(repeat("@10 ", 100000) + "$x", IngestOrder::Prefix);
+			REQUIRE(ingested.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+		}
+
+		SECTION("Simplifier")
+		{
+			ParserTest parserTest;
+			ASTNode* node = parserTest.mParser.Parse("x*0 + y*1 + (x + y)*(x + 0)");
+			REQUIRE(node);
+
+			ASTSimplifierSettings settings;
+			settings.mMaxDepth = 3;
+			REQUIRE(!ASTSimplifier(settings).Simplify(node));
+			settings.mMaxDepth = 4;
+			ASTNode* simplified = ASTSimplifier(settings).Simplify(node);
+			REQUIRE(simplified);
+			delete simplified;
+
+			settings.mMaxSteps = 4;
+			REQUIRE(!ASTSimplifier(settings).Simplify(node));
+			delete node;
+
+			// x+x takes the like term rule and the addition and multiplication it simplifies on its own
+			node = parserTest.mParser.Parse("x+x");
+			settings.mMaxDepth = 0;
+			settings.mMaxSteps = 2;
+			REQUIRE(!ASTSimplifier(settings).Simplify(node));
+			REQUIRE(!ASTSimplifier(settings).Simplify(std::unique_ptr<ASTNode>(node->Clone())));
+			settings.mMaxSteps = 3;
+			simplified = ASTSimplifier(settings).Simplify(node);
+			REQUIRE(simplified);
+			delete simplified;
+			delete node;
+		}
+
+		SECTION("ParseAndSimplify")
+		{
+			ParserTest parserTest;
+			ASTSimplifierSettings settings;
+			settings.mMaxSteps = 2;
+			const ASTSimplifier limited(settings);
+
+			ASTParser::ParsedExpression result = parserTest.mParser.ParseAndSimplify("x+x", limited);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+			REQUIRE(result.mErrorPos == 1);
+			REQUIRE(!result.mRoot);
+
+			// the steps add up over the operators of the expression
+			result = parserTest.mParser.ParseAndSimplify("x*1+y*1", limited);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+			REQUIRE(result.mErrorPos == 3);
+
+			ASTParserSettings climbingSettings;
+			climbingSettings.mEngine = ParserEngine::PrecedenceClimbing;
+			result = ASTParser(climbingSettings).ParseAndSimplify("x*1+y*1", limited);
+			REQUIRE(result.mErrorType == ASTParser::ResultType::ResourceLimitExceeded);
+			REQUIRE(result.mErrorPos == 3);
+
+			result = parserTest.mParser.ParseAndSimplify("x*1+y", limited);
+			REQUIRE(result);
+			delete result.mRoot;
+		}
+	}
+
+	TEST_CASE("DefaultRegistryTest", "[DefaultRegistryTest]")
+	{
+		const OperatorRegistry* operators = OperatorRegistry::GetDefaultRegistry();
+		REQUIRE(operators->GetOperator(OperationId::Multiplication)->mSymbol == "*");
+		REQUIRE(operators->GetOperator(OperationId::Maximum) == nullptr);
+		REQUIRE(OperatorRegistry::GetArgumentListRegistry()->GetOperator(OperationId::Maximum)->mType == OperatorType::FunctionMultiple);
+
+		ASTParserSettings settings;
+		REQUIRE(settings.mCustomSymbolRegistry == nullptr);
+		REQUIRE(settings.mImplicitOperator == operators->GetOperator(OperationId::Multiplication));
+
+		for (const char* pair : { "()", "[]", "{}" })
+		{
+			std::shared_ptr<Parenthesis> open = std::dynamic_pointer_cast<Parenthesis>(
+				ParenthesisRegistry::GetDefaultRegistry()->GetSymbol(std::string(1, pair[0]), [](const std::shared_ptr<Symbol>&) { return true; }));
+			REQUIRE(open->mIsOpen);
+			REQUIRE(open->mOpposite->mSymbol == std::string(1, pair[1]));
+			REQUIRE(open->mOpposite->mOpposite == open.get());
+		}
+
+		// custom symbols stay with the parser that registered them
+		ASTParser first;
+		ASTParser second;
+		first.RegisterCustomSymbol("speed");
+		ASTNode* custom = first.Parse("speed");
+		ASTNode* implicit = second.Parse("speed");
+		REQUIRE(custom->mType == ASTNode::NodeType::Variable);
+		REQUIRE(implicit->mType == ASTNode::NodeType::Operator);
+		delete custom;
+		delete implicit;
+
+		// every operation has its own rational rule
+		ASTNode* sum = first.Parse("1+2");
+		ASTNode* simplified = ASTSimplifier::GetDefault().Simplify(sum);
+		REQUIRE(simplified->mType == ASTNode::NodeType::Rational);
+		REQUIRE(dynamic_cast<RationalNode*>(simplified)->mValue == Rational(3));
+		delete sum;
+		delete simplified;
+	}
+
+	TEST_CASE("ASTBufferTest", "[ASTBufferTest]")
+	{
+		// function arguments need the precedence climbing engine
+		ASTParserSettings settings;
+		settings.mEngine = ParserEngine::PrecedenceClimbing;
+		settings.mOperatorRegistry = OperatorRegistry::GetArgumentListRegistry();
+		ASTParser parser(settings);
+
+		SECTION("RoundTrip")
+		{
+			for (const char* expression : { "x", "3.5", "pi", "sin(x)^2+cos(x)^2", "max(1, y, z*2, -x)", "root(2, x)*y!" })
+			{
+				ASTNode* tree = parser.Parse(expression);
+				ASTBuffer buffer = ASTBuffer::FromTree(tree);
+				REQUIRE(buffer.GetType(buffer.GetRoot()) == tree->mType);
+
+				ASTNode* copy = buffer.ToTree();
+				REQUIRE(*copy == *tree);
+				REQUIRE(ASTBuffer::FromTree(copy) == buffer);
+				REQUIRE(ASTNodeTreeViewer::PrintTree(buffer) == ASTNodeTreeViewer::PrintTree(tree));
+				delete copy;
+				delete tree;
+			}
+			REQUIRE(ASTBuffer().ToTree() == nullptr);
+		}
+
+		SECTION("Layout")
+		{
+			ASTNode* tree = parser.Parse("max(1, y, z*2)");
+			ASTBuffer buffer = ASTBuffer::FromTree(tree);
+			delete tree;
+
+			// operands come before their operator, the root is last
+			REQUIRE(buffer.GetSize() == 6);
+			ASTBuffer::NodeIndex root = buffer.GetRoot();
+			REQUIRE(buffer.GetOperationId(root) == OperationId::Maximum);
+			REQUIRE(buffer.GetOperandCount(root) == 3);
+			for (size_t i = 0; i < buffer.GetOperandCount(root); ++i)
+			{
+				REQUIRE(buffer.GetOperand(root, i) < root);
+			}
+			REQUIRE(buffer.GetRational(buffer.GetOperand(root, 0)) == Rational(1));
+			REQUIRE(buffer.GetVariable(buffer.GetOperand(root, 1)).mSymbol->mSymbol == "y");
+			REQUIRE(buffer.GetOperationId(buffer.GetOperand(root, 2)) == OperationId::Multiplication);
+		}
+
+		SECTION("Compare")
+		{
+			ASTNode* left = parser.Parse("x*y+1.5");
+			ASTNode* right = parser.Parse("x*y+2.5");
+			ASTBuffer leftBuffer = ASTBuffer::FromTree(left);
+			ASTBuffer rightBuffer = ASTBuffer::FromTree(right);
+			REQUIRE(leftBuffer != rightBuffer);
+			REQUIRE(leftBuffer.Equals(leftBuffer.GetOperand(leftBuffer.GetRoot(), 0), rightBuffer, rightBuffer.GetOperand(rightBuffer.GetRoot(), 0)));
+			REQUIRE(leftBuffer != ASTBuffer());
+			REQUIRE(ASTBuffer() == ASTBuffer());
+			delete left;
+			delete right;
+		}
+
+		SECTION("Simplify")
+		{
+			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+			for (const char* expression : { "sin(x + x) + y", "1+2", "max(x, 2*3)", "-(y + y)" })
+			{
+				ASTNode* tree = parser.Parse(expression);
+				ASTNode* simplifiedTree = simplifier.Simplify(tree);
+				ASTBuffer simplifiedBuffer = simplifier.Simplify(ASTBuffer::FromTree(tree));
+				REQUIRE(simplifiedBuffer == ASTBuffer::FromTree(simplifiedTree));
+				REQUIRE(simplifiedBuffer.GetSize() == ASTBuffer::FromTree(simplifiedTree).GetSize());
+				delete tree;
+				delete simplifiedTree;
+			}
+
+			ASTSimplifierSettings limits;
+			limits.mMaxDepth = 3;
+			ASTSimplifier limited(limits);
+			ASTNode* tree = parser.Parse("sin(cos(x))");
+			REQUIRE(!limited.Simplify(ASTBuffer::FromTree(tree)).IsEmpty());
+			delete tree;
+			tree = parser.Parse("sin(cos(tan(x)))");
+			REQUIRE(limited.Simplify(ASTBuffer::FromTree(tree)).IsEmpty());
+			delete tree;
+		}
+	}
+
+	TEST_CASE("StructuralHashTest", "[StructuralHashTest]")
+	{
+		ParserTest parserTest;
+
+		SECTION("EqualTreesHashEqual")
+		{
+			ASTNode* left = parserTest.mParser.Parse("sin(x)^2 + 1.5*y");
+			ASTNode* right = parserTest.mParser.Parse("sin(x)^2 + 1.5*y");
+			ASTNode* other = parserTest.mParser.Parse("sin(x)^2 + 1.5*z");
+			REQUIRE(left->GetHash() == right->GetHash());
+			REQUIRE(left->GetHash() != other->GetHash());
+			REQUIRE(*left == *right);
+			REQUIRE(*left != *other);
+
+			ASTNode* copy = left->Clone();
+			REQUIRE(copy->GetHash() == left->GetHash());
+			delete copy;
+			delete left;
+			delete right;
+			delete other;
+		}
+
+		SECTION("OperandOrder")
+		{
+			ASTNode* left = parserTest.mParser.Parse("x-y");
+			ASTNode* right = parserTest.mParser.Parse("y-x");
+			REQUIRE(left->GetHash() != right->GetHash());
+			REQUIRE(*left != *right);
+			delete left;
+			delete right;
+		}
+
+		SECTION("InvalidateHash")
+		{
+			ASTNode* tree = parserTest.mParser.Parse("x*y");
+			ASTNode* expected = parserTest.mParser.Parse("x*z");
+			const uint64_t hash = tree->GetHash();
+
+			OperatorNode* product = static_cast<OperatorNode*>(tree);
+			delete product->mOperands[1];
+			product->mOperands[1] = parserTest.mParser.Parse("z");
+			REQUIRE(tree->GetHash() == hash);
+			tree->InvalidateHash();
+			REQUIRE(tree->GetHash() == expected->GetHash());
+			REQUIRE(*tree == *expected);
+			delete tree;
+			delete expected;
+		}
+
+		SECTION("UnorderedMapKey")
+		{
+			std::vector<ASTNode*> trees;
+			for (const char* expression : { "x+1", "sin(y)", "x+1", "2*sin(y)", "sin(y)", "x+1" })
+			{
+				trees.push_back(parserTest.mParser.Parse(expression));
+			}
+
+			std::unordered_map<const ASTNode*, size_t, ASTNodeHash, ASTNodeEqual> counts;
+			for (const ASTNode* tree : trees)
+			{
+				++counts[tree];
+			}
+			REQUIRE(counts.size() == 3);
+			REQUIRE(counts[trees[0]] == 3);
+			REQUIRE(counts[trees[1]] == 2);
+			REQUIRE(counts[trees[3]] == 1);
+
+			for (ASTNode* tree : trees)
+			{
+				delete tree;
+			}
+		}
+	}
+
+	TEST_CASE("VisitTest", "[VisitTest]")
+	{
+		ParserTest parserTest;
+		ASTNode* tree = parserTest.mParser.Parse("sin(x)*2.5+pi");
+
+		// counts the nodes of each type without a cast
+		std::function<void(const ASTNode*)> count;
+		size_t operators = 0;
+		size_t leaves = 0;
+		count = [&](const ASTNode* node)
+			{
+				Visit(node, Overloaded{
+					[&](const OperatorNode* opNode)
+					{
+						++operators;
+						for (const ASTNode* operand : opNode->mOperands)
+						{
+							count(operand);
+						}
+					},
+					[&](const auto*) { ++leaves; },
+					});
+			};
+		count(tree);
+		REQUIRE(operators == 3);
+		REQUIRE(leaves == 3);
+
+		const std::string name = Visit(static_cast<const ASTNode*>(tree), Overloaded{
+			[](const OperatorNode* opNode) { return opNode->mOperator->mSymbol; },
+			[](const ASTNode*) { return std::string(); },
+			});
+		REQUIRE(name == "+");
+
+		// the mutating form hands out non-const nodes
+		OperatorNode* sum = NodeCast<OperatorNode>(tree);
+		REQUIRE(sum);
+		REQUIRE(!NodeCast<RationalNode>(tree));
+		ASTNode* product = sum->mOperands[0];
+		Visit(NodeCast<OperatorNode>(product)->mOperands[1], Overloaded{
+			[](RationalNode* rationalNode) { rationalNode->mValue = Rational(7, 2); },
+			[](ASTNode*) {},
+			});
+		ASTNode* expected = parserTest.mParser.Parse("sin(x)*3.5+pi");
+		tree->InvalidateHash();
+		product->InvalidateHash();
+		REQUIRE(*tree == *expected);
+
+		delete tree;
+		delete expected;
+	}
+
+	TEST_CASE("InPlaceSimplifyTest", "[InPlaceSimplifyTest]")
+	{
+		ParserTest parserTest;
+		const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+
+		SECTION("MovesUnchangedSubtrees")
+		{
+			std::unique_ptr<ASTNode> tree(parserTest.mParser.Parse("sin(y)^2 - (x + x)"));
+			ASTNode* expected = simplifier.Simplify(tree.get());
+			const OperatorNode* difference = NodeCast<OperatorNode>(tree.get());
+			const ASTNode* power = difference->mOperands[0];
+
+			std::unique_ptr<ASTNode> simplified = simplifier.Simplify(std::move(tree));
+			REQUIRE(*simplified == *expected);
+
+			// the root and the untouched operand are the nodes that were passed in
+			REQUIRE(simplified.get() == difference);
+			REQUIRE(NodeCast<OperatorNode>(simplified.get())->mOperands[0] == power);
+			delete expected;
+		}
+
+		SECTION("Rewrites")
+		{
+			for (const char* expression : { "x + x", "-(y + y)", "sin(x) + -sin(x)", "cos(x)+1.5cos(x)", "z" })
+			{
+				std::unique_ptr<ASTNode> tree(parserTest.mParser.Parse(expression));
+				ASTNode* expected = simplifier.Simplify(tree.get());
+				std::unique_ptr<ASTNode> simplified = simplifier.Simplify(std::move(tree));
+				REQUIRE(simplified);
+				REQUIRE(*simplified == *expected);
+				delete expected;
+			}
+			REQUIRE(!simplifier.Simplify(std::unique_ptr<ASTNode>()));
+		}
+
+		SECTION("MovesKeptSubtrees")
+		{
+			// the identity keeps its operand, which is moved rather than copied
+			std::unique_ptr<ASTNode> tree(parserTest.mParser.Parse("(sin(x)^2 - cos(y)/z)*1"));
+			const ASTNode* huge = NodeCast<OperatorNode>(tree.get())->mOperands[0];
+			ASTNode* expected = parserTest.mParser.Parse("sin(x)^2 - cos(y)/z");
+			std::unique_ptr<ASTNode> simplified = simplifier.Simplify(std::move(tree));
+			REQUIRE(simplified.get() == huge);
+			REQUIRE(*simplified == *expected);
+			delete expected;
+
+			// like terms keep the common term
+			for (const char* expression : { "2sin(x) + 3sin(x)", "sin(x)*2 + 3*sin(x)" })
+			{
+				tree.reset(parserTest.mParser.Parse(expression));
+				const OperatorNode* term = NodeCast<OperatorNode>(NodeCast<OperatorNode>(tree.get())->mOperands[0]);
+				const ASTNode* common = NodeCast<OperatorNode>(term->mOperands[0]) ? term->mOperands[0] : term->mOperands[1];
+				expected = simplifier.Simplify(tree.get());
+				simplified = simplifier.Simplify(std::move(tree));
+				REQUIRE(*simplified == *expected);
+				REQUIRE(NodeCast<OperatorNode>(simplified.get())->mOperands[1] == common);
+				delete expected;
+			}
+		}
+
+		SECTION("InvalidatesHashesToTheRoot")
+		{
+			// the cached hashes are taken before, only cos gets a new operand and keeps its pointer
+			std::unique_ptr<ASTNode> tree(parserTest.mParser.Parse("sin(cos(0+x))"));
+			const ASTNode* root = tree.get();
+			const uint64_t staleHash = tree->GetHash();
+			ASTNode* expected = parserTest.mParser.Parse("sin(cos(x))");
+
+			std::unique_ptr<ASTNode> simplified = simplifier.Simplify(std::move(tree));
+			REQUIRE(simplified.get() == root);
+			REQUIRE(simplified->GetHash() != staleHash);
+			REQUIRE(simplified->GetHash() == expected->GetHash());
+			REQUIRE(*simplified == *expected);
+			delete expected;
+		}
+
+		SECTION("Limits")
+		{
+			ASTSimplifierSettings settings;
+			settings.mMaxDepth = 3;
+			ASTSimplifier limited(settings);
+			REQUIRE(limited.Simplify(std::unique_ptr<ASTNode>(parserTest.mParser.Parse("sin(cos(x))"))));
+			REQUIRE(!limited.Simplify(std::unique_ptr<ASTNode>(parserTest.mParser.Parse("sin(cos(tan(x)))"))));
+		}
+	}
+
+	TEST_CASE("SharedNodeTest", "[SharedNodeTest]")
+	{
+		ParserTest parserTest;
+		const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
+		ASTSharedNode original = ASTSharedNode::Adopt(parserTest.mParser.Parse("sin(x)^2 - cos(y)*z"));
+		const OperatorNode* root = NodeCast<OperatorNode>(original.Get());
+		REQUIRE(root->mOwnership == ASTNode::NodeOwnership::Shared);
+		REQUIRE(root->mOperands[1]->mOwnership == ASTNode::NodeOwnership::Shared);
+		REQUIRE(root->GetReferenceCount() == 1);
+
+		SECTION("Copies")
+		{
+			ASTSharedNode copy = original;
+			REQUIRE(copy.Get() == original.Get());
+			REQUIRE(root->GetReferenceCount() == 2);
+			copy.Reset();
+			REQUIRE(root->GetReferenceCount() == 1);
+
+			// a clone copies the root only and references the operands
+			ASTNode* clone = original->Clone();
+			REQUIRE(clone->mOwnership == ASTNode::NodeOwnership::Heap);
+			REQUIRE(NodeCast<OperatorNode>(clone)->mOperands[1] == root->mOperands[1]);
+			REQUIRE(root->mOperands[1]->GetReferenceCount() == 2);
+			REQUIRE(*clone == *original);
+			delete clone;
+			REQUIRE(root->mOperands[1]->GetReferenceCount() == 1);
+		}
+
+		SECTION("Substitute")
+		{
+			ASTSharedNode replacement = ASTSharedNode::Adopt(parserTest.mParser.Parse("t*u"));
+			ASTSharedNode substituted = SubstituteVariable(original, SymbolInterner::GetDefault().Intern("x").mId, replacement);
+			ASTNode* expected = parserTest.mParser.Parse("sin(t*u)^2 - cos(y)*z");
+			REQUIRE(*substituted == *expected);
+			delete expected;
+
+			// the operand without x is shared between both versions
+			const OperatorNode* substitutedRoot = NodeCast<OperatorNode>(substituted.Get());
+			REQUIRE(substitutedRoot != root);
+			REQUIRE(substitutedRoot->mOperands[0] != root->mOperands[0]);
+			REQUIRE(substitutedRoot->mOperands[1] == root->mOperands[1]);
+
+			// nothing to substitute gives the same tree
+			REQUIRE(SubstituteVariable(original, SymbolInterner::GetDefault().Intern("w").mId, replacement).Get() == original.Get());
+		}
+
+		SECTION("ReplaceSubtree")
+		{
+			ASTSharedNode five = ASTSharedNode::Adopt(new RationalNode(5));
+			ASTSharedNode replaced = ReplaceSubtree(original, { 1, 0 }, five);
+			const OperatorNode* replacedRoot = NodeCast<OperatorNode>(replaced.Get());
+			REQUIRE(replacedRoot->mOperands[0] == root->mOperands[0]);
+			const OperatorNode* product = NodeCast<OperatorNode>(replacedRoot->mOperands[1]);
+			REQUIRE(product->mOperands[0] == five.Get());
+			REQUIRE(product->mOperands[1] == NodeCast<OperatorNode>(root->mOperands[1])->mOperands[1]);
+
+			REQUIRE(!ReplaceSubtree(original, { 0, 1, 0 }, five));
+			REQUIRE(ReplaceSubtree(original, {}, five).Get() == five.Get());
+		}
+
+		SECTION("Simplify")
+		{
+			ASTSharedNode tree = ASTSharedNode::Adopt(parserTest.mParser.Parse("sin(y)^2 - (x + x)"));
+			ASTNode* expected = simplifier.Simplify(const_cast<ASTNode*>(tree.Get()));
+			ASTSharedNode simplified = simplifier.Simplify(tree);
+			REQUIRE(*simplified == *expected);
+			delete expected;
+
+			// the untouched operand is shared, the original version is unchanged
+			const OperatorNode* treeRoot = NodeCast<OperatorNode>(tree.Get());
+			REQUIRE(NodeCast<OperatorNode>(simplified.Get())->mOperands[0] == treeRoot->mOperands[0]);
+			ASTNode* unchanged = parserTest.mParser.Parse("sin(y)^2 - (x + x)");
+			REQUIRE(*tree == *unchanged);
+			delete unchanged;
+
+			// nothing to simplify gives the same tree
+			REQUIRE(simplifier.Simplify(original).Get() == original.Get());
+
+			// the in-place form copies shared operands instead of rewriting them
+			std::unique_ptr<ASTNode> heap(tree->Clone());
+			std::unique_ptr<ASTNode> heapSimplified = simplifier.Simplify(std::move(heap));
+			REQUIRE(*heapSimplified == *simplified);
+			REQUIRE(*tree != *heapSimplified);
 		}
 	}
 
@@ -352,8 +1976,11 @@ namespace AST
 			ASTNode* node = parserTest.mParser.Parse("0+x");
 			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
 			ASTNode* simplifiedNode = simplifier.Simplify(node);
-			std::string out = ASTNodeTreeViewer::PrintTree(simplifiedNode);
-			std::cout << out << std::endl;
+			ASTNode* expected = parserTest.mParser.Parse("x");
+			REQUIRE(*simplifiedNode == *expected);
+			delete node;
+			delete simplifiedNode;
+			delete expected;
 		}
 
 		SECTION("Simplify2")
@@ -361,8 +1988,11 @@ namespace AST
 			ASTNode* node = parserTest.mParser.Parse("sin(x)+-sin(x)");
 			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
 			ASTNode* simplifiedNode = simplifier.Simplify(node);
-			std::string out = ASTNodeTreeViewer::PrintTree(simplifiedNode);
-			std::cout << out << std::endl;
+			ASTNode* expected = parserTest.mParser.Parse("0");
+			REQUIRE(*simplifiedNode == *expected);
+			delete node;
+			delete simplifiedNode;
+			delete expected;
 		}
 
 		SECTION("Simplify3")
@@ -370,8 +2000,11 @@ namespace AST
 			ASTNode* node = parserTest.mParser.Parse("cos(x)+1.5cos(x)");
 			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
 			ASTNode* simplifiedNode = simplifier.Simplify(node);
-			std::string out = ASTNodeTreeViewer::PrintTree(simplifiedNode);
-			std::cout << out << std::endl;
+			ASTNode* expected = parserTest.mParser.Parse("2.5cos(x)");
+			REQUIRE(*simplifiedNode == *expected);
+			delete node;
+			delete simplifiedNode;
+			delete expected;
 		}
 
 		SECTION("Simplify4")
@@ -379,8 +2012,11 @@ namespace AST
 			ASTNode* node = parserTest.mParser.Parse("1.5cos(x)+cos(x)+1.5cos(x)");
 			const ASTSimplifier& simplifier = ASTSimplifier::GetDefault();
 			ASTNode* simplifiedNode = simplifier.Simplify(node);
-			std::string out = ASTNodeTreeViewer::PrintTree(simplifiedNode);
-			std::cout << out << std::endl;
+			ASTNode* expected = parserTest.mParser.Parse("4cos(x)");
+			REQUIRE(*simplifiedNode == *expected);
+			delete node;
+			delete simplifiedNode;
+			delete expected;
 		}
 	}
 